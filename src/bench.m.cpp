@@ -0,0 +1,656 @@
+// Headless physics benchmarks. Each case builds its own scene, times a fixed number
+// of steps and prints one line per configuration.
+//
+//   bench scaling [steps]    step time of 1k-10k ball sandboxes against thread count
+//   bench broadphase [steps] step time of each broadphase for dense and spread out layouts,
+//                            and the part of it spent finding the ordered candidate pairs
+//   bench morton [steps]     step time of a 10k ball layout with scattered storage, with
+//                            and without Morton re-sorting. Run under a profiler such as
+//                            "perf stat -e cache-misses" to see the cache miss counts.
+//   bench coroutine [jobs]   per job overhead of executor tasks against raw pool submission
+//   bench shm [updates]      cost of publishing the live state export, and the latency
+//                            until a reader on another thread sees each update
+//   bench arena [rollouts] [malloc|monotonic|pool]
+//                            rollout throughput and heap calls with each simulation on
+//                            the global heap or a per-worker arena. Peak RSS is for the
+//                            whole process, so run one mode at a time to compare it.
+//   bench rewind [shots]     per step cost and memory of recording shots for rewind, and
+//                            the time to seek, checking seeks reproduce the original
+//   bench alloc [steps]      heap allocations in steady state serial stepping with each
+//                            contact solver, for a rack break and a dense sandbox. The
+//                            steps run in a no_alloc_scope, so with
+//                            SNOOKER_TRACK_ALLOCATIONS on any allocation fails the bench.
+//   bench break [seeds]      rack breaks with PGS at 10, 20 and 50 iterations against the
+//                            block cluster solver: balls potted, how far ball positions
+//                            are from PGS at 50 iterations after half a second, and the
+//                            step time while the rack is breaking up
+#include "alloc_tracker.hpp"
+#include "broadphase.hpp"
+#include "executor.hpp"
+#include "rewind.hpp"
+#include "rollout.hpp"
+#include "simulation.hpp"
+#include "state_export.hpp"
+#include "table.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+struct layout
+{
+    std::string_view name;
+    float            spacing;   // distance between neighbouring ball centres
+    float            max_speed;
+};
+
+constexpr auto loose_layout  = layout{"loose", 3.0f * ball_radius, 100.0f};
+constexpr auto dense_layout  = layout{"dense", 2.02f * ball_radius, 20.0f};
+constexpr auto spread_layout = layout{"spread", 8.0f * ball_radius, 100.0f};
+
+// A square box of balls laid out on a grid with random velocities. The box grows
+// with the ball count so the density only depends on the layout.
+// With scatter set, balls are inserted in a random order to mimic the storage order
+// of a scene that has seen lots of insertions and removals.
+auto make_sandbox(std::size_t num_balls, u32 seed, const layout& l = loose_layout, bool scatter = false) -> simulation
+{
+    auto sim = simulation{};
+    const auto spacing = l.spacing;
+    const auto per_row = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<float>(num_balls))));
+    const auto size = static_cast<float>(per_row + 1) * spacing;
+
+    sim.add_static_line({0, 0}, {size, 0});
+    sim.add_static_line({size, 0}, {size, size});
+    sim.add_static_line({size, size}, {0, size});
+    sim.add_static_line({0, size}, {0, 0});
+
+    auto rng = std::mt19937{seed};
+    auto speed = std::uniform_real_distribution<float>{-l.max_speed, l.max_speed};
+    auto slots = std::vector<std::size_t>(num_balls);
+    std::iota(slots.begin(), slots.end(), 0);
+    if (scatter) {
+        std::shuffle(slots.begin(), slots.end(), rng);
+    }
+    for (const auto i : slots) {
+        const auto pos = glm::vec2{static_cast<float>(i % per_row + 1), static_cast<float>(i / per_row + 1)} * spacing;
+        const auto id = sim.add_dynamic_circle(pos, ball_radius, ball_mass);
+        std::get<dynamic_body>(sim.get(id).body).vel = {speed(rng), speed(rng)};
+    }
+    return sim;
+}
+
+// Returns the average wall time of one step in milliseconds
+auto time_steps(simulation& sim, i32 steps) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (i32 i = 0; i != steps; ++i) {
+        sim.step();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+auto run_scaling(i32 steps) -> bool
+{
+    auto thread_counts = std::vector<std::size_t>{1};
+    for (std::size_t n = 2; n <= std::thread::hardware_concurrency(); n *= 2) {
+        thread_counts.push_back(n);
+    }
+
+    auto ok = true;
+    for (const auto num_balls : {1000uz, 2500uz, 5000uz, 10000uz}) {
+        auto single_ms = 0.0;
+        auto expected_hash = u64{0};
+        for (const auto threads : thread_counts) {
+            // The single threaded run also goes through the region path so that every
+            // run produces the same result
+            auto pool = std::make_unique<thread_pool>(threads - 1);
+            auto sim = make_sandbox(num_balls, 1234);
+            sim.set_thread_pool(pool.get(), 0);
+
+            const auto ms = time_steps(sim, steps);
+            const auto hash = sim.state_hash();
+            if (threads == 1) {
+                single_ms = ms;
+                expected_hash = hash;
+            }
+            const auto speedup = single_ms / ms;
+            const auto deterministic = hash == expected_hash;
+            ok = ok && deterministic;
+            std::print("scaling balls={:<6} threads={:<3} step={:8.3f}ms speedup={:5.2f}x efficiency={:5.1f}% hash={:016x}{}\n",
+                       num_balls, threads, ms, speedup, 100.0 * speedup / threads, hash,
+                       deterministic ? "" : " MISMATCH");
+        }
+    }
+    return ok;
+}
+
+auto run_broadphase(i32 steps) -> bool
+{
+    constexpr auto kinds = std::array{broadphase_kind::brute_force, broadphase_kind::grid, broadphase_kind::sweep_and_prune};
+
+    auto ok = true;
+    for (const auto& l : {dense_layout, spread_layout}) {
+        for (const auto num_balls : {250uz, 1000uz, 4000uz}) {
+            auto expected_hash = std::optional<u64>{};
+            for (const auto kind : kinds) {
+                // Testing every pair is far too slow to be worth timing at this size
+                if (kind == broadphase_kind::brute_force && num_balls > 1000) continue;
+
+                auto sim = make_sandbox(num_balls, 1234, l);
+                sim.set_broadphase(kind);
+                const auto ms = time_steps(sim, steps);
+                const auto pairs = sim.stats().latest()->broadphase_pairs / simulation::num_substeps;
+                // Averaged over the steps still held in the stats history
+                auto broadphase_ms = 0.0;
+                auto sampled = 0;
+                while (const auto s = sim.stats().latest(sampled)) {
+                    broadphase_ms += s->broadphase_time_ms;
+                    ++sampled;
+                }
+                broadphase_ms /= std::max(sampled, 1);
+
+                const auto hash = sim.state_hash();
+                if (!expected_hash) expected_hash = hash;
+                const auto identical = hash == *expected_hash;
+                ok = ok && identical;
+                std::print("broadphase layout={:<6} balls={:<5} kind={:<15} step={:8.3f}ms find_pairs={:8.3f}ms pairs/substep={:<8} hash={:016x}{}\n",
+                           l.name, num_balls, name_of(kind), ms, broadphase_ms, pairs, hash, identical ? "" : " MISMATCH");
+            }
+        }
+    }
+    return ok;
+}
+
+auto run_morton(i32 steps) -> bool
+{
+    constexpr auto num_balls = 10000uz;
+    auto pool = thread_pool{std::max(2u, std::thread::hardware_concurrency()) - 1};
+
+    for (const auto parallel : {false, true}) {
+        auto unsorted_ms = 0.0;
+        for (const auto interval : {0, 60}) {
+            auto sim = make_sandbox(num_balls, 1234, loose_layout, true);
+            sim.set_broadphase(broadphase_kind::grid);
+            sim.set_spatial_sort_interval(interval);
+            if (parallel) sim.set_thread_pool(&pool, 0);
+
+            const auto ms = time_steps(sim, steps);
+            if (interval == 0) unsorted_ms = ms;
+            std::print("morton balls={} mode={:<8} sort_interval={:<3} step={:8.3f}ms speedup={:5.2f}x\n",
+                       num_balls, parallel ? "parallel" : "serial", interval, ms, unsorted_ms / ms);
+        }
+    }
+    return true;
+}
+
+// A small fixed amount of work so that scheduling overhead dominates
+auto busy_work(std::size_t seed) -> u64
+{
+    auto x = static_cast<u64>(seed) + 1;
+    for (int i = 0; i != 256; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+auto busy_task(std::size_t seed) -> task<u64>
+{
+    co_return busy_work(seed);
+}
+
+auto sum_batch(executor& exec, std::size_t count) -> task<u64>
+{
+    auto tasks = std::vector<task<u64>>{};
+    tasks.reserve(count);
+    for (std::size_t i = 0; i != count; ++i) {
+        tasks.push_back(busy_task(i));
+    }
+    auto sum = u64{0};
+    for (const auto value : co_await exec.when_all(std::move(tasks))) {
+        sum += value;
+    }
+    co_return sum;
+}
+
+auto run_coroutine(std::size_t jobs) -> bool
+{
+    auto pool = thread_pool{std::max(2u, std::thread::hardware_concurrency()) - 1};
+    auto exec = executor{pool};
+
+    const auto time = [&](auto&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto sum = f();
+        const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return std::pair{ns / jobs, sum};
+    };
+
+    const auto [serial_ns, expected] = time([&] {
+        auto sum = u64{0};
+        for (std::size_t i = 0; i != jobs; ++i) sum += busy_work(i);
+        return sum;
+    });
+
+    const auto [raw_ns, raw_sum] = time([&] {
+        auto sum = std::atomic<u64>{0};
+        auto done = std::atomic<std::size_t>{0};
+        for (std::size_t i = 0; i != jobs; ++i) {
+            pool.submit([&, i] {
+                sum += busy_work(i);
+                if (++done == jobs) done.notify_all();
+            });
+        }
+        for (auto d = done.load(); d != jobs; d = done.load()) done.wait(d);
+        return sum.load();
+    });
+
+    const auto [task_ns, task_sum] = time([&] {
+        auto result = exec.spawn([&](std::stop_token) { return sum_batch(exec, jobs); });
+        while (!result.ready()) {
+            if (exec.run_main_continuations() == 0) std::this_thread::yield();
+        }
+        return result.result();
+    });
+
+    std::print("coroutine jobs={} serial={:.1f}ns/job raw_pool={:.1f}ns/job tasks={:.1f}ns/job overhead={:+.1f}ns/job\n",
+               jobs, serial_ns, raw_ns, task_ns, task_ns - raw_ns);
+    return raw_sum == expected && task_sum == expected;
+}
+
+auto run_shm(i32 updates) -> bool
+{
+    const auto name = "snooker_state_bench";
+    auto t = make_standard_table(1);
+    apply_shot(t, cue_shot{ .direction=glm::vec2{1.0f, 0.02f}, .power=400.0f });
+
+    auto exporter = state_exporter{name};
+    const auto reader = state_reader{name};
+    exporter.publish(t, 0);
+    if (!exporter.valid() || !reader.valid()) {
+        std::print("shm could not create shared memory segment {}\n", name);
+        return false;
+    }
+
+    // The reader spins on the sequence number and timestamps every update it sees.
+    // Updates it misses while busy are simply skipped, as they would be for a real tool.
+    auto done = std::atomic<bool>{false};
+    auto latencies = std::vector<double>{};
+    auto torn = 0;
+    auto reader_thread = std::jthread{[&] {
+        auto last = reader.sequence();
+        while (!done.load(std::memory_order_relaxed)) {
+            if (reader.sequence() == last) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto published = i64{0};
+            auto step = u64{0};
+            auto num_balls = u32{0};
+            last = reader.read([&](const exported_state& s) {
+                published = s.publish_time_ns;
+                step = s.step;
+                num_balls = s.num_balls;
+            });
+            const auto now = std::chrono::steady_clock::now().time_since_epoch();
+            latencies.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - published));
+            torn += num_balls != 1 + t.object_balls.size() || step == 0;
+        }
+    }};
+
+    // Publish at roughly the game's rate of one step per frame rather than flat out,
+    // so the reader has a chance to see most updates
+    auto publish_ns = 0.0;
+    for (i32 i = 0; i != updates; ++i) {
+        t.sim.step();
+        const auto start = std::chrono::steady_clock::now();
+        exporter.publish(t, 1);
+        publish_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(std::chrono::microseconds{500});
+    }
+    done = true;
+    reader_thread.join();
+
+    if (latencies.empty()) {
+        std::print("shm reader saw no updates\n");
+        return false;
+    }
+    std::ranges::sort(latencies);
+    const auto percentile = [&](double p) { return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))] / 1000.0; };
+    std::print("shm updates={} seen={} publish={:.0f}ns/update latency p50={:.1f}us p99={:.1f}us max={:.1f}us\n",
+               updates, latencies.size(), publish_ns / updates, percentile(0.5), percentile(0.99), latencies.back() / 1000.0);
+    return torn == 0;
+}
+
+// Passes everything through to the global heap, counting the calls that get there
+class counting_resource : public std::pmr::memory_resource
+{
+    std::atomic<u64> d_allocations = 0;
+    std::atomic<u64> d_bytes = 0;
+
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override
+    {
+        d_allocations.fetch_add(1, std::memory_order_relaxed);
+        d_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override
+    {
+        return this == &other;
+    }
+
+public:
+    auto allocations() const -> u64 { return d_allocations.load(std::memory_order_relaxed); }
+    auto bytes() const -> u64 { return d_bytes.load(std::memory_order_relaxed); }
+};
+
+auto peak_rss_kb() -> std::size_t
+{
+#ifdef _WIN32
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    auto status = std::ifstream{"/proc/self/status"};
+    for (auto line = std::string{}; std::getline(status, line);) {
+        if (line.starts_with("VmHWM:")) return std::stoull(line.substr(6));
+    }
+    return 0;
+#endif
+}
+
+auto run_arena(i32 rollouts, std::string_view only) -> bool
+{
+    auto rng = std::mt19937{7};
+    auto angle = std::uniform_real_distribution<float>{0.0f, 2.0f * std::numbers::pi_v<float>};
+    auto power = std::uniform_real_distribution<float>{150.0f, 500.0f};
+    auto shots = std::vector<cue_shot>{};
+    for (i32 i = 0; i != rollouts; ++i) {
+        const auto a = angle(rng);
+        shots.push_back({ .direction={std::cos(a), std::sin(a)}, .power=power(rng) });
+    }
+    const auto t = make_standard_table(1);
+    auto pool = thread_pool{std::max(2u, std::thread::hardware_concurrency()) - 1};
+
+    // Each worker keeps its arena between rollouts. The monotonic one starts from a
+    // fixed buffer, which release() hands back for the next rollout to reuse, and
+    // only goes to the heap if a rollout outgrows it.
+    constexpr auto monotonic_buffer_size = std::size_t{1} << 20;
+    struct worker_arenas
+    {
+        std::unique_ptr<std::byte[]>          buffer;
+        std::pmr::monotonic_buffer_resource   monotonic;
+        std::pmr::unsynchronized_pool_resource pool;
+
+        explicit worker_arenas(counting_resource* upstream)
+            : buffer{std::make_unique<std::byte[]>(monotonic_buffer_size)}
+            , monotonic{buffer.get(), monotonic_buffer_size, upstream}
+            , pool{upstream}
+        {}
+    };
+
+    auto ok = true;
+    auto expected = std::optional<i64>{};
+    for (const auto mode : {"malloc", "monotonic", "pool"}) {
+        if (!only.empty() && only != mode) continue;
+        const auto name = std::string_view{mode};
+
+        auto upstream = counting_resource{};
+        auto arenas = std::unordered_map<std::thread::id, std::unique_ptr<worker_arenas>>{};
+        auto arenas_mutex = std::mutex{};
+        auto total = std::atomic<i64>{0};
+
+        const auto start = std::chrono::steady_clock::now();
+        pool.parallel_for(shots.size(), [&](std::size_t i) {
+            auto arena = static_cast<worker_arenas*>(nullptr);
+            {
+                auto lock = std::lock_guard{arenas_mutex};
+                auto& slot = arenas[std::this_thread::get_id()];
+                if (!slot) slot = std::make_unique<worker_arenas>(&upstream);
+                arena = slot.get();
+            }
+
+            auto result = rollout_result{};
+            if (name == "malloc") {
+                result = rollout(t, shots[i], 60 * 60, &upstream);
+            } else if (name == "monotonic") {
+                result = rollout(t, shots[i], 60 * 60, &arena->monotonic);
+                arena->monotonic.release();
+            } else {
+                result = rollout(t, shots[i], 60 * 60, &arena->pool);
+            }
+            total.fetch_add(result.steps * 100 + result.balls_potted, std::memory_order_relaxed);
+        });
+        const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        arenas.clear();
+
+        if (!expected) expected = total.load();
+        const auto same = total.load() == *expected;
+        ok = ok && same;
+        std::print("arena {:<9} rollouts={} {:7.0f} rollouts/s heap calls={:8.1f}/rollout heap bytes={:9.0f}/rollout peak rss={}KB{}\n",
+                   name, rollouts, 1000.0 * rollouts / ms, static_cast<double>(upstream.allocations()) / rollouts,
+                   static_cast<double>(upstream.bytes()) / rollouts, peak_rss_kb(), same ? "" : " MISMATCH");
+    }
+    return ok;
+}
+
+auto run_rewind(i32 shots) -> bool
+{
+    auto rng = std::mt19937{11};
+    auto angle = std::uniform_real_distribution<float>{0.0f, 2.0f * std::numbers::pi_v<float>};
+    auto power = std::uniform_real_distribution<float>{150.0f, 600.0f};
+
+    auto buffer = rewind_buffer{};
+    auto record_ns = 0.0;
+    auto steps = i64{0};
+    auto peak_bytes = std::size_t{0};
+    auto seek_ms = 0.0;
+    auto seeks = 0;
+    auto mismatches = 0;
+    auto t = make_standard_table(3);
+    for (i32 s = 0; s != shots; ++s) {
+        const auto a = angle(rng);
+        const auto shot = cue_shot{ .direction={std::cos(a), std::sin(a)}, .power=power(rng) };
+        if (t.object_balls.empty()) t = make_standard_table(static_cast<u32>(s));
+
+        auto start = std::chrono::steady_clock::now();
+        buffer.begin_shot(t, shot);
+        record_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        apply_shot(t, shot);
+
+        // Keep the hash at a few steps along the way to check seeking against
+        auto checkpoints = std::vector<std::pair<i32, u64>>{{0, 0}};
+        for (i32 step = 1; step <= 60 * 60 && !t.sim.is_at_rest(); ++step) {
+            t.sim.step();
+            remove_pocketed_balls(t);
+            start = std::chrono::steady_clock::now();
+            buffer.record_step(t);
+            record_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            ++steps;
+            if (step % 97 == 0) checkpoints.emplace_back(step, t.sim.state_hash());
+        }
+        checkpoints.emplace_back(buffer.steps(), t.sim.state_hash());
+
+        // The game keeps stepping the table while it sits idle, which mustn't extend the recording
+        if (t.sim.is_at_rest()) {
+            const auto recorded = buffer.steps();
+            for (i32 step = 0; step != 600; ++step) buffer.record_step(t);
+            mismatches += buffer.steps() != recorded;
+        }
+        peak_bytes = std::max(peak_bytes, buffer.memory_used());
+
+        auto seeked = table{};
+        for (const auto [step, hash] : checkpoints) {
+            if (step == 0) continue;
+            start = std::chrono::steady_clock::now();
+            buffer.seek(seeked, step);
+            seek_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ++seeks;
+            mismatches += seeked.sim.state_hash() != hash;
+        }
+        respot_cue_ball(t);
+    }
+    std::print("rewind shots={} steps={} record={:.0f}ns/step peak={}B seek={:.2f}ms mismatches={}\n",
+               shots, steps, record_ns / steps, peak_bytes, seek_ms / seeks, mismatches);
+    return mismatches == 0;
+}
+
+auto run_alloc(i32 steps) -> bool
+{
+    // Long enough for the scratch buffers to reach the size the scene needs
+    constexpr auto warm_up_steps = 60;
+
+    auto rack = make_standard_table(1);
+    const auto apex = rack.sim.get(rack.object_balls.front().id).pos;
+    const auto cue = rack.sim.get(rack.cue_ball.id).pos;
+    apply_shot(rack, cue_shot{ .direction=glm::normalize(apex - cue), .power=600.0f });
+
+    const auto scenes = std::array{std::pair{"break", rack.sim}, std::pair{"dense", make_sandbox(1000, 1234, dense_layout)}};
+    for (const auto kind : {contact_solver_kind::pgs, contact_solver_kind::block_cluster}) {
+        for (auto [name, sim] : scenes) {
+            sim.set_contact_solver(kind);
+            for (i32 i = 0; i != warm_up_steps; ++i) sim.step();
+
+            // The scope's destructor fails the bench if anything was allocated
+            auto scope = no_alloc_scope{"serial step"};
+            const auto before = thread_alloc_stats().total();
+            for (i32 i = 0; i != steps; ++i) sim.step();
+            const auto after = thread_alloc_stats().total();
+            std::print("alloc scene={:<5} solver={:<13} steps={} allocations={} bytes={}{}\n",
+                       name, name_of(sim.contact_solver()), steps, after.count - before.count, after.bytes - before.bytes,
+                       alloc_tracking_enabled() ? "" : " (tracking disabled, build with SNOOKER_TRACK_ALLOCATIONS)");
+        }
+    }
+    return true;
+}
+
+auto run_break(i32 seeds) -> bool
+{
+    struct solver_config
+    {
+        contact_solver_kind kind;
+        i32                 iterations;
+    };
+    constexpr auto configs = std::array{
+        solver_config{contact_solver_kind::pgs, 50}, // first, as the reference for the others
+        solver_config{contact_solver_kind::pgs, 10},
+        solver_config{contact_solver_kind::pgs, 20},
+        solver_config{contact_solver_kind::block_cluster, simulation::num_solver_iterations},
+    };
+    constexpr auto compare_step = 30;
+    constexpr auto timed_steps = 60;
+
+    auto reference = std::vector<std::vector<glm::vec2>>(seeds);
+    for (const auto config : configs) {
+        auto potted = 0;
+        auto deviation = 0.0;
+        auto max_deviation = 0.0;
+        auto break_ms = 0.0;
+        auto total_ms = 0.0;
+        auto steps = i64{0};
+        for (i32 seed = 0; seed != seeds; ++seed) {
+            auto t = make_standard_table(static_cast<u32>(seed));
+            t.sim.set_contact_solver(config.kind, config.iterations);
+            const auto apex = t.sim.get(t.object_balls.front().id).pos;
+            const auto cue = t.sim.get(t.cue_ball.id).pos;
+            apply_shot(t, cue_shot{ .direction=glm::normalize(apex - cue), .power=600.0f });
+
+            for (i32 step = 1; step <= 60 * 60 && !t.sim.is_at_rest(); ++step) {
+                const auto start = std::chrono::steady_clock::now();
+                t.sim.step();
+                const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                total_ms += ms;
+                if (step <= timed_steps) break_ms += ms;
+                ++steps;
+
+                // Positions before any pots, so the same balls are compared
+                if (step == compare_step) {
+                    auto positions = std::vector<glm::vec2>{};
+                    for (const auto& b : t.object_balls) positions.push_back(t.sim.get(b.id).pos);
+                    if (reference[seed].empty()) reference[seed] = positions;
+                    for (std::size_t k = 0; k != positions.size(); ++k) {
+                        const auto d = static_cast<double>(glm::distance(positions[k], reference[seed][k]));
+                        deviation += d / positions.size();
+                        max_deviation = std::max(max_deviation, d);
+                    }
+                }
+                const auto before = t.object_balls.size();
+                remove_pocketed_balls(t);
+                potted += static_cast<i32>(before - t.object_balls.size());
+            }
+        }
+        std::print("break solver={:<5} iterations={:<2} potted={:5.2f}/break deviation={:6.3f}cm max={:6.3f}cm break step={:7.3f}ms step={:7.3f}ms\n",
+                   name_of(config.kind), config.iterations, static_cast<double>(potted) / seeds, deviation / seeds, max_deviation,
+                   break_ms / (seeds * timed_steps), total_ms / steps);
+    }
+    return true;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto which = argc > 1 ? std::string_view{argv[1]} : std::string_view{"scaling"};
+    const auto steps = argc > 2 ? std::atoi(argv[2]) : 60;
+
+    if (which == "scaling") {
+        return run_scaling(steps) ? 0 : 1;
+    }
+    if (which == "coroutine") {
+        return run_coroutine(argc > 2 ? std::atoi(argv[2]) : 100000) ? 0 : 1;
+    }
+    if (which == "morton") {
+        return run_morton(steps) ? 0 : 1;
+    }
+    if (which == "shm") {
+        return run_shm(argc > 2 ? std::atoi(argv[2]) : 2000) ? 0 : 1;
+    }
+    if (which == "arena") {
+        return run_arena(argc > 2 ? std::atoi(argv[2]) : 2000, argc > 3 ? argv[3] : "") ? 0 : 1;
+    }
+    if (which == "rewind") {
+        return run_rewind(argc > 2 ? std::atoi(argv[2]) : 50) ? 0 : 1;
+    }
+    if (which == "alloc") {
+        return run_alloc(argc > 2 ? std::atoi(argv[2]) : 600) ? 0 : 1;
+    }
+    if (which == "break") {
+        return run_break(argc > 2 ? std::atoi(argv[2]) : 20) ? 0 : 1;
+    }
+    if (which == "broadphase") {
+        return run_broadphase(steps) ? 0 : 1;
+    }
+    std::print("unknown benchmark '{}'\n", which);
+    return 1;
+}
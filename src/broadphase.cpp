@@ -0,0 +1,172 @@
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace snooker {
+namespace {
+
+auto pair_key(u32 a, u32 b) -> u64
+{
+    if (a > b) std::swap(a, b);
+    return (static_cast<u64>(a) << 32) | b;
+}
+
+auto cell_of(f32 value, f32 cell_size) -> i32
+{
+    return static_cast<i32>(std::floor(value / cell_size));
+}
+
+}
+
+auto name_of(broadphase_kind kind) -> std::string_view
+{
+    switch (kind) {
+        case broadphase_kind::brute_force:     return "brute_force";
+        case broadphase_kind::grid:            return "grid";
+        case broadphase_kind::sweep_and_prune: return "sweep_and_prune";
+        default:                               return "unknown";
+    }
+}
+
+auto grid_broadphase::find_pairs(std::span<const aabb> bounds, std::pmr::vector<broadphase_pair>& out) -> void
+{
+    d_items.clear();
+    for (u32 i = 0; i != bounds.size(); ++i) {
+        const auto& box = bounds[i];
+        const auto min_x = cell_of(box.min.x, d_cell_size);
+        const auto max_x = cell_of(box.max.x, d_cell_size);
+        const auto min_y = cell_of(box.min.y, d_cell_size);
+        const auto max_y = cell_of(box.max.y, d_cell_size);
+        for (auto x = min_x; x <= max_x; ++x) {
+            for (auto y = min_y; y <= max_y; ++y) {
+                const auto cell = (static_cast<u64>(static_cast<u32>(x)) << 32) | static_cast<u32>(y);
+                d_items.push_back({cell, i});
+            }
+        }
+    }
+    std::sort(d_items.begin(), d_items.end());
+
+    const auto first = out.size();
+    for (std::size_t begin = 0; begin != d_items.size();) {
+        auto end = begin + 1;
+        while (end != d_items.size() && d_items[end].cell == d_items[begin].cell) ++end;
+        for (auto i = begin; i != end; ++i) {
+            for (auto j = i + 1; j != end; ++j) {
+                out.push_back({d_items[i].index, d_items[j].index});
+            }
+        }
+        begin = end;
+    }
+
+    // Bodies spanning several cells are reported once per shared cell, and sorting
+    // puts the pairs in order too
+    std::sort(out.begin() + first, out.end());
+    out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+auto sweep_and_prune::reset() -> void
+{
+    d_endpoints.clear();
+    d_overlaps.clear();
+    d_changes.clear();
+}
+
+auto sweep_and_prune::rebuild(std::span<const aabb> bounds) -> void
+{
+    reset();
+    for (u32 i = 0; i != bounds.size(); ++i) {
+        d_endpoints.push_back({bounds[i].min.x, i, true});
+        d_endpoints.push_back({bounds[i].max.x, i, false});
+    }
+
+    // Mins sort before maxes at the same value so that touching boxes overlap
+    std::sort(d_endpoints.begin(), d_endpoints.end(), [](const endpoint& a, const endpoint& b) {
+        return a.value != b.value ? a.value < b.value : a.is_min && !b.is_min;
+    });
+
+    d_active.clear();
+    for (const auto& e : d_endpoints) {
+        if (e.is_min) {
+            for (const auto other : d_active) {
+                d_overlaps.push_back(pair_key(e.index, other));
+            }
+            d_active.push_back(e.index);
+        } else {
+            std::erase(d_active, e.index);
+        }
+    }
+    std::sort(d_overlaps.begin(), d_overlaps.end());
+}
+
+auto sweep_and_prune::apply_changes() -> void
+{
+    if (d_changes.empty()) return;
+    std::sort(d_changes.begin(), d_changes.end());
+
+    // A box that passes right over another in one call starts and ends their overlap,
+    // so the key appears twice and the two cancel out
+    auto out = d_changes.begin();
+    for (auto it = d_changes.begin(); it != d_changes.end();) {
+        if (std::next(it) != d_changes.end() && *std::next(it) == *it) {
+            it += 2;
+        } else {
+            *out++ = *it++;
+        }
+    }
+    d_changes.erase(out, d_changes.end());
+
+    // Every remaining change flips whether its pair is in the set
+    d_merged.clear();
+    std::set_symmetric_difference(d_overlaps.begin(), d_overlaps.end(), d_changes.begin(), d_changes.end(), std::back_inserter(d_merged));
+    std::swap(d_overlaps, d_merged);
+    d_changes.clear();
+}
+
+auto sweep_and_prune::update(std::span<const aabb> bounds) -> void
+{
+    if (d_endpoints.size() != 2 * bounds.size()) {
+        rebuild(bounds);
+    }
+    else {
+        for (auto& e : d_endpoints) {
+            e.value = e.is_min ? bounds[e.index].min.x : bounds[e.index].max.x;
+        }
+
+        // Uses the same ordering as the rebuild, so the set always holds exactly
+        // the pairs whose x intervals overlap. A min passing a max starts an overlap
+        // and a max passing a min ends one.
+        for (std::size_t i = 1; i < d_endpoints.size(); ++i) {
+            const auto e = d_endpoints[i];
+            auto j = i;
+            while (j > 0) {
+                const auto& prev = d_endpoints[j - 1];
+                const auto before = e.value < prev.value || (e.value == prev.value && e.is_min && !prev.is_min);
+                if (!before) break;
+                if (e.is_min != prev.is_min) {
+                    d_changes.push_back(pair_key(e.index, prev.index));
+                }
+                d_endpoints[j] = prev;
+                --j;
+            }
+            d_endpoints[j] = e;
+        }
+        apply_changes();
+    }
+}
+
+auto sweep_and_prune::find_pairs(std::span<const aabb> bounds, std::pmr::vector<broadphase_pair>& out) -> void
+{
+    update(bounds);
+    for (const auto key : d_overlaps) {
+        const auto a = static_cast<u32>(key >> 32);
+        const auto b = static_cast<u32>(key);
+        if (bounds[a].min.y <= bounds[b].max.y && bounds[b].min.y <= bounds[a].max.y) {
+            out.push_back({a, b});
+        }
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory_resource>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace snooker {
+
+enum class broadphase_kind
+{
+    brute_force,     // test every pair
+    grid,            // uniform grid rebuilt every substep
+    sweep_and_prune, // sorted endpoints along the x axis, updated incrementally
+};
+
+auto name_of(broadphase_kind kind) -> std::string_view;
+
+struct aabb
+{
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+inline auto overlaps(const aabb& a, const aabb& b) -> bool
+{
+    return a.min.x <= b.max.x && b.min.x <= a.max.x
+        && a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+// Indices of two bounding boxes that may overlap, always with a < b
+struct broadphase_pair
+{
+    u32 a;
+    u32 b;
+
+    auto operator<=>(const broadphase_pair&) const = default;
+};
+
+// Buckets boxes into square cells and reports every pair sharing a cell. The cell
+// size should be around the diameter of the largest moving body.
+class grid_broadphase
+{
+    struct cell_item
+    {
+        u64 cell;
+        u32 index;
+
+        auto operator<=>(const cell_item&) const = default;
+    };
+
+    f32                         d_cell_size = 1.0f;
+    std::pmr::vector<cell_item> d_items;
+
+public:
+    grid_broadphase() = default;
+    explicit grid_broadphase(std::pmr::memory_resource* resource) : d_items{resource} {}
+
+    auto set_cell_size(f32 size) -> void { d_cell_size = size; }
+
+    // Appends each candidate pair to out exactly once, in ascending order
+    auto find_pairs(std::span<const aabb> bounds, std::pmr::vector<broadphase_pair>& out) -> void;
+};
+
+// Keeps the box endpoints along x sorted between calls. Bodies move very little per
+// substep, so the insertion sort does little work, and each swap of a min and max
+// endpoint starts or ends exactly one overlap, which keeps the pair set up to date
+// without a full sweep. The set is a sorted vector that the changes are merged into
+// once per call, so it stops allocating once it has grown to fit the scene.
+class sweep_and_prune
+{
+public:
+    struct endpoint
+    {
+        f32  value;
+        u32  index;
+        bool is_min;
+    };
+
+private:
+    std::pmr::vector<endpoint> d_endpoints;
+    std::pmr::vector<u64>      d_overlaps; // sorted keys of the pairs whose boxes overlap along x
+    std::pmr::vector<u64>      d_changes;  // keys of the overlaps started or ended by this call
+    std::pmr::vector<u64>      d_merged;   // scratch for merging the changes
+    std::pmr::vector<u32>      d_active;   // scratch for the sweep in rebuild
+
+    auto rebuild(std::span<const aabb> bounds) -> void;
+    auto apply_changes() -> void;
+
+public:
+    sweep_and_prune() = default;
+    explicit sweep_and_prune(std::pmr::memory_resource* resource)
+        : d_endpoints{resource}, d_overlaps{resource}, d_changes{resource}, d_merged{resource}, d_active{resource} {}
+
+    // Must be called whenever bodies are added or removed, as indices change
+    auto reset() -> void;
+
+    // Brings the endpoints and the overlap set up to date with the boxes
+    auto update(std::span<const aabb> bounds) -> void;
+
+    // Endpoints of every box sorted by value as of the last update, with mins
+    // before maxes at the same value
+    auto endpoints() const -> std::span<const endpoint> { return d_endpoints; }
+
+    // Updates, then appends each candidate pair to out exactly once, in ascending
+    // order. The set is kept sorted as it changes, so this is a walk over it.
+    auto find_pairs(std::span<const aabb> bounds, std::pmr::vector<broadphase_pair>& out) -> void;
+};
+
+}
@@ -0,0 +1,186 @@
+#include "alloc_tracker.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace snooker {
+namespace {
+
+thread_local constinit alloc_category t_category = alloc_category::other;
+thread_local constinit alloc_stats    t_stats    = {};
+
+}
+
+auto name_of(alloc_category category) -> std::string_view
+{
+    switch (category) {
+        case alloc_category::other:       return "other";
+        case alloc_category::sim_step:    return "sim";
+        case alloc_category::render_prep: return "render";
+        case alloc_category::ui:          return "ui";
+        case alloc_category::events:      return "events";
+        default:                          return "unknown";
+    }
+}
+
+auto alloc_stats::total() const -> alloc_counter
+{
+    auto result = alloc_counter{};
+    for (const auto& counter : categories) {
+        result.count += counter.count;
+        result.bytes += counter.bytes;
+    }
+    return result;
+}
+
+auto alloc_tracking_enabled() -> bool
+{
+#ifdef SNOOKER_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto thread_alloc_stats() -> const alloc_stats&
+{
+    return t_stats;
+}
+
+auto reset_thread_alloc_stats() -> void
+{
+    t_stats = {};
+}
+
+alloc_scope::alloc_scope(alloc_category category)
+    : d_previous{t_category}
+{
+    t_category = category;
+}
+
+alloc_scope::~alloc_scope()
+{
+    t_category = d_previous;
+}
+
+no_alloc_scope::no_alloc_scope(std::string_view name, std::source_location loc)
+    : d_name{name}
+    , d_loc{loc}
+    , d_start{t_stats.total().count}
+{
+}
+
+no_alloc_scope::~no_alloc_scope()
+{
+    if (!alloc_tracking_enabled()) return;
+    const auto allocations = t_stats.total().count - d_start;
+    if (allocations == 0) return;
+    assert_that(false, std::format("zero-alloc path '{}' allocated {} times", d_name, allocations), d_loc);
+}
+
+}
+
+#ifdef SNOOKER_TRACK_ALLOCATIONS
+
+// Replacement global allocation functions. The aligned forms are replaced as well,
+// as std::pmr::new_delete_resource allocates through them, and that is where the
+// simulation's containers get their memory from by default.
+namespace {
+
+auto count_alloc(std::size_t size) noexcept -> void
+{
+    auto& counter = snooker::t_stats.categories[static_cast<std::size_t>(snooker::t_category)];
+    ++counter.count;
+    counter.bytes += size;
+}
+
+auto tracked_alloc(std::size_t size) noexcept -> void*
+{
+    count_alloc(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+auto tracked_alloc(std::size_t size, std::align_val_t align) noexcept -> void*
+{
+    count_alloc(size);
+    const auto alignment = static_cast<std::size_t>(align);
+#ifdef _WIN32
+    return _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    const auto rounded = (std::max(size, std::size_t{1}) + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded);
+#endif
+}
+
+auto aligned_free(void* ptr) noexcept -> void
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+}
+
+auto operator new(std::size_t size) -> void*
+{
+    if (auto ptr = tracked_alloc(size)) return ptr;
+    throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size) -> void*
+{
+    if (auto ptr = tracked_alloc(size)) return ptr;
+    throw std::bad_alloc{};
+}
+
+auto operator new(std::size_t size, const std::nothrow_t&) noexcept -> void*
+{
+    return tracked_alloc(size);
+}
+
+auto operator new[](std::size_t size, const std::nothrow_t&) noexcept -> void*
+{
+    return tracked_alloc(size);
+}
+
+auto operator new(std::size_t size, std::align_val_t align) -> void*
+{
+    if (auto ptr = tracked_alloc(size, align)) return ptr;
+    throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size, std::align_val_t align) -> void*
+{
+    if (auto ptr = tracked_alloc(size, align)) return ptr;
+    throw std::bad_alloc{};
+}
+
+auto operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept -> void*
+{
+    return tracked_alloc(size, align);
+}
+
+auto operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept -> void*
+{
+    return tracked_alloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { aligned_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { aligned_free(ptr); }
+
+#endif
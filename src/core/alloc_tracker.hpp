@@ -0,0 +1,81 @@
+#pragma once
+#include "utility.hpp"
+
+#include <array>
+#include <string_view>
+#include <source_location>
+
+namespace snooker {
+
+// Subsystems that heap allocations are attributed to. Allocations made while no
+// alloc_scope is active on the current thread are counted as "other".
+enum class alloc_category : u8
+{
+    other,
+    sim_step,
+    render_prep,
+    ui,
+    events,
+    count,
+};
+
+auto name_of(alloc_category category) -> std::string_view;
+
+struct alloc_counter
+{
+    u64 count = 0;
+    u64 bytes = 0;
+};
+
+struct alloc_stats
+{
+    std::array<alloc_counter, static_cast<std::size_t>(alloc_category::count)> categories = {};
+
+    auto operator[](alloc_category category) const -> const alloc_counter&
+    {
+        return categories[static_cast<std::size_t>(category)];
+    }
+    auto total() const -> alloc_counter;
+};
+
+// True when the replacement operator new/delete are compiled in. Build with
+// -DSNOOKER_TRACK_ALLOCATIONS=ON to enable, otherwise all counters stay at zero.
+auto alloc_tracking_enabled() -> bool;
+
+// Counters are thread local, so these only see allocations made by the calling
+// thread since it last called reset_thread_alloc_stats.
+auto thread_alloc_stats() -> const alloc_stats&;
+auto reset_thread_alloc_stats() -> void;
+
+// Attributes all allocations on this thread to the given category while alive.
+// Scopes nest, restoring the outer category on destruction.
+class alloc_scope
+{
+    alloc_category d_previous;
+
+    alloc_scope(const alloc_scope&) = delete;
+    alloc_scope& operator=(const alloc_scope&) = delete;
+
+public:
+    explicit alloc_scope(alloc_category category);
+    ~alloc_scope();
+};
+
+// Declares a path as allocation free. If the calling thread allocates while this
+// is alive then the destructor fails an assertion, which is how benchmarks catch
+// regressions in zero-alloc paths. Does nothing when tracking is disabled.
+class no_alloc_scope
+{
+    std::string_view     d_name;
+    std::source_location d_loc;
+    u64                  d_start;
+
+    no_alloc_scope(const no_alloc_scope&) = delete;
+    no_alloc_scope& operator=(const no_alloc_scope&) = delete;
+
+public:
+    explicit no_alloc_scope(std::string_view name, std::source_location loc = std::source_location::current());
+    ~no_alloc_scope();
+};
+
+}
@@ -0,0 +1,30 @@
+#include "executor.hpp"
+
+#include <thread>
+
+namespace snooker {
+
+executor::~executor()
+{
+    while (d_outstanding > 0) {
+        if (run_main_continuations() == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+auto executor::run_main_continuations() -> std::size_t
+{
+    {
+        auto lock = std::unique_lock{d_mutex};
+        std::swap(d_main_queue, d_resuming);
+    }
+    for (const auto h : d_resuming) {
+        h.resume();
+    }
+    const auto count = d_resuming.size();
+    d_resuming.clear();
+    return count;
+}
+
+}
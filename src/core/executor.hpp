@@ -0,0 +1,227 @@
+#pragma once
+#include "task.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace snooker {
+
+template <typename T>
+using job_value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template <typename T>
+struct job_state
+{
+    std::stop_source             stop;
+    std::optional<job_value<T>>  value;
+    std::exception_ptr           error;
+    bool                         ready = false; // only touched on the main thread
+};
+
+// Handle to a task started with executor::spawn. Dropping the handle requests
+// cancellation, but the task itself decides when to stop by checking its token.
+template <typename T>
+class job
+{
+    std::shared_ptr<job_state<T>> d_state;
+
+public:
+    job() = default;
+    explicit job(std::shared_ptr<job_state<T>> state) : d_state{std::move(state)} {}
+
+    job(job&& other) noexcept = default;
+    job& operator=(job&& other) noexcept
+    {
+        if (this != &other) {
+            cancel();
+            d_state = std::move(other.d_state);
+        }
+        return *this;
+    }
+    ~job() { cancel(); }
+
+    auto valid() const -> bool { return d_state != nullptr; }
+
+    // True once the result has been delivered on the main thread
+    auto ready() const -> bool { return d_state && d_state->ready; }
+
+    auto cancel() -> void
+    {
+        if (d_state) d_state->stop.request_stop();
+    }
+
+    auto result() -> job_value<T>&
+    {
+        assert_that(ready(), "job result read before it was ready");
+        if (d_state->error) std::rethrow_exception(d_state->error);
+        return *d_state->value;
+    }
+};
+
+// Runs tasks on a thread pool and hands results back to the main thread. Inside a
+// task, "co_await exec.on_pool()" moves the rest of the coroutine onto a worker and
+// "co_await exec.on_main()" moves it back; main thread continuations only run when
+// the main thread calls run_main_continuations, which the game does once per frame.
+class executor
+{
+    thread_pool&                         d_pool;
+    std::mutex                           d_mutex;
+    std::vector<std::coroutine_handle<>> d_main_queue;
+    std::vector<std::coroutine_handle<>> d_resuming;
+    std::atomic<std::size_t>             d_outstanding = 0; // spawned jobs not yet delivered
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    template <typename T>
+    struct batch_state
+    {
+        std::atomic<std::size_t>         remaining;
+        std::coroutine_handle<>          parent;
+        std::vector<std::optional<T>>    results;
+        std::mutex                       error_mutex;
+        std::exception_ptr               error;
+
+        explicit batch_state(std::size_t count) : remaining{count}, results(count) {}
+    };
+
+    template <typename T>
+    auto run_job(task<T> t, std::shared_ptr<job_state<T>> state) -> detached_task
+    {
+        co_await on_pool();
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(t);
+                state->value.emplace();
+            } else {
+                state->value.emplace(co_await std::move(t));
+            }
+        } catch (...) {
+            state->error = std::current_exception();
+        }
+        co_await on_main();
+        state->ready = true;
+        --d_outstanding;
+    }
+
+    template <typename T>
+    auto run_batch_item(task<T> t, batch_state<T>& batch, std::size_t index) -> detached_task
+    {
+        co_await on_pool();
+        try {
+            batch.results[index].emplace(co_await std::move(t));
+        } catch (...) {
+            auto lock = std::unique_lock{batch.error_mutex};
+            if (!batch.error) batch.error = std::current_exception();
+        }
+        if (--batch.remaining == 0) batch.parent.resume();
+    }
+
+public:
+    explicit executor(thread_pool& pool) : d_pool{pool} {}
+
+    // Cancelling is cooperative, so this keeps delivering main thread continuations
+    // until every spawned job has finished. Must be called on the main thread.
+    ~executor();
+
+    auto pool() -> thread_pool& { return d_pool; }
+
+    // Continues the awaiting coroutine on a pool worker
+    auto on_pool()
+    {
+        struct awaiter
+        {
+            executor& exec;
+            auto await_ready() noexcept -> bool { return false; }
+            auto await_suspend(std::coroutine_handle<> h) -> void { exec.d_pool.submit([h] { h.resume(); }); }
+            auto await_resume() noexcept -> void {}
+        };
+        return awaiter{*this};
+    }
+
+    // Continues the awaiting coroutine during the next run_main_continuations
+    auto on_main()
+    {
+        struct awaiter
+        {
+            executor& exec;
+            auto await_ready() noexcept -> bool { return false; }
+            auto await_suspend(std::coroutine_handle<> h) -> void
+            {
+                auto lock = std::unique_lock{exec.d_mutex};
+                exec.d_main_queue.push_back(h);
+            }
+            auto await_resume() noexcept -> void {}
+        };
+        return awaiter{*this};
+    }
+
+    // Resumes every coroutine waiting to continue on the main thread and returns how
+    // many there were. Coroutines that wait again run on the next call.
+    auto run_main_continuations() -> std::size_t;
+
+    // Starts make_task(token) on the pool. The result is delivered on the main thread
+    // and the returned job becomes ready at that point.
+    template <typename Func>
+    auto spawn(Func&& make_task)
+    {
+        using task_type = std::invoke_result_t<Func, std::stop_token>;
+        using value_type = decltype(std::declval<task_type>().operator co_await().await_resume());
+
+        auto state = std::make_shared<job_state<value_type>>();
+        ++d_outstanding;
+        run_job<value_type>(std::forward<Func>(make_task)(state->stop.get_token()), state);
+        return job<value_type>{state};
+    }
+
+    // Runs every task concurrently on the pool and completes with their results in
+    // order, on whichever worker finishes last.
+    template <typename T>
+    auto when_all(std::vector<task<T>> tasks) -> task<std::vector<T>>
+    {
+        static_assert(!std::is_void_v<T>, "when_all needs tasks that produce a value");
+
+        struct awaiter
+        {
+            executor&             exec;
+            std::vector<task<T>>& tasks;
+            batch_state<T>&       batch;
+
+            auto await_ready() noexcept -> bool { return tasks.empty(); }
+            auto await_suspend(std::coroutine_handle<> h) -> bool
+            {
+                // The extra count stops the batch resuming us before every item has started
+                batch.parent = h;
+                batch.remaining = tasks.size() + 1;
+                for (std::size_t i = 0; i != tasks.size(); ++i) {
+                    exec.run_batch_item(std::move(tasks[i]), batch, i);
+                }
+                return --batch.remaining != 0;
+            }
+            auto await_resume() noexcept -> void {}
+        };
+
+        auto batch = batch_state<T>{tasks.size()};
+        co_await awaiter{*this, tasks, batch};
+        if (batch.error) std::rethrow_exception(batch.error);
+
+        auto results = std::vector<T>{};
+        results.reserve(batch.results.size());
+        for (auto& result : batch.results) {
+            results.push_back(std::move(*result));
+        }
+        co_return results;
+    }
+};
+
+}
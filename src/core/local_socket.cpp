@@ -0,0 +1,130 @@
+#include "local_socket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace snooker {
+namespace {
+
+auto make_address(std::string_view path) -> std::optional<sockaddr_un>
+{
+    auto addr = sockaddr_un{};
+    if (path.size() >= sizeof(addr.sun_path)) return std::nullopt;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return addr;
+}
+
+}
+
+local_socket::local_socket(local_socket&& other) noexcept
+    : d_fd{std::exchange(other.d_fd, -1)}
+{
+}
+
+local_socket& local_socket::operator=(local_socket&& other) noexcept
+{
+    if (this != &other) {
+        if (d_fd >= 0) ::close(d_fd);
+        d_fd = std::exchange(other.d_fd, -1);
+    }
+    return *this;
+}
+
+local_socket::~local_socket()
+{
+    if (d_fd >= 0) ::close(d_fd);
+}
+
+auto local_socket::listen(std::string_view path) -> local_socket
+{
+    const auto addr = make_address(path);
+    if (!addr) return {};
+
+    auto sock = local_socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+    if (!sock.valid()) return {};
+    ::unlink(std::string{path}.c_str());
+    if (::bind(sock.d_fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) != 0) return {};
+    if (::listen(sock.d_fd, SOMAXCONN) != 0) return {};
+    return sock;
+}
+
+auto local_socket::connect(std::string_view path) -> local_socket
+{
+    const auto addr = make_address(path);
+    if (!addr) return {};
+
+    auto sock = local_socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+    if (!sock.valid()) return {};
+    if (::connect(sock.d_fd, reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) != 0) return {};
+    return sock;
+}
+
+auto local_socket::pair() -> std::pair<local_socket, local_socket>
+{
+    int fds[2] = {-1, -1};
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return {};
+    return {local_socket{fds[0]}, local_socket{fds[1]}};
+}
+
+auto local_socket::accept() -> local_socket
+{
+    return local_socket{::accept(d_fd, nullptr, nullptr)};
+}
+
+auto local_socket::set_nonblocking() -> void
+{
+    ::fcntl(d_fd, F_SETFL, ::fcntl(d_fd, F_GETFL) | O_NONBLOCK);
+}
+
+auto local_socket::read_some(std::span<std::byte> buffer) -> std::optional<std::size_t>
+{
+    while (true) {
+        const auto n = ::recv(d_fd, buffer.data(), buffer.size(), 0);
+        if (n >= 0) return static_cast<std::size_t>(n);
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return std::nullopt;
+        return 0;
+    }
+}
+
+auto local_socket::write_some(std::span<const std::byte> buffer) -> std::optional<std::size_t>
+{
+    while (true) {
+        // MSG_NOSIGNAL so that a client disconnecting doesn't kill us with SIGPIPE
+        const auto n = ::send(d_fd, buffer.data(), buffer.size(), MSG_NOSIGNAL);
+        if (n >= 0) return static_cast<std::size_t>(n);
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return std::nullopt;
+        return 0;
+    }
+}
+
+auto local_socket::read_exact(std::span<std::byte> buffer) -> bool
+{
+    while (!buffer.empty()) {
+        const auto n = read_some(buffer);
+        if (!n || *n == 0) return false;
+        buffer = buffer.subspan(*n);
+    }
+    return true;
+}
+
+auto local_socket::write_all(std::span<const std::byte> buffer) -> bool
+{
+    while (!buffer.empty()) {
+        const auto n = write_some(buffer);
+        if (!n || *n == 0) return false;
+        buffer = buffer.subspan(*n);
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace snooker {
+
+// A Unix domain stream socket. Only built on Unix; the service tools that use it
+// aren't available on Windows. Construction can fail, so check valid().
+class local_socket
+{
+    int d_fd = -1;
+
+    local_socket(const local_socket&) = delete;
+    local_socket& operator=(const local_socket&) = delete;
+
+public:
+    local_socket() = default;
+    explicit local_socket(int fd) : d_fd{fd} {}
+    local_socket(local_socket&& other) noexcept;
+    local_socket& operator=(local_socket&& other) noexcept;
+    ~local_socket();
+
+    // Binds and listens on the path, replacing a stale socket file left behind by a
+    // previous run
+    static auto listen(std::string_view path) -> local_socket;
+    static auto connect(std::string_view path) -> local_socket;
+
+    // Two connected sockets, for talking to another thread without a path
+    static auto pair() -> std::pair<local_socket, local_socket>;
+
+    auto valid() const -> bool { return d_fd >= 0; }
+    auto fd() const -> int { return d_fd; }
+
+    // Returns an invalid socket if there is no pending connection
+    auto accept() -> local_socket;
+
+    auto set_nonblocking() -> void;
+
+    // Reads or writes as much as the socket will take without blocking. Returns
+    // nullopt if the call would block, and 0 once the peer has gone or on error.
+    auto read_some(std::span<std::byte> buffer) -> std::optional<std::size_t>;
+    auto write_some(std::span<const std::byte> buffer) -> std::optional<std::size_t>;
+
+    // Blocking helpers for clients. False if the peer went away first.
+    auto read_exact(std::span<std::byte> buffer) -> bool;
+    auto write_all(std::span<const std::byte> buffer) -> bool;
+};
+
+}
@@ -0,0 +1,63 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace snooker {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& path)
+{
+    d_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (d_file == INVALID_HANDLE_VALUE) {
+        d_file = nullptr;
+        return;
+    }
+    auto size = LARGE_INTEGER{};
+    if (!GetFileSizeEx(d_file, &size) || size.QuadPart == 0) return;
+    d_mapping = CreateFileMappingA(d_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!d_mapping) return;
+    d_data = MapViewOfFile(d_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (d_data) d_size = static_cast<std::size_t>(size.QuadPart);
+}
+
+mapped_file::~mapped_file()
+{
+    if (d_data) UnmapViewOfFile(d_data);
+    if (d_mapping) CloseHandle(d_mapping);
+    if (d_file) CloseHandle(d_file);
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& path)
+{
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info = {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        const auto size = static_cast<std::size_t>(info.st_size);
+        const auto data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            d_data = data;
+            d_size = size;
+        }
+    }
+    close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (d_data) munmap(const_cast<void*>(d_data), d_size);
+}
+
+#endif
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace snooker {
+
+// A whole file mapped read only, so that large data files can be used in place
+// without reading them into memory first. Check valid() after constructing, since
+// the file may not exist. Empty files can't be mapped and are not valid.
+class mapped_file
+{
+    const void* d_data = nullptr;
+    std::size_t d_size = 0;
+#ifdef _WIN32
+    void*       d_file    = nullptr;
+    void*       d_mapping = nullptr;
+#endif
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+public:
+    explicit mapped_file(const std::string& path);
+    ~mapped_file();
+
+    auto valid() const -> bool { return d_data != nullptr; }
+    auto data() const -> const std::byte* { return static_cast<const std::byte*>(d_data); }
+    auto size() const -> std::size_t { return d_size; }
+};
+
+}
@@ -0,0 +1,101 @@
+#include "quality_governor.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <span>
+#include <utility>
+
+namespace snooker {
+
+auto name_of(render_quality quality) -> std::string_view
+{
+    switch (quality) {
+        case render_quality::low:    return "low";
+        case render_quality::medium: return "medium";
+        case render_quality::high:   return "high";
+        default:                     return "unknown";
+    }
+}
+
+quality_governor::quality_governor(quality_governor_config config)
+    : d_config{config}
+    , d_level{config.fixed.value_or(render_quality::high)}
+    , d_probe_wait{config.probe_frames}
+{
+    assert_that(config.target_frame_time > 0.0, "the target frame time must be positive");
+    assert_that(0 < config.window && config.window <= max_window, "the decision window must hold 1 to 64 frames");
+    assert_that(config.hold_ratio <= config.miss_ratio, "a frame time can't both hold and miss the target");
+    assert_that(config.probe_frames <= config.max_probe_frames, "the probe wait can't start above its limit");
+}
+
+auto quality_governor::on_frame(f64 frame_time) -> std::optional<quality_decision>
+{
+    ++d_stats.frames;
+    if (d_config.fixed) return {};
+
+    d_frame_times[d_count++] = frame_time;
+    if (d_count != d_config.window) return {};
+    d_count = 0;
+
+    const auto frames = std::span{d_frame_times}.first(d_config.window);
+    const auto middle = frames.begin() + frames.size() / 2;
+    std::ranges::nth_element(frames, middle);
+    const auto median = *middle;
+
+    // An upgrade only stands if it still holds the target, not merely if it avoids a clear miss
+    const auto was_probing = std::exchange(d_probing, false);
+    const auto limit = (was_probing ? d_config.hold_ratio : d_config.miss_ratio) * d_config.target_frame_time;
+    auto to = d_level;
+    if (median > limit && d_level != render_quality::low) {
+        to = static_cast<render_quality>(static_cast<u8>(d_level) - 1);
+        ++d_stats.downgrades;
+        if (was_probing) {
+            ++d_stats.failed_probes;
+            d_probe_wait = std::min(2 * d_probe_wait, d_config.max_probe_frames);
+        }
+        d_held_frames = 0;
+    }
+    else if (median <= d_config.hold_ratio * d_config.target_frame_time) {
+        if (was_probing) d_probe_wait = d_config.probe_frames;
+        d_held_frames += d_config.window;
+        if (d_held_frames >= d_probe_wait && d_level != render_quality::high) {
+            to = static_cast<render_quality>(static_cast<u8>(d_level) + 1);
+            ++d_stats.upgrades;
+            d_probing = true;
+            d_held_frames = 0;
+        }
+    }
+    else {
+        d_held_frames = 0;
+    }
+
+    if (to == d_level) return {};
+    d_last_decision = quality_decision{
+        .frame=d_stats.frames, .from=d_level, .to=to, .median_frame_time=median, .probe=d_probing
+    };
+    d_level = to;
+    return d_last_decision;
+}
+
+auto parse_quality_governor_config(std::string_view text) -> std::optional<quality_governor_config>
+{
+    auto config = quality_governor_config{};
+    const auto colon = text.find(':');
+    const auto name = text.substr(0, colon);
+    if      (name == "low")    config.fixed = render_quality::low;
+    else if (name == "medium") config.fixed = render_quality::medium;
+    else if (name == "high")   config.fixed = render_quality::high;
+    else if (name != "auto")   return {};
+
+    if (colon != std::string_view::npos) {
+        if (config.fixed) return {};
+        const auto rate_text = text.substr(colon + 1);
+        auto rate = 0;
+        const auto [ptr, ec] = std::from_chars(rate_text.data(), rate_text.data() + rate_text.size(), rate);
+        if (ec != std::errc{} || ptr != rate_text.data() + rate_text.size() || rate <= 0) return {};
+        config.target_frame_time = 1.0 / rate;
+    }
+    return config;
+}
+
+}
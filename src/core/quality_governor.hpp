@@ -0,0 +1,92 @@
+#pragma once
+#include "utility.hpp"
+
+#include <array>
+#include <optional>
+#include <string_view>
+
+namespace snooker {
+
+// How much per-pixel work the renderer does, which is what limits the frame rate on
+// slow GPUs and software GL. Optional overlays are left out at the lower levels
+// as well as shading being simplified.
+enum class render_quality : u8
+{
+    low,    // hard edges, flat shaded balls with a hard edged spin dot, aim line only
+    medium, // anti-aliased edges, diffuse lit balls, ghost ball but no deflection lines
+    high,   // specular highlights, a soft edged spin dot and every aiming overlay
+};
+
+auto name_of(render_quality quality) -> std::string_view;
+
+struct quality_governor_config
+{
+    f64 target_frame_time = 1.0 / 60.0;
+    i32 window            = 30;   // frames whose median each decision is made on, at most max_window
+    f64 miss_ratio        = 1.2;  // drop a level when the median is this far over the target
+    f64 hold_ratio        = 1.05; // medians within this of the target count as holding it
+    i32 probe_frames      = 120;  // frames holding the target before trying the next level up
+    i32 max_probe_frames  = 3840; // the wait doubles after every upgrade that couldn't hold, up to this
+    std::optional<render_quality> fixed; // pins the level and turns the governor off
+};
+
+struct quality_decision
+{
+    u64            frame;
+    render_quality from;
+    render_quality to;
+    f64            median_frame_time;
+    bool           probe; // an upgrade to see whether the next level up can hold the target
+};
+
+struct quality_governor_stats
+{
+    u64 frames        = 0;
+    u64 downgrades    = 0;
+    u64 upgrades      = 0;
+    u64 failed_probes = 0; // upgrades that were undone by the next decision
+};
+
+// Picks a render quality from recent frame times. With vsync on a frame that fits
+// takes exactly the target, so there is no visible headroom to upgrade on. Instead,
+// after holding the target for a while the governor tries the next level up and
+// drops back if it misses, waiting twice as long before the next try so that a
+// machine that can't hold a level doesn't flicker between two of them. Decisions use
+// the median of a window of frames so that a single stall doesn't cost a level.
+class quality_governor
+{
+public:
+    static constexpr auto max_window = 64;
+
+private:
+    quality_governor_config d_config;
+    quality_governor_stats  d_stats;
+    render_quality          d_level;
+
+    std::array<f64, max_window> d_frame_times = {};
+    i32 d_count = 0;
+
+    i32  d_held_frames = 0;
+    i32  d_probe_wait;
+    bool d_probing = false; // the last decision was an upgrade that hasn't been judged yet
+
+    std::optional<quality_decision> d_last_decision;
+
+public:
+    explicit quality_governor(quality_governor_config config = {});
+
+    // Records a frame that took frame_time seconds, returning the decision if the
+    // level changed
+    auto on_frame(f64 frame_time) -> std::optional<quality_decision>;
+
+    auto level() const -> render_quality { return d_level; }
+    auto last_decision() const -> const std::optional<quality_decision>& { return d_last_decision; }
+    auto config() const -> const quality_governor_config& { return d_config; }
+    auto stats() const -> const quality_governor_stats& { return d_stats; }
+};
+
+// Parses "auto", "low", "medium" or "high", where auto may be followed by ":N" for a
+// target frame rate, for example "auto:30"
+auto parse_quality_governor_config(std::string_view text) -> std::optional<quality_governor_config>;
+
+}
@@ -0,0 +1,188 @@
+// Replays frame time sequences from simulated machines through quality_governor and
+// checks the level changes it makes, failing if any case doesn't match.
+//
+//   quality_governor_test
+#include "quality_governor.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <functional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+constexpr auto target = 1.0 / 60.0;
+
+// Collects the first failed expectation of a case
+struct checker
+{
+    std::string error;
+
+    auto expect(bool condition, std::string_view what) -> void
+    {
+        if (error.empty() && !condition) error = what;
+    }
+};
+
+// A machine with vsync on: a frame takes the target when the level's work fits in
+// it and its own cost when it doesn't
+struct vsync_machine
+{
+    std::array<f64, 3> cost; // seconds of work per frame at low, medium and high
+
+    auto frame_time(render_quality level) const -> f64
+    {
+        return std::max(target, cost[static_cast<u8>(level)]);
+    }
+};
+
+struct change
+{
+    u64            frame;
+    render_quality to;
+
+    auto operator==(const change&) const -> bool = default;
+};
+
+auto describe(const std::vector<change>& changes) -> std::string
+{
+    auto out = std::string{};
+    for (const auto& c : changes) out += std::format(" {}@{}", name_of(c.to), c.frame);
+    return out;
+}
+
+auto run(quality_governor& governor, const vsync_machine& machine, i32 frames) -> std::vector<change>
+{
+    auto changes = std::vector<change>{};
+    for (i32 i = 0; i != frames; ++i) {
+        if (const auto decision = governor.on_frame(machine.frame_time(governor.level()))) {
+            changes.push_back({decision->frame, decision->to});
+        }
+    }
+    return changes;
+}
+
+// Only low fits the target. The governor steps down a level per 30 frame window,
+// then probes medium after holding for 120 frames and waits twice as long after
+// each failed probe, up to 3840 frames.
+auto only_low_fits(checker& c) -> void
+{
+    using enum render_quality;
+    auto governor = quality_governor{};
+    const auto changes = run(governor, vsync_machine{{0.012, 0.025, 0.035}}, 12000);
+    const auto expected = std::vector<change>{
+        {30, medium}, {60, low},
+        {180, medium}, {210, low},     // waited 120
+        {450, medium}, {480, low},     // 240
+        {960, medium}, {990, low},     // 480
+        {1950, medium}, {1980, low},   // 960
+        {3900, medium}, {3930, low},   // 1920
+        {7770, medium}, {7800, low},   // 3840
+        {11640, medium}, {11670, low}, // 3840, the limit
+    };
+    c.expect(changes == expected, std::format("changed{}", describe(changes)));
+    c.expect(governor.stats().failed_probes == 7, std::format("{} failed probes, expected 7", governor.stats().failed_probes));
+}
+
+// Every level fits, apart from a quarter second stall once a window, which the
+// median ignores
+auto one_frame_stalls(checker& c) -> void
+{
+    auto governor = quality_governor{};
+    auto changes = 0;
+    for (i32 i = 0; i != 3000; ++i) {
+        if (governor.on_frame(i % 30 == 7 ? 0.25 : target)) ++changes;
+    }
+    c.expect(changes == 0, std::format("changed level {} times", changes));
+    c.expect(governor.level() == render_quality::high, "didn't stay on high");
+}
+
+// Running 10% over the target is between holding it and missing it, so the level
+// neither drops nor gets probed upwards
+auto slightly_over(checker& c) -> void
+{
+    auto governor = quality_governor{};
+    const auto to_medium = run(governor, vsync_machine{{0.012, 0.015, 0.025}}, 30);
+    c.expect(to_medium == std::vector<change>{{30, render_quality::medium}}, std::format("changed{}", describe(to_medium)));
+    const auto changes = run(governor, vsync_machine{{0.012, 1.1 * target, 0.025}}, 3000);
+    c.expect(changes.empty(), std::format("changed{}", describe(changes)));
+}
+
+// Once the machine frees up the next probe holds, and the wait goes back to its
+// starting length for the probe after that
+auto recovers_when_load_drops(checker& c) -> void
+{
+    using enum render_quality;
+    auto governor = quality_governor{};
+    run(governor, vsync_machine{{0.012, 0.025, 0.035}}, 500);
+    c.expect(governor.level() == low && governor.stats().failed_probes == 2, "the busy machine didn't settle on low");
+
+    // The probe due at 960 holds, and 120 frames on from there it tries high
+    const auto changes = run(governor, vsync_machine{{0.012, 0.012, 0.012}}, 1000);
+    const auto expected = std::vector<change>{{960, medium}, {1080, high}};
+    c.expect(changes == expected, std::format("changed{}", describe(changes)));
+}
+
+auto fixed_level(checker& c) -> void
+{
+    auto config = quality_governor_config{};
+    config.fixed = render_quality::medium;
+    auto governor = quality_governor{config};
+    auto changes = 0;
+    for (i32 i = 0; i != 600; ++i) {
+        if (governor.on_frame(0.1)) ++changes;
+    }
+    c.expect(changes == 0 && governor.level() == render_quality::medium, "a pinned level changed");
+}
+
+auto parsing(checker& c) -> void
+{
+    const auto low = parse_quality_governor_config("low");
+    c.expect(low && low->fixed == render_quality::low, "\"low\" didn't parse");
+    const auto half_rate = parse_quality_governor_config("auto:30");
+    c.expect(half_rate && !half_rate->fixed && half_rate->target_frame_time == 1.0 / 30, "\"auto:30\" didn't parse");
+    c.expect(!parse_quality_governor_config("auto:0"), "a zero frame rate was accepted");
+    c.expect(!parse_quality_governor_config("high:30"), "a frame rate for a pinned level was accepted");
+    c.expect(!parse_quality_governor_config("ultra"), "an unknown level was accepted");
+}
+
+struct test_case
+{
+    std::string_view                name;
+    std::function<void(checker&)>   run;
+};
+
+}
+
+auto main() -> int
+{
+    const auto cases = std::vector<test_case>{
+        {"only_low_fits",            only_low_fits},
+        {"one_frame_stalls",         one_frame_stalls},
+        {"slightly_over",            slightly_over},
+        {"recovers_when_load_drops", recovers_when_load_drops},
+        {"fixed_level",              fixed_level},
+        {"parsing",                  parsing},
+    };
+
+    auto failures = 0;
+    for (const auto& test : cases) {
+        auto c = checker{};
+        test.run(c);
+        if (c.error.empty()) {
+            std::print("ok   {}\n", test.name);
+        } else {
+            std::print("FAIL {:<24} {}\n", test.name, c.error);
+            ++failures;
+        }
+    }
+    std::print("{} of {} cases passed\n", cases.size() - failures, cases.size());
+    return failures == 0 ? 0 : 1;
+}
@@ -5,8 +5,12 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <cstddef>
+#include <span>
+#include <utility>
 
 namespace snooker {
 namespace {
@@ -27,9 +31,20 @@ out vec4  o_line_begin_colour;
 out vec4  o_line_end_colour;
 out float o_line_thickness;
 
+uniform mat4 u_proj_matrix;
+
 void main()
 {
-    gl_Position = vec4(position, 0.0, 1.0);
+    // The quad covers the segment, its thickness and a pixel for anti-aliasing
+    vec2  axis   = line_end - line_begin;
+    float len    = length(axis);
+    vec2  along  = len > 0.0 ? axis / len : vec2(1.0, 0.0);
+    vec2  across = vec2(-along.y, along.x);
+    float pad    = line_thickness + 1.0;
+    vec2  corner = (line_begin + line_end) / 2.0
+                 + position.x * (len / 2.0 + pad) * along
+                 + position.y * pad * across;
+    gl_Position = u_proj_matrix * vec4(corner, 0.0, 1.0);
 
     o_line_begin = line_begin;
     o_line_end = line_end;
@@ -50,43 +65,32 @@ in vec4  o_line_end_colour;
 in float o_line_thickness;
 
 uniform int u_camera_height;
+uniform int u_quality; // render_quality: 0 low, 1 medium, 2 high
 
-float cross2d(vec2 a, vec2 b)
+// Above low quality, edges fade over the pixel they cross rather than cutting off at
+// its centre. Distances are in pixels, so this is coverage anti-aliasing without
+// the extra samples of MSAA.
+float coverage(float signed_distance)
 {
-    return a.x * b.y - b.x * a.y;
+    return u_quality == 0 ? step(signed_distance, 0.0) : 1.0 - smoothstep(-0.5, 0.5, signed_distance);
 }
 
 void main()
 {   
     vec2 pixel = vec2(gl_FragCoord.x, u_camera_height - gl_FragCoord.y);
 
-    vec2 line_begin = o_line_begin;
-    vec2 line_end = o_line_end;
-
-    if (line_begin == line_end && distance(pixel, line_begin) < o_line_thickness) {
-        out_colour = o_line_begin_colour;
-        return;
-    }
+    // Distance to the nearest point on the segment, which also rounds the ends
+    vec2 A = o_line_end - o_line_begin;
+    vec2 B = pixel - o_line_begin;
+    float length_squared = dot(A, A);
+    float ratio_along = length_squared > 0.0 ? clamp(dot(A, B) / length_squared, 0.0, 1.0) : 0.0;
+    float distance_from_line = distance(pixel, o_line_begin + ratio_along * A);
 
-    vec2 A = line_end - line_begin;
-    vec2 B = pixel - line_begin;
-    float lengthA = length(A);
+    float alpha = coverage(distance_from_line - o_line_thickness);
+    if (alpha <= 0.0) discard;
 
-    float distance_from_line = abs(cross2d(A, B)) / lengthA;
-
-    float ratio_along = dot(A, B) / (lengthA * lengthA);
-
-    if (distance_from_line <= o_line_thickness) {
-        if (ratio_along > 0 && ratio_along < 1) {
-            out_colour = mix(o_line_begin_colour, o_line_end_colour, ratio_along);
-        } else if (ratio_along <= 0 && distance(line_begin, pixel) < o_line_thickness) {
-            out_colour = o_line_begin_colour;
-        } else if (ratio_along >= 1 && distance(line_end, pixel) < o_line_thickness) {
-            out_colour = o_line_end_colour;
-        } else {
-            out_colour = vec4(0.0);
-        }
-    }
+    vec4 colour = mix(o_line_begin_colour, o_line_end_colour, ratio_along);
+    out_colour = vec4(colour.rgb, colour.a * alpha);
 }
 )SHADER";
 
@@ -95,11 +99,10 @@ constexpr auto circle_vertex = R"SHADER(
 layout (location = 0) in vec2 position;
 
 layout (location = 1) in vec2  circle_centre;
-layout (location = 2) in float circle_inner_radius;
-layout (location = 3) in float circle_outer_radius;
-layout (location = 4) in vec4  circle_begin_colour;
-layout (location = 5) in vec4  circle_end_colour;
-layout (location = 6) in float circle_angle;
+layout (location = 2) in vec2  circle_radii; // inner, outer
+layout (location = 3) in vec4  circle_begin_colour;
+layout (location = 4) in vec4  circle_end_colour;
+layout (location = 5) in float circle_angle;
 
 out vec2  o_circle_centre;
 out float o_circle_inner_radius;
@@ -108,13 +111,16 @@ out vec4  o_circle_begin_colour;
 out vec4  o_circle_end_colour;
 out float o_circle_angle;
 
+uniform mat4 u_proj_matrix;
+
 void main()
 {
-    gl_Position = vec4(position, 0.0, 1.0);
-    
+    vec2 corner = circle_centre + position * (circle_radii.y + 1.0);
+    gl_Position = u_proj_matrix * vec4(corner, 0.0, 1.0);
+
     o_circle_centre       = circle_centre;
-    o_circle_inner_radius = circle_inner_radius;
-    o_circle_outer_radius = circle_outer_radius;
+    o_circle_inner_radius = circle_radii.x;
+    o_circle_outer_radius = circle_radii.y;
     o_circle_begin_colour = circle_begin_colour;
     o_circle_end_colour   = circle_end_colour;
     o_circle_angle        = circle_angle;
@@ -133,6 +139,7 @@ in vec4  o_circle_end_colour;
 in float o_circle_angle;
 
 uniform int u_camera_height;
+uniform int u_quality; // render_quality: 0 low, 1 medium, 2 high
 
 const float pi = 3.1415926535897932384626433832795;
 
@@ -161,6 +168,12 @@ float rotation_value(vec2 v)
     }
 }
 
+// See the line shader
+float coverage(float signed_distance)
+{
+    return u_quality == 0 ? step(signed_distance, 0.0) : 1.0 - smoothstep(-0.5, 0.5, signed_distance);
+}
+
 void main()
 {   
     vec2 frag_coord = vec2(gl_FragCoord.x, u_camera_height - gl_FragCoord.y);
@@ -168,16 +181,18 @@ void main()
 
     vec2 to_pixel = pixel - o_circle_centre;
     float from_centre = length(to_pixel);
-    
-    if (o_circle_inner_radius < from_centre && from_centre < o_circle_outer_radius) {
-        float angle_offset = o_circle_angle / (2 * pi);
-        out_colour = mix(
-            o_circle_begin_colour,
-            o_circle_end_colour,
-            rotation_value(rot(to_pixel, -o_circle_angle))
-        );
-        return;
-    }
+
+    // Solid circles have no inner edge to fade
+    float alpha = coverage(from_centre - o_circle_outer_radius);
+    if (o_circle_inner_radius > 0.0) alpha *= coverage(o_circle_inner_radius - from_centre);
+    if (alpha <= 0.0) discard;
+
+    vec4 colour = mix(
+        o_circle_begin_colour,
+        o_circle_end_colour,
+        rotation_value(rot(to_pixel, -o_circle_angle))
+    );
+    out_colour = vec4(colour.rgb, colour.a * alpha);
 }
 )SHADER";
 
@@ -189,9 +204,7 @@ layout (location = 1) in vec2  sphere_centre;
 layout (location = 2) in float sphere_radius;
 layout (location = 3) in vec4  sphere_colour;
 layout (location = 4) in vec4  sphere_dot_colour;
-layout (location = 5) in vec3  sphere_orient_col0;
-layout (location = 6) in vec3  sphere_orient_col1;
-layout (location = 7) in vec3  sphere_orient_col2;
+layout (location = 5) in vec4  sphere_orientation; // quaternion (x, y, z, w)
 
 out vec2  o_centre;
 out float o_radius;
@@ -199,14 +212,31 @@ out vec4  o_colour;
 out vec4  o_dot_colour;
 out mat3  o_orientation;
 
+uniform mat4 u_proj_matrix;
+
+// The rotation matrix of a unit quaternion, renormalised after 16 bit quantisation
+mat3 rotation(vec4 q)
+{
+    q = normalize(q);
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return mat3(
+        1.0 - 2.0 * (yy + zz), 2.0 * (xy + wz),       2.0 * (xz - wy),
+        2.0 * (xy - wz),       1.0 - 2.0 * (xx + zz), 2.0 * (yz + wx),
+        2.0 * (xz + wy),       2.0 * (yz - wx),       1.0 - 2.0 * (xx + yy)
+    );
+}
+
 void main()
 {
-    gl_Position   = vec4(position, 0.0, 1.0);
+    vec2 corner   = sphere_centre + position * (sphere_radius + 1.0);
+    gl_Position   = u_proj_matrix * vec4(corner, 0.0, 1.0);
     o_centre      = sphere_centre;
     o_radius      = sphere_radius;
     o_colour      = sphere_colour;
     o_dot_colour  = sphere_dot_colour;
-    o_orientation = mat3(sphere_orient_col0, sphere_orient_col1, sphere_orient_col2);
+    o_orientation = rotation(sphere_orientation);
 }
 )SHADER";
 
@@ -221,6 +251,7 @@ in vec4  o_dot_colour;
 in mat3  o_orientation;
 
 uniform int u_camera_height;
+uniform int u_quality; // render_quality: 0 low, 1 medium, 2 high
 
 void main()
 {
@@ -229,11 +260,15 @@ void main()
     float dist2 = dot(d, d);
     float r2    = o_radius * o_radius;
 
-    if (dist2 > r2) discard;
+    // Above low quality the silhouette fades out over the pixel straddling the edge,
+    // as in the line shader
+    float edge = u_quality == 0 ? o_radius : o_radius + 0.5;
+    if (dist2 > edge * edge) discard;
+    float coverage = u_quality == 0 ? 1.0 : 1.0 - smoothstep(-0.5, 0.5, sqrt(dist2) - o_radius);
 
     // Outward surface normal in world space (camera looks down the -z axis).
     // z is the height of the sphere surface above the table plane.
-    float z = sqrt(r2 - dist2);
+    float z = sqrt(max(r2 - dist2, 0.0));
     vec3  n = vec3(d.x, d.y, z) / o_radius;
 
     // Rotate into the ball's local frame to sample the procedural texture.
@@ -241,20 +276,27 @@ void main()
     vec3 n_local = transpose(o_orientation) * n;
 
     // Coloured dot centred on the local north pole (0, 0, 1).
-    // smoothstep gives a soft anti-aliased edge.
+    // smoothstep gives a soft anti-aliased edge, below high quality it is a hard step.
     vec3 base  = o_colour.rgb;
-    float blend = smoothstep(0.87, 0.92, n_local.z);
+    float blend = u_quality == 2 ? smoothstep(0.87, 0.92, n_local.z) : step(0.895, n_local.z);
     base = mix(base, o_dot_colour.rgb, blend);
 
-    // Diffuse + Blinn-Phong specular lighting.
+    if (u_quality == 0) {
+        out_colour = vec4(0.8 * base, 1.0);
+        return;
+    }
+
+    // Diffuse + Blinn-Phong specular lighting, the specular term at high quality only.
     // Light comes from slightly above and to the upper-left.
     vec3  light_dir = normalize(vec3(-0.3, -0.5, 1.0));
     float diffuse   = max(dot(n, light_dir), 0.0);
-    vec3  half_dir  = normalize(light_dir + vec3(0.0, 0.0, 1.0));
-    float specular  = pow(max(dot(n, half_dir), 0.0), 64.0);
-
-    vec3 lit = base * (0.25 + 0.70 * diffuse) + vec3(0.9) * specular;
-    out_colour = vec4(lit, 1.0);
+    vec3  lit       = base * (0.25 + 0.70 * diffuse);
+    if (u_quality == 2) {
+        vec3  half_dir = normalize(light_dir + vec3(0.0, 0.0, 1.0));
+        float specular = pow(max(dot(n, half_dir), 0.0), 64.0);
+        lit += vec3(0.9) * specular;
+    }
+    out_colour = vec4(lit, coverage);
 }
 )SHADER";
 
@@ -263,13 +305,12 @@ constexpr auto quad_vertex = R"SHADER(
     layout (location = 0) in vec2 p_position;
     
     layout (location = 1) in ivec2 quad_top_left;
-    layout (location = 2) in int   quad_width;
-    layout (location = 3) in int   quad_height;
-    layout (location = 4) in float quad_angle;
+    layout (location = 2) in uvec2 quad_size;
+    layout (location = 3) in uvec2 quad_uv_pos;
+    layout (location = 4) in uvec2 quad_uv_size;
     layout (location = 5) in vec4  quad_colour;
-    layout (location = 6) in int   quad_use_texture;
-    layout (location = 7) in ivec2 quad_uv_pos;
-    layout (location = 8) in ivec2 quad_uv_size;
+    layout (location = 6) in float quad_angle;
+    layout (location = 7) in uint  quad_use_texture;
     
     uniform mat4      u_proj_matrix;
     uniform sampler2D u_texture;
@@ -287,18 +328,18 @@ constexpr auto quad_vertex = R"SHADER(
     
     void main()
     {
-        vec2 dimensions = vec2(quad_width, quad_height) / 2;
+        vec2 dimensions = vec2(quad_size) / 2;
         vec2 position = quad_top_left + dimensions;
     
         vec2 screen_position = rotate(quad_angle) * (p_position * dimensions) + position;
     
         gl_Position = u_proj_matrix * vec4(screen_position, 0, 1);
     
-        o_use_texture = quad_use_texture;
+        o_use_texture = int(quad_use_texture);
         o_colour = quad_colour;
 
         o_uv = (p_position + vec2(1, 1)) / 2;
-        o_uv = (o_uv * quad_uv_size + quad_uv_pos) / textureSize(u_texture, 0);
+        o_uv = (o_uv * vec2(quad_uv_size) + vec2(quad_uv_pos)) / textureSize(u_texture, 0);
     }
 )SHADER";
     
@@ -324,6 +365,32 @@ constexpr auto quad_fragment = R"SHADER(
     }
 )SHADER";
 
+// The instance layouts in renderer.hpp
+auto pack_colour(glm::vec4 colour) -> u32
+{
+    return glm::packUnorm4x8(colour);
+}
+
+auto pack_orientation(const glm::mat3& orientation) -> glm::i16vec4
+{
+    const auto q = glm::quat_cast(orientation);
+    const auto v = glm::clamp(glm::vec4{q.x, q.y, q.z, q.w}, -1.0f, 1.0f);
+    return glm::i16vec4{glm::round(v * 32767.0f)};
+}
+
+auto make_quad(glm::vec2 top_left, float width, float height, float angle, glm::vec4 colour) -> render_quad
+{
+    return render_quad{
+        .top_left=glm::i16vec2{top_left},
+        .size=glm::u16vec2{width, height},
+        .uv_pos={0, 0},
+        .uv_size={0, 0},
+        .colour=pack_colour(colour),
+        .angle=glm::packHalf1x16(angle),
+        .use_texture=0
+    };
+}
+
 auto load_pixel_font_atlas() -> font_atlas
 {
     font_atlas atlas;
@@ -442,8 +509,8 @@ void render_line::set_buffer_attributes(std::uint32_t vbo)
     }
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(render_line), (void*)offsetof(render_line, begin));
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(render_line), (void*)offsetof(render_line, end));
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(render_line), (void*)offsetof(render_line, begin_colour));
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(render_line), (void*)offsetof(render_line, end_colour));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_line), (void*)offsetof(render_line, begin_colour));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_line), (void*)offsetof(render_line, end_colour));
     glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(render_line), (void*)offsetof(render_line, thickness));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -451,54 +518,47 @@ void render_line::set_buffer_attributes(std::uint32_t vbo)
 void render_circle::set_buffer_attributes(std::uint32_t vbo)
 {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    for (int i = 1; i != 7; ++i) {
+    for (int i = 1; i != 6; ++i) {
         glEnableVertexAttribArray(i);
         glVertexAttribDivisor(i, 1);
     }
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, centre));
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, inner_radius));
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, outer_radius));
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, begin_colour));
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, end_colour));
-    glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, angle));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, radii));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_circle), (void*)offsetof(render_circle, begin_colour));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_circle), (void*)offsetof(render_circle, end_colour));
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(render_circle), (void*)offsetof(render_circle, angle));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void render_sphere::set_buffer_attributes(std::uint32_t vbo)
 {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    for (int i = 1; i != 8; ++i) {
+    for (int i = 1; i != 6; ++i) {
         glEnableVertexAttribArray(i);
         glVertexAttribDivisor(i, 1);
     }
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)offsetof(render_sphere, centre));
     glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)offsetof(render_sphere, radius));
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)offsetof(render_sphere, colour));
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)offsetof(render_sphere, dot_colour));
-
-    // mat3 is 3 consecutive vec3 columns in memory
-    const auto off = offsetof(render_sphere, orientation);
-    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)(off));
-    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)(off + sizeof(glm::vec3)));
-    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(render_sphere), (void*)(off + 2 * sizeof(glm::vec3)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_sphere), (void*)offsetof(render_sphere, colour));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_sphere), (void*)offsetof(render_sphere, dot_colour));
+    glVertexAttribPointer(5, 4, GL_SHORT, GL_TRUE, sizeof(render_sphere), (void*)offsetof(render_sphere, orientation));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void render_quad::set_buffer_attributes(std::uint32_t vbo)
 {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    for (int i = 1; i != 9; ++i) {
+    for (int i = 1; i != 8; ++i) {
         glEnableVertexAttribArray(i);
         glVertexAttribDivisor(i, 1);
     }
-    glVertexAttribIPointer(1, 2, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, top_left));
-    glVertexAttribIPointer(2, 1, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, width));
-    glVertexAttribIPointer(3, 1, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, height));
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(render_quad), (void*)offsetof(render_quad, angle));
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(render_quad), (void*)offsetof(render_quad, colour));
-    glVertexAttribIPointer(6, 1, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, use_texture));
-    glVertexAttribIPointer(7, 2, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, uv_pos));
-    glVertexAttribIPointer(8, 2, GL_INT, sizeof(render_quad), (void*)offsetof(render_quad, uv_size));
+    glVertexAttribIPointer(1, 2, GL_SHORT, sizeof(render_quad), (void*)offsetof(render_quad, top_left));
+    glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, sizeof(render_quad), (void*)offsetof(render_quad, size));
+    glVertexAttribIPointer(3, 2, GL_UNSIGNED_SHORT, sizeof(render_quad), (void*)offsetof(render_quad, uv_pos));
+    glVertexAttribIPointer(4, 2, GL_UNSIGNED_SHORT, sizeof(render_quad), (void*)offsetof(render_quad, uv_size));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(render_quad), (void*)offsetof(render_quad, colour));
+    glVertexAttribPointer(6, 1, GL_HALF_FLOAT, GL_FALSE, sizeof(render_quad), (void*)offsetof(render_quad, angle));
+    glVertexAttribIPointer(7, 1, GL_UNSIGNED_SHORT, sizeof(render_quad), (void*)offsetof(render_quad, use_texture));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -537,6 +597,12 @@ renderer::~renderer()
     glDeleteVertexArrays(1, &d_vao);
 }
 
+auto renderer::end_frame(f64 frame_time) -> std::optional<quality_decision>
+{
+    d_last_frame_upload_bytes = std::exchange(d_upload_bytes, 0);
+    return d_governor.on_frame(frame_time);
+}
+
 void renderer::draw(i32 screen_width, i32 screen_height)
 {
     // TODO: Merge with the rest
@@ -555,6 +621,7 @@ void renderer::draw(i32 screen_width, i32 screen_height)
         d_quad_shader.bind();
         d_quad_shader.load_mat4("u_proj_matrix", projection);
         d_instances.bind<render_quad>(d_quads);
+        d_upload_bytes += std::span{d_quads}.size_bytes();
         glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (int)d_quads.size());
     
         glDisable(GL_BLEND);
@@ -568,26 +635,38 @@ void renderer::draw(i32 screen_width, i32 screen_height)
     glBlendEquation(GL_FUNC_ADD);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // Each instance's quad only covers its shape, so the fill cost follows what is on
+    // screen rather than being a full screen pass per instance
+    const auto dimensions = glm::vec2{screen_width, screen_height};
+    const auto projection = glm::ortho(0.0f, dimensions.x, dimensions.y, 0.0f);
+    const auto quality = static_cast<int>(d_governor.level());
+
     d_line_shader.bind();
     d_line_shader.load_int("u_camera_height", screen_height);
+    d_line_shader.load_int("u_quality", quality);
+    d_line_shader.load_mat4("u_proj_matrix", projection);
 
     d_circle_shader.bind();
     d_circle_shader.load_int("u_camera_height", screen_height);
-
-    const auto dimensions = glm::vec2{screen_width, screen_height};
-    const auto projection = glm::ortho(0.0f, dimensions.x, dimensions.y, 0.0f);
+    d_circle_shader.load_int("u_quality", quality);
+    d_circle_shader.load_mat4("u_proj_matrix", projection);
 
     d_line_shader.bind();
     d_instances.bind<render_line>(d_lines);
+    d_upload_bytes += std::span{d_lines}.size_bytes();
     glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (int)d_lines.size());
 
     d_circle_shader.bind();
     d_instances.bind<render_circle>(d_circles);
+    d_upload_bytes += std::span{d_circles}.size_bytes();
     glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (int)d_circles.size());
 
     d_sphere_shader.bind();
     d_sphere_shader.load_int("u_camera_height", screen_height);
+    d_sphere_shader.load_int("u_quality", quality);
+    d_sphere_shader.load_mat4("u_proj_matrix", projection);
     d_instances.bind<render_sphere>(d_spheres);
+    d_upload_bytes += std::span{d_spheres}.size_bytes();
     glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (int)d_spheres.size());
 
     glDisable(GL_BLEND);
@@ -598,53 +677,55 @@ void renderer::draw(i32 screen_width, i32 screen_height)
 
 void renderer::push_rect(glm::vec2 top_left, float width, float height, glm::vec4 colour)
 {
-    d_quads.emplace_back(top_left, width, height, 0.0f, colour, false, glm::ivec2{0, 0}, glm::ivec2{0, 0});
+    d_quads.push_back(make_quad(top_left, width, height, 0.0f, colour));
 }
 
 void renderer::push_quad(glm::vec2 centre, float width, float height, float angle, glm::vec4 colour)
 {
-    d_quads.emplace_back(centre - glm::vec2{width/2, height/2}, width, height, angle, colour, false, glm::ivec2{0, 0}, glm::ivec2{0, 0});
+    d_quads.push_back(make_quad(centre - glm::vec2{width/2, height/2}, width, height, angle, colour));
 }
 
 void renderer::push_line(glm::vec2 begin, glm::vec2 end, glm::vec4 begin_colour, glm::vec4 end_colour, float thickness)
 {
-    d_lines.emplace_back(begin, end, begin_colour, end_colour, thickness);
+    d_lines.emplace_back(begin, end, pack_colour(begin_colour), pack_colour(end_colour), thickness);
 }
 
 void renderer::push_line(glm::vec2 begin, glm::vec2 end, glm::vec4 colour, float thickness)
 {
-    d_lines.emplace_back(begin, end, colour, colour, thickness);
+    const auto packed = pack_colour(colour);
+    d_lines.emplace_back(begin, end, packed, packed, thickness);
 }
 
 void renderer::push_circle(glm::vec2 centre, glm::vec4 colour, float radius)
 {
-    d_circles.emplace_back(centre, 0.0f, radius, colour, colour, 0.0f);
+    push_annulus(centre, colour, 0.0f, radius);
 }
 
 void renderer::push_sphere(glm::vec2 centre, glm::vec4 colour, float radius, const glm::mat3& orientation, glm::vec4 dot_colour)
 {
-    d_spheres.emplace_back(centre, radius, colour, dot_colour, orientation);
+    d_spheres.emplace_back(centre, radius, pack_colour(colour), pack_colour(dot_colour), pack_orientation(orientation));
 }
 
 void renderer::push_annulus(glm::vec2 centre, glm::vec4 colour, float inner_radius, float outer_radius)
 {
-    d_circles.emplace_back(centre, inner_radius, outer_radius, colour, colour, 0.0f);
+    const auto packed = pack_colour(colour);
+    d_circles.emplace_back(centre, glm::packHalf2x16({inner_radius, outer_radius}), packed, packed, 0.0f);
 }
 
 void renderer::push_text(std::string_view message, glm::ivec2 pos, i32 size, glm::vec4 colour)
 {
+    const auto packed = pack_colour(colour);
     for (char c : message) {
         const auto ch = d_atlas.get_character(c);
 
         d_quads.push_back(render_quad{
-            pos + (size * ch.bearing),
-            size * ch.size.x,
-            size * ch.size.y,
-            0.0f,
-            colour,
-            1,
-            ch.position,
-            ch.size
+            .top_left=glm::i16vec2{pos + (size * ch.bearing)},
+            .size=glm::u16vec2{size * ch.size},
+            .uv_pos=glm::u16vec2{ch.position},
+            .uv_size=glm::u16vec2{ch.size},
+            .colour=packed,
+            .angle=glm::packHalf1x16(0.0f),
+            .use_texture=1
         });
         pos.x += size * ch.advance;
     }
@@ -4,19 +4,25 @@
 #include "camera.hpp"
 #include "utility.hpp"
 #include "font.hpp"
+#include "quality_governor.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include <memory>
 
 namespace snooker {
 
+// Instances are packed to keep the per-frame upload small: colours are 8 bit unorm
+// rgba (see glm::packUnorm4x8), sizes that stay small are half floats and ball
+// orientations are quaternions. Pixel positions stay full floats because half floats
+// step by a whole pixel past 1024, which the anti-aliased edges would show.
 struct render_line
 {
     glm::vec2 begin;
     glm::vec2 end;
-    glm::vec4 begin_colour;
-    glm::vec4 end_colour;
+    u32       begin_colour;
+    u32       end_colour;
     float     thickness;
 
     static void set_buffer_attributes(u32 vbo);
@@ -25,10 +31,9 @@ struct render_line
 struct render_circle
 {
     glm::vec2 centre;
-    float     inner_radius;
-    float     outer_radius;
-    glm::vec4 begin_colour;
-    glm::vec4 end_colour;
+    u32       radii; // inner and outer radius as half floats
+    u32       begin_colour;
+    u32       end_colour;
     float     angle;
 
     static void set_buffer_attributes(u32 vbo);
@@ -36,25 +41,24 @@ struct render_circle
 
 struct render_sphere
 {
-    glm::vec2 centre;
-    float     radius;
-    glm::vec4 colour;
-    glm::vec4 dot_colour;  // colour of the north-pole orientation marker
-    glm::mat3 orientation; // columns stored column-major; sent as 3 x vec3 attributes
+    glm::vec2    centre;
+    float        radius;
+    u32          colour;
+    u32          dot_colour;  // colour of the north-pole orientation marker
+    glm::i16vec4 orientation; // unit quaternion (x, y, z, w) as snorm16, expanded to a matrix in the vertex shader
 
     static void set_buffer_attributes(u32 vbo);
 };
 
 struct render_quad
 {
-    glm::ivec2 top_left;
-    int        width;
-    int        height;
-    float      angle;
-    glm::vec4  colour;
-    int        use_texture;
-    glm::ivec2 uv_pos;
-    glm::ivec2 uv_size;
+    glm::i16vec2 top_left;
+    glm::u16vec2 size;
+    glm::u16vec2 uv_pos;
+    glm::u16vec2 uv_size;
+    u32          colour;
+    u16          angle; // half float
+    u16          use_texture;
 
     static void set_buffer_attributes(std::uint32_t vbo);
 };
@@ -79,6 +83,11 @@ class renderer
 
     font_atlas d_atlas;
 
+    quality_governor d_governor;
+
+    std::size_t d_upload_bytes            = 0; // instance data sent so far this frame
+    std::size_t d_last_frame_upload_bytes = 0;
+
 public:
     renderer();
     ~renderer();
@@ -88,6 +97,17 @@ public:
 
     auto font() const -> const font_atlas& { return d_atlas; }
 
+    // Feeds the time the last frame took to the quality governor, returning its
+    // decision if the render quality changed. Callers can use quality() to leave
+    // out optional geometry as well.
+    auto end_frame(f64 frame_time) -> std::optional<quality_decision>;
+    auto quality() const -> render_quality { return d_governor.level(); }
+    auto governor() const -> const quality_governor& { return d_governor; }
+    void set_quality_config(const quality_governor_config& config) { d_governor = quality_governor{config}; }
+
+    // Bytes of instance data uploaded over the draws of the last complete frame
+    auto upload_bytes() const -> std::size_t { return d_last_frame_upload_bytes; }
+
     // Queues up geometry to render
     void push_rect(glm::vec2 top_left, float width, float height, glm::vec4 colour);
     void push_quad(glm::vec2 centre, float width, float height, float angle, glm::vec4 colour);
@@ -0,0 +1,103 @@
+#include "shared_memory.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace snooker {
+namespace {
+
+// POSIX names must start with a slash, Windows ones are used as is
+auto os_name(std::string_view name) -> std::string
+{
+#ifdef _WIN32
+    return std::string{name};
+#else
+    return name.starts_with('/') ? std::string{name} : "/" + std::string{name};
+#endif
+}
+
+}
+
+#ifdef _WIN32
+
+shared_memory::shared_memory(std::string_view name, std::size_t size)
+    : d_name{os_name(name)}
+    , d_owner{true}
+{
+    const auto high = static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32);
+    const auto low = static_cast<DWORD>(size & 0xffffffff);
+    d_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, high, low, d_name.c_str());
+    if (!d_handle) return;
+    d_data = MapViewOfFile(d_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (d_data) d_size = size;
+}
+
+shared_memory::shared_memory(std::string_view name)
+    : d_name{os_name(name)}
+{
+    d_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, d_name.c_str());
+    if (!d_handle) return;
+    d_data = MapViewOfFile(d_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!d_data) return;
+    auto info = MEMORY_BASIC_INFORMATION{};
+    VirtualQuery(d_data, &info, sizeof(info));
+    d_size = info.RegionSize;
+}
+
+shared_memory::~shared_memory()
+{
+    if (d_data) UnmapViewOfFile(d_data);
+    if (d_handle) CloseHandle(d_handle);
+}
+
+#else
+
+shared_memory::shared_memory(std::string_view name, std::size_t size)
+    : d_name{os_name(name)}
+    , d_owner{true}
+{
+    shm_unlink(d_name.c_str()); // start from zeroes even if a crashed run left one behind
+    const auto fd = shm_open(d_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        const auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            d_data = data;
+            d_size = size;
+        }
+    }
+    close(fd);
+}
+
+shared_memory::shared_memory(std::string_view name)
+    : d_name{os_name(name)}
+{
+    const auto fd = shm_open(d_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return;
+    struct stat info = {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        const auto size = static_cast<std::size_t>(info.st_size);
+        const auto data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            d_data = data;
+            d_size = size;
+        }
+    }
+    close(fd);
+}
+
+shared_memory::~shared_memory()
+{
+    if (d_data) munmap(d_data, d_size);
+    if (d_owner) shm_unlink(d_name.c_str());
+}
+
+#endif
+
+}
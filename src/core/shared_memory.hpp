@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace snooker {
+
+// A named block of memory that other processes can map. Uses POSIX shm_open on
+// Unix and a pagefile-backed file mapping on Windows. Mapping can fail, for example
+// when opening a name that nobody has created, so check valid() after constructing.
+class shared_memory
+{
+    std::string d_name;
+    void*       d_data  = nullptr;
+    std::size_t d_size  = 0;
+    bool        d_owner = false;
+#ifdef _WIN32
+    void*       d_handle = nullptr;
+#endif
+
+    shared_memory(const shared_memory&) = delete;
+    shared_memory& operator=(const shared_memory&) = delete;
+
+public:
+    // Creates (or replaces) a zero-filled block of the given size. The name is
+    // removed again when this is destroyed.
+    shared_memory(std::string_view name, std::size_t size);
+
+    // Opens an existing block read only
+    explicit shared_memory(std::string_view name);
+
+    ~shared_memory();
+
+    auto valid() const -> bool { return d_data != nullptr; }
+    auto data() -> void* { return d_data; }
+    auto data() const -> const void* { return d_data; }
+    auto size() const -> std::size_t { return d_size; }
+};
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace snooker {
+
+template <typename T>
+class task;
+
+namespace detail {
+
+// Hands control straight to whoever awaited the task, without growing the stack
+struct final_awaiter
+{
+    auto await_ready() noexcept -> bool { return false; }
+    template <typename Promise>
+    auto await_suspend(std::coroutine_handle<Promise> h) noexcept -> std::coroutine_handle<>
+    {
+        return h.promise().continuation;
+    }
+    auto await_resume() noexcept -> void {}
+};
+
+struct task_promise_base
+{
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr      error;
+
+    auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+    auto final_suspend() noexcept -> final_awaiter { return {}; }
+    auto unhandled_exception() -> void { error = std::current_exception(); }
+};
+
+template <typename T>
+struct task_promise : task_promise_base
+{
+    std::optional<T> value;
+
+    auto get_return_object() -> task<T>;
+    auto return_value(T v) -> void { value = std::move(v); }
+
+    auto result() -> T
+    {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct task_promise<void> : task_promise_base
+{
+    auto get_return_object() -> task<void>;
+    auto return_void() -> void {}
+
+    auto result() -> void
+    {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+}
+
+// A lazily started coroutine producing a T. Nothing runs until the task is awaited,
+// at which point it runs on the awaiting thread until it suspends; where it resumes
+// is decided by what it awaits (see executor). Exceptions propagate to the awaiter.
+template <typename T = void>
+class task
+{
+public:
+    using promise_type = detail::task_promise<T>;
+
+private:
+    std::coroutine_handle<promise_type> d_handle;
+
+public:
+    explicit task(std::coroutine_handle<promise_type> handle) : d_handle{handle} {}
+    task(task&& other) noexcept : d_handle{std::exchange(other.d_handle, {})} {}
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other) {
+            if (d_handle) d_handle.destroy();
+            d_handle = std::exchange(other.d_handle, {});
+        }
+        return *this;
+    }
+    ~task() { if (d_handle) d_handle.destroy(); }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    auto operator co_await() && noexcept
+    {
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            auto await_ready() noexcept -> bool { return false; }
+            auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<>
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            auto await_resume() -> T { return handle.promise().result(); }
+        };
+        return awaiter{d_handle};
+    }
+};
+
+template <typename T>
+auto detail::task_promise<T>::get_return_object() -> task<T>
+{
+    return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline auto detail::task_promise<void>::get_return_object() -> task<void>
+{
+    return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
+
+// A coroutine that starts immediately and frees itself when done. Only used as the
+// root of a chain of tasks, whose owner tracks completion by other means.
+struct detached_task
+{
+    struct promise_type
+    {
+        auto get_return_object() -> detached_task { return {}; }
+        auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+        auto final_suspend() noexcept -> std::suspend_never { return {}; }
+        auto return_void() -> void {}
+        auto unhandled_exception() -> void { std::terminate(); }
+    };
+};
+
+}
@@ -0,0 +1,87 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace snooker {
+
+thread_pool::thread_pool(std::size_t num_threads)
+    : d_busy_ns{std::make_unique<std::atomic<std::int64_t>[]>(num_threads)}
+{
+    d_workers.reserve(num_threads);
+    for (std::size_t i = 0; i != num_threads; ++i) {
+        d_workers.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        auto lock = std::unique_lock{d_mutex};
+        d_stopping = true;
+    }
+    d_cv.notify_all();
+    d_workers.clear(); // joins
+}
+
+auto thread_pool::worker_loop(std::size_t worker) -> void
+{
+    while (true) {
+        auto job = std::function<void()>{};
+        {
+            auto lock = std::unique_lock{d_mutex};
+            d_cv.wait(lock, [&] { return d_stopping || !d_jobs.empty(); });
+            if (d_jobs.empty()) return; // only reachable when stopping
+            job = std::move(d_jobs.front());
+            d_jobs.pop_front();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        job();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        d_busy_ns[worker].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+    }
+}
+
+auto thread_pool::submit(std::function<void()> job) -> void
+{
+    {
+        auto lock = std::unique_lock{d_mutex};
+        d_jobs.push_back(std::move(job));
+    }
+    d_cv.notify_one();
+}
+
+auto thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& job) -> void
+{
+    if (count == 0) return;
+
+    // Shared so that helpers which only get scheduled after the loop has finished
+    // can still safely see that there is nothing left to claim.
+    struct loop_state
+    {
+        std::atomic<std::size_t> next = 0;
+        std::atomic<std::size_t> done = 0;
+    };
+    auto state = std::make_shared<loop_state>();
+
+    const auto run = [state, count, &job] {
+        for (auto i = state->next++; i < count; i = state->next++) {
+            job(i);
+            if (++state->done == count) state->done.notify_all();
+        }
+    };
+
+    // The job reference stays valid because we don't return until every index
+    // has been run, and late helpers never call it.
+    const auto helpers = std::min(count - 1, size());
+    for (std::size_t i = 0; i != helpers; ++i) {
+        submit(run);
+    }
+    run();
+
+    for (auto done = state->done.load(); done != count; done = state->done.load()) {
+        state->done.wait(done);
+    }
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snooker {
+
+// A fixed set of worker threads pulling jobs from a shared queue.
+class thread_pool
+{
+    std::vector<std::jthread>         d_workers;
+    std::deque<std::function<void()>> d_jobs;
+    std::mutex                        d_mutex;
+    std::condition_variable           d_cv;
+    bool                              d_stopping = false;
+    std::unique_ptr<std::atomic<std::int64_t>[]> d_busy_ns; // per worker, time spent running jobs
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    auto worker_loop(std::size_t worker) -> void;
+
+public:
+    explicit thread_pool(std::size_t num_threads = std::thread::hardware_concurrency());
+    ~thread_pool(); // finishes all queued jobs before joining
+
+    auto size() const -> std::size_t { return d_workers.size(); }
+
+    auto submit(std::function<void()> job) -> void;
+
+    // Total time the given worker has spent running jobs, for utilisation reports
+    auto busy_time(std::size_t worker) const -> std::chrono::nanoseconds
+    {
+        return std::chrono::nanoseconds{d_busy_ns[worker].load(std::memory_order_relaxed)};
+    }
+
+    // Runs job(i) for every i in [0, count) across the workers and the calling
+    // thread, returning once every call has finished.
+    auto parallel_for(std::size_t count, const std::function<void(std::size_t)>& job) -> void;
+};
+
+}
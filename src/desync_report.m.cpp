@@ -0,0 +1,93 @@
+// Compares the replays written by the two peers of a lockstep match and explains
+// where they first disagree: either the peers played different shots (an input
+// desync), or the same shot left them in different states (a simulation desync).
+// Each replay is then re-simulated here to show which peer this build agrees with.
+//
+//   desync_report REPLAY_A REPLAY_B
+#include "match.hpp"
+#include "replay.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <format>
+#include <print>
+#include <string>
+
+using namespace snooker;
+
+namespace {
+
+auto describe(const replay_shot& s) -> std::string
+{
+    return std::format("player {} dir ({:.9g}, {:.9g}) power {:.9g} spin {:.9g} steps {} hash {:016x}",
+                       s.player, s.shot.direction.x, s.shot.direction.y, s.shot.power, s.shot.spin_factor,
+                       s.steps, s.state_hash);
+}
+
+auto same_input(const replay_shot& a, const replay_shot& b) -> bool
+{
+    return a.player == b.player
+        && a.shot.direction == b.shot.direction
+        && a.shot.power == b.shot.power
+        && a.shot.spin_factor == b.shot.spin_factor;
+}
+
+auto report_resimulation(const std::string& name, const replay& r) -> void
+{
+    if (const auto shot = verify_replay(r)) {
+        std::print("  {} diverges from this build at shot {}\n", name, *shot);
+    } else {
+        std::print("  {} reproduces all {} shots in this build\n", name, r.shots.size());
+    }
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    if (argc != 3) {
+        std::print("usage: desync_report REPLAY_A REPLAY_B\n");
+        return 2;
+    }
+    const auto a = load_replay(argv[1]);
+    const auto b = load_replay(argv[2]);
+    assert_that(a.has_value(), std::format("could not read {}", argv[1]));
+    assert_that(b.has_value(), std::format("could not read {}", argv[2]));
+
+    if (a->seed != b->seed) {
+        std::print("the replays are of different matches (seeds {} and {})\n", a->seed, b->seed);
+        return 1;
+    }
+    std::print("seed {}, {} and {} shots\n", a->seed, a->shots.size(), b->shots.size());
+
+    const auto common = std::min(a->shots.size(), b->shots.size());
+    auto first = common;
+    for (std::size_t i = 0; i != common; ++i) {
+        const auto& sa = a->shots[i];
+        const auto& sb = b->shots[i];
+        if (!same_input(sa, sb) || sa.steps != sb.steps || sa.state_hash != sb.state_hash) {
+            first = i;
+            break;
+        }
+    }
+
+    if (first == common) {
+        std::print("no desync: the first {} shots agree{}\n", common,
+                   a->shots.size() == b->shots.size() ? "" : ", and one replay stops early");
+    } else {
+        const auto& sa = a->shots[first];
+        const auto& sb = b->shots[first];
+        std::print("first difference at shot {}\n", first);
+        std::print("  a: {}\n", describe(sa));
+        std::print("  b: {}\n", describe(sb));
+        if (!same_input(sa, sb)) {
+            std::print("  the peers played different shots: input desync\n");
+        } else {
+            std::print("  the same shot gave different results: simulation desync\n");
+        }
+    }
+
+    report_resimulation(argv[1], *a);
+    report_resimulation(argv[2], *b);
+    return first == common ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// Load generator for eval_server. Each client thread keeps a fixed number of
+// requests in flight on its own connection, and the run reports the request rate
+// the server sustained and the latency from sending a request to receiving the
+// result of its last shot.
+//
+//   eval_client [--socket PATH] [--clients N] [--requests N] [--shots N]
+//               [--max-steps N] [--depth N]
+#include "eval_protocol.hpp"
+#include "local_socket.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <format>
+#include <numbers>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::string socket    = "/tmp/snooker_eval.sock";
+    i32         clients   = 8;
+    i32         requests  = 200; // per client
+    i32         shots     = 16;  // per request
+    i32         max_steps = 600;
+    i32         depth     = 2;   // requests in flight per client
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--socket")    opts.socket = value;
+        else if (flag == "--clients")   opts.clients = std::stoi(value);
+        else if (flag == "--requests")  opts.requests = std::stoi(value);
+        else if (flag == "--shots")     opts.shots = std::stoi(value);
+        else if (flag == "--max-steps") opts.max_steps = std::stoi(value);
+        else if (flag == "--depth")     opts.depth = std::stoi(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    assert_that(opts.clients > 0 && opts.requests > 0 && opts.shots > 0 && opts.depth > 0, "counts must be positive");
+    return opts;
+}
+
+// A break layout with random shots from the cue ball
+auto make_request(u32 request_id, const options& opts, std::mt19937& rng) -> eval_request
+{
+    const auto t = make_standard_table(rng());
+    auto request = eval_request{ .request_id=request_id, .max_steps=static_cast<u32>(opts.max_steps) };
+    request.cue_ball = t.sim.get(t.cue_ball.id).pos;
+    for (const auto& b : t.object_balls) {
+        request.object_balls.push_back(t.sim.get(b.id).pos);
+    }
+
+    auto angle = std::uniform_real_distribution<float>{0.0f, 2.0f * std::numbers::pi_v<float>};
+    auto power = std::uniform_real_distribution<float>{100.0f, 600.0f};
+    for (i32 i = 0; i != opts.shots; ++i) {
+        const auto a = angle(rng);
+        request.shots.push_back(cue_shot{ .direction={std::cos(a), std::sin(a)}, .power=power(rng) });
+    }
+    return request;
+}
+
+struct client_stats
+{
+    std::vector<f64> latencies_ms;
+    i32              errors = 0;
+};
+
+auto run_client(i32 index, const options& opts, client_stats& stats) -> void
+{
+    auto sock = local_socket::connect(opts.socket);
+    if (!sock.valid()) {
+        ++stats.errors;
+        return;
+    }
+
+    struct pending
+    {
+        clock_type::time_point sent;
+        std::vector<bool>      answered;
+        i32                    remaining;
+    };
+    auto in_flight = std::unordered_map<u32, pending>{};
+    auto rng = std::mt19937{static_cast<u32>(index)};
+    auto next_id = u32{0};
+    auto buffer = std::vector<std::byte>{};
+
+    const auto send_next = [&] {
+        buffer.clear();
+        const auto id = next_id++;
+        encode_eval_request(make_request(id, opts, rng), buffer);
+        in_flight[id] = {clock_type::now(), std::vector<bool>(opts.shots), opts.shots};
+        return sock.write_all(buffer);
+    };
+
+    for (i32 i = 0; i != std::min(opts.depth, opts.requests); ++i) {
+        if (!send_next()) {
+            ++stats.errors;
+            return;
+        }
+    }
+
+    auto result = eval_result{};
+    auto bytes = std::array<std::byte, sizeof(eval_result)>{};
+    auto completed = 0;
+    while (completed != opts.requests) {
+        auto consumed = std::size_t{0};
+        if (!sock.read_exact(bytes) || decode_eval_result(bytes, result, consumed) != eval_decode_status::ok) {
+            ++stats.errors;
+            return;
+        }
+
+        const auto it = in_flight.find(result.request_id);
+        if (it == in_flight.end() || result.shot_index >= it->second.answered.size()
+            || it->second.answered[result.shot_index] || !(result.flags & eval_completed)) {
+            ++stats.errors;
+            continue;
+        }
+        it->second.answered[result.shot_index] = true;
+        if (--it->second.remaining > 0) continue;
+
+        stats.latencies_ms.push_back(std::chrono::duration<f64, std::milli>(clock_type::now() - it->second.sent).count());
+        in_flight.erase(it);
+        ++completed;
+        if (static_cast<i32>(next_id) < opts.requests && !send_next()) {
+            ++stats.errors;
+            return;
+        }
+    }
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    std::print("eval_client: {} clients x {} requests of {} shots, {} in flight each, on {}\n",
+               opts.clients, opts.requests, opts.shots, opts.depth, opts.socket);
+
+    auto stats = std::vector<client_stats>(opts.clients);
+    const auto start = clock_type::now();
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (i32 i = 0; i != opts.clients; ++i) {
+            threads.emplace_back([&, i] { run_client(i, opts, stats[i]); });
+        }
+    }
+    const auto seconds = std::chrono::duration<f64>(clock_type::now() - start).count();
+
+    auto latencies = std::vector<f64>{};
+    auto errors = 0;
+    for (const auto& s : stats) {
+        latencies.insert(latencies.end(), s.latencies_ms.begin(), s.latencies_ms.end());
+        errors += s.errors;
+    }
+    if (latencies.empty()) {
+        std::print("no requests completed, is eval_server running?\n");
+        return 1;
+    }
+
+    std::ranges::sort(latencies);
+    const auto percentile = [&](f64 p) { return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))]; };
+    std::print("{} requests in {:.2f}s: {:.0f} requests/s, {:.0f} shots/s\n",
+               latencies.size(), seconds, latencies.size() / seconds, latencies.size() * opts.shots / seconds);
+    std::print("latency p50 {:.2f}ms p99 {:.2f}ms p99.9 {:.2f}ms max {:.2f}ms, {} errors\n",
+               percentile(0.5), percentile(0.99), percentile(0.999), latencies.back(), errors);
+    return errors == 0 ? 0 : 1;
+}
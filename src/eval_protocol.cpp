@@ -0,0 +1,152 @@
+#include "eval_protocol.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace snooker {
+namespace {
+
+// Every layout is evaluated on the standard table, see make_layout_table
+constexpr auto table_length = 182.88f;
+constexpr auto table_width  = 91.44f;
+
+// The jittered rack leaves neighbours up to about 0.3cm closer than touching, so
+// only centres closer than this are treated as overlapping
+constexpr auto min_ball_distance = 2.0f * ball_radius - 0.5f;
+
+template <typename T>
+auto append(std::vector<std::byte>& out, const T& value) -> void
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto offset = out.size();
+    out.resize(offset + sizeof(T));
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+auto read_at(std::span<const std::byte> buffer, std::size_t offset) -> T
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto value = T{};
+    std::memcpy(&value, buffer.data() + offset, sizeof(T));
+    return value;
+}
+
+// A centre that is a real number on the playing surface
+auto is_on_table(glm::vec2 pos) -> bool
+{
+    return std::isfinite(pos.x) && std::isfinite(pos.y)
+        && pos.x >= 0.0f && pos.x <= table_length
+        && pos.y >= 0.0f && pos.y <= table_width;
+}
+
+auto is_valid_layout(const eval_request& request) -> bool
+{
+    if (!is_on_table(request.cue_ball)) return false;
+    for (std::size_t i = 0; i != request.object_balls.size(); ++i) {
+        const auto pos = request.object_balls[i];
+        if (!is_on_table(pos) || glm::distance(pos, request.cue_ball) < min_ball_distance) return false;
+        for (std::size_t j = 0; j != i; ++j) {
+            if (glm::distance(pos, request.object_balls[j]) < min_ball_distance) return false;
+        }
+    }
+    return true;
+}
+
+}
+
+auto decode_eval_request(std::span<const std::byte> buffer, eval_request& request, std::size_t& consumed) -> eval_decode_status
+{
+    if (buffer.size() < sizeof(eval_request_header)) return eval_decode_status::incomplete;
+    const auto header = read_at<eval_request_header>(buffer, 0);
+    if (header.magic != eval_request_magic
+        || header.num_object_balls > eval_max_object_balls
+        || header.num_shots == 0 || header.num_shots > eval_max_shots
+        || header.max_steps == 0 || header.max_steps > eval_max_steps) {
+        return eval_decode_status::malformed;
+    }
+
+    const auto size = sizeof(eval_request_header)
+                    + header.num_object_balls * sizeof(eval_ball)
+                    + header.num_shots * sizeof(eval_shot);
+    if (buffer.size() < size) return eval_decode_status::incomplete;
+
+    request.request_id = header.request_id;
+    request.max_steps = header.max_steps;
+    request.cue_ball = {header.cue_x, header.cue_y};
+
+    auto offset = sizeof(eval_request_header);
+    request.object_balls.clear();
+    for (u32 i = 0; i != header.num_object_balls; ++i, offset += sizeof(eval_ball)) {
+        const auto b = read_at<eval_ball>(buffer, offset);
+        request.object_balls.push_back({b.x, b.y});
+    }
+    if (!is_valid_layout(request)) return eval_decode_status::malformed;
+
+    request.shots.clear();
+    for (u32 i = 0; i != header.num_shots; ++i, offset += sizeof(eval_shot)) {
+        const auto s = read_at<eval_shot>(buffer, offset);
+        const auto direction = glm::vec2{s.dx, s.dy};
+        const auto length = glm::length(direction);
+        if (!(length > 0.0f) || !std::isfinite(length)
+            || !(s.power >= 0.0f && s.power <= eval_max_power)
+            || !(std::abs(s.spin) <= 1.0f)) {
+            return eval_decode_status::malformed;
+        }
+        request.shots.push_back(cue_shot{ .direction=direction / length, .power=s.power, .spin_factor=s.spin });
+    }
+
+    consumed = size;
+    return eval_decode_status::ok;
+}
+
+auto encode_eval_request(const eval_request& request, std::vector<std::byte>& out) -> void
+{
+    append(out, eval_request_header{
+        .magic = eval_request_magic,
+        .request_id = request.request_id,
+        .max_steps = request.max_steps,
+        .num_object_balls = static_cast<u32>(request.object_balls.size()),
+        .num_shots = static_cast<u32>(request.shots.size()),
+        .cue_x = request.cue_ball.x,
+        .cue_y = request.cue_ball.y
+    });
+    for (const auto pos : request.object_balls) {
+        append(out, eval_ball{pos.x, pos.y});
+    }
+    for (const auto& shot : request.shots) {
+        append(out, eval_shot{shot.direction.x, shot.direction.y, shot.power, shot.spin_factor});
+    }
+}
+
+auto decode_eval_result(std::span<const std::byte> buffer, eval_result& result, std::size_t& consumed) -> eval_decode_status
+{
+    if (buffer.size() < sizeof(eval_result)) return eval_decode_status::incomplete;
+    result = read_at<eval_result>(buffer, 0);
+    if (result.magic != eval_result_magic) return eval_decode_status::malformed;
+    consumed = sizeof(eval_result);
+    return eval_decode_status::ok;
+}
+
+auto encode_eval_result(u32 request_id, u32 shot_index, const rollout_result& result, std::vector<std::byte>& out) -> void
+{
+    auto flags = u32{0};
+    if (result.completed) flags |= eval_completed;
+    if (result.cue_ball_in_pocket) flags |= eval_cue_ball_in_pocket;
+    append(out, eval_result{
+        .magic = eval_result_magic,
+        .request_id = request_id,
+        .shot_index = shot_index,
+        .flags = flags,
+        .steps = static_cast<u32>(result.steps),
+        .balls_potted = static_cast<u32>(result.balls_potted)
+    });
+}
+
+auto make_eval_table(const eval_request& request) -> table
+{
+    return make_layout_table(request.cue_ball, request.object_balls);
+}
+
+}
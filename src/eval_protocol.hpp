@@ -0,0 +1,95 @@
+#pragma once
+#include "rollout.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace snooker {
+
+// Binary protocol of the shot evaluation service. Messages are the structs below
+// written back to back in host byte order, since client and server share a machine.
+//
+// A request is an eval_request_header followed by num_object_balls eval_ball
+// positions and then num_shots eval_shot entries. The server answers with one
+// eval_result per shot, in whatever order the shots finish. Requests with a ball
+// off the table or overlapping another, or a shot harder than eval_max_power, are
+// malformed.
+constexpr auto eval_request_magic = u32{0x51455645}; // "EVEQ"
+constexpr auto eval_result_magic  = u32{0x53455645}; // "EVES"
+constexpr auto eval_max_object_balls = u32{32};
+constexpr auto eval_max_shots        = u32{4096};
+constexpr auto eval_max_steps        = u32{60 * 60 * 5};
+constexpr auto eval_max_power        = break_speed; // the fastest the game ever strikes the cue ball
+
+struct eval_request_header
+{
+    u32 magic;
+    u32 request_id;
+    u32 max_steps;
+    u32 num_object_balls;
+    u32 num_shots;
+    f32 cue_x;
+    f32 cue_y;
+};
+
+struct eval_ball
+{
+    f32 x;
+    f32 y;
+};
+
+struct eval_shot
+{
+    f32 dx;
+    f32 dy;
+    f32 power;
+    f32 spin;
+};
+
+enum eval_result_flags : u32
+{
+    eval_completed          = 1 << 0,
+    eval_cue_ball_in_pocket = 1 << 1,
+};
+
+struct eval_result
+{
+    u32 magic;
+    u32 request_id;
+    u32 shot_index;
+    u32 flags;
+    u32 steps;
+    u32 balls_potted;
+};
+
+struct eval_request
+{
+    u32                    request_id = 0;
+    u32                    max_steps  = 60 * 60;
+    glm::vec2              cue_ball;
+    std::vector<glm::vec2> object_balls;
+    std::vector<cue_shot>  shots;
+};
+
+enum class eval_decode_status
+{
+    ok,
+    incomplete, // need more bytes
+    malformed,  // the stream can't be trusted any further
+};
+
+// Decodes the request at the front of the buffer, setting consumed to its size
+auto decode_eval_request(std::span<const std::byte> buffer, eval_request& request, std::size_t& consumed) -> eval_decode_status;
+auto encode_eval_request(const eval_request& request, std::vector<std::byte>& out) -> void;
+
+auto decode_eval_result(std::span<const std::byte> buffer, eval_result& result, std::size_t& consumed) -> eval_decode_status;
+auto encode_eval_result(u32 request_id, u32 shot_index, const rollout_result& result, std::vector<std::byte>& out) -> void;
+
+auto make_eval_table(const eval_request& request) -> table;
+
+}
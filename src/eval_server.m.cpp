@@ -0,0 +1,380 @@
+// Shot evaluation service for bots. Listens on a Unix domain socket for requests
+// holding a ball layout and a list of shots (see eval_protocol.hpp), plays every shot
+// out headlessly and streams back one result per shot as soon as it finishes.
+//
+//   eval_server [--socket PATH] [--threads N] [--max-batch N] [--max-queued N]
+//               [--max-input BYTES] [--max-output BYTES]
+//
+// Shots from all clients go into one queue. A dispatcher thread takes up to
+// max-batch of them at a time, round robin across clients so that a client with a
+// huge request can't hold up everyone else, and runs the batch across the pool.
+// Shots that arrive while a batch runs are coalesced into the next one. Once more
+// than max-queued shots are waiting the server stops reading from clients, which
+// bounds both memory and how long a newly accepted shot can sit in the queue.
+// Requests beyond that wait undecoded in the client's input buffer, which holds at
+// most max-input bytes, and the rest wait in the socket. A client that lets more
+// than max-output bytes of results pile up unread is disconnected.
+#include "eval_protocol.hpp"
+#include "local_socket.hpp"
+#include "rollout.hpp"
+#include "table.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <format>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace snooker;
+
+namespace {
+
+struct options
+{
+    std::string socket     = "/tmp/snooker_eval.sock";
+    std::size_t threads    = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t max_batch  = 256;
+    std::size_t max_queued = 8192;
+    std::size_t max_input  = 256 * 1024;
+    std::size_t max_output = 4 * 1024 * 1024;
+};
+
+// The largest request the decoder accepts, which has to fit in the input buffer
+constexpr auto max_request_size = sizeof(eval_request_header)
+                                + eval_max_object_balls * sizeof(eval_ball)
+                                + eval_max_shots * sizeof(eval_shot);
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--socket")     opts.socket = value;
+        else if (flag == "--threads")    opts.threads = std::stoul(value);
+        else if (flag == "--max-batch")  opts.max_batch = std::stoul(value);
+        else if (flag == "--max-queued") opts.max_queued = std::stoul(value);
+        else if (flag == "--max-input")  opts.max_input = std::stoul(value);
+        else if (flag == "--max-output") opts.max_output = std::stoul(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    assert_that(opts.threads > 0 && opts.max_batch > 0, "need at least one thread and a non-empty batch");
+    assert_that(opts.max_input >= max_request_size, std::format("max input must hold a full request of {} bytes", max_request_size));
+    return opts;
+}
+
+// One shot to play out. The table is shared by every shot of a request and each
+// rollout works on its own copy.
+struct eval_item
+{
+    u64                          client;
+    u32                          request_id;
+    u32                          shot_index;
+    i32                          max_steps;
+    std::shared_ptr<const table> layout;
+    cue_shot                     shot;
+};
+
+struct eval_done
+{
+    u64            client;
+    u32            request_id;
+    u32            shot_index;
+    rollout_result result;
+};
+
+// Coalesces queued shots into batches and runs them on the pool. Finished shots are
+// handed back through a completion queue, and a byte written to the wake pipe tells
+// the network thread to collect them.
+class dispatcher
+{
+    thread_pool&                          d_pool;
+    std::size_t                           d_max_batch;
+    int                                   d_wake_fd;
+
+    std::mutex                            d_mutex;
+    std::condition_variable               d_cv;
+    std::map<u64, std::deque<eval_item>>  d_queues; // per client, so batches can be fair
+    std::size_t                           d_queued = 0;
+    bool                                  d_stopping = false;
+
+    std::mutex                            d_done_mutex;
+    std::vector<eval_done>                d_done;
+
+    std::atomic<u64>                      d_batches = 0;
+    std::atomic<u64>                      d_batched_shots = 0;
+    std::jthread                          d_thread;
+
+    auto take_batch(std::vector<eval_item>& batch) -> bool
+    {
+        auto lock = std::unique_lock{d_mutex};
+        d_cv.wait(lock, [&] { return d_stopping || d_queued > 0; });
+        if (d_stopping) return false;
+
+        // One shot from each client in turn until the batch is full
+        while (batch.size() < d_max_batch && d_queued > 0) {
+            for (auto it = d_queues.begin(); it != d_queues.end() && batch.size() < d_max_batch;) {
+                batch.push_back(std::move(it->second.front()));
+                it->second.pop_front();
+                --d_queued;
+                it = it->second.empty() ? d_queues.erase(it) : std::next(it);
+            }
+        }
+        return true;
+    }
+
+    auto run() -> void
+    {
+        auto batch = std::vector<eval_item>{};
+        while (take_batch(batch)) {
+            d_pool.parallel_for(batch.size(), [&](std::size_t i) {
+                const auto& item = batch[i];
+                auto done = eval_done{item.client, item.request_id, item.shot_index, rollout(*item.layout, item.shot, item.max_steps)};
+                {
+                    auto lock = std::unique_lock{d_done_mutex};
+                    d_done.push_back(done);
+                }
+                const auto byte = char{1};
+                [[maybe_unused]] const auto n = ::write(d_wake_fd, &byte, 1); // a full pipe already means "wake up"
+            });
+            ++d_batches;
+            d_batched_shots += batch.size();
+            batch.clear();
+        }
+    }
+
+public:
+    dispatcher(thread_pool& pool, std::size_t max_batch, int wake_fd)
+        : d_pool{pool}
+        , d_max_batch{max_batch}
+        , d_wake_fd{wake_fd}
+        , d_thread{[this] { run(); }}
+    {}
+
+    ~dispatcher()
+    {
+        {
+            auto lock = std::unique_lock{d_mutex};
+            d_stopping = true;
+        }
+        d_cv.notify_one();
+    }
+
+    auto push(std::vector<eval_item>& items) -> void
+    {
+        {
+            auto lock = std::unique_lock{d_mutex};
+            for (auto& item : items) {
+                d_queues[item.client].push_back(std::move(item));
+            }
+            d_queued += items.size();
+        }
+        items.clear();
+        d_cv.notify_one();
+    }
+
+    // Drops any shots of a client that has gone away and haven't started yet
+    auto forget(u64 client) -> void
+    {
+        auto lock = std::unique_lock{d_mutex};
+        if (const auto it = d_queues.find(client); it != d_queues.end()) {
+            d_queued -= it->second.size();
+            d_queues.erase(it);
+        }
+    }
+
+    auto queued() -> std::size_t
+    {
+        auto lock = std::unique_lock{d_mutex};
+        return d_queued;
+    }
+
+    auto take_done(std::vector<eval_done>& out) -> void
+    {
+        auto lock = std::unique_lock{d_done_mutex};
+        std::swap(out, d_done);
+    }
+
+    auto batches() const -> u64 { return d_batches; }
+    auto batched_shots() const -> u64 { return d_batched_shots; }
+};
+
+struct connection
+{
+    local_socket           sock;
+    std::vector<std::byte> input;
+    std::vector<std::byte> output;
+    std::size_t            output_sent = 0;
+};
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+
+    auto listener = local_socket::listen(opts.socket);
+    assert_that(listener.valid(), std::format("could not listen on {}", opts.socket));
+    listener.set_nonblocking();
+
+    int wake[2] = {-1, -1};
+    assert_that(::pipe(wake) == 0, "could not create wake pipe");
+    for (const auto fd : wake) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    // The pool's workers plus the dispatcher thread, which joins in on each batch
+    auto pool = thread_pool{opts.threads - 1};
+    auto batches = dispatcher{pool, opts.max_batch, wake[1]};
+    std::print("eval_server: listening on {} with {} threads, batches of up to {} shots\n",
+               opts.socket, opts.threads, opts.max_batch);
+
+    auto connections = std::map<u64, connection>{};
+    auto next_client = u64{1};
+    auto requests = u64{0};
+    auto shots = u64{0};
+    auto last_report = std::chrono::steady_clock::now();
+
+    auto fds = std::vector<pollfd>{};
+    auto ids = std::vector<u64>{};
+    auto request = eval_request{};
+    auto items = std::vector<eval_item>{};
+    auto done = std::vector<eval_done>{};
+    auto chunk = std::vector<std::byte>(64 * 1024);
+
+    while (true) {
+        const auto accepting = batches.queued() < opts.max_queued;
+
+        fds.clear();
+        ids.clear();
+        fds.push_back({listener.fd(), POLLIN, 0});
+        fds.push_back({wake[0], POLLIN, 0});
+        for (const auto& [id, conn] : connections) {
+            auto events = short{0};
+            if (accepting && conn.input.size() < opts.max_input) events |= POLLIN;
+            if (conn.output_sent < conn.output.size()) events |= POLLOUT;
+            fds.push_back({conn.sock.fd(), events, 0});
+            ids.push_back(id);
+        }
+        ::poll(fds.data(), fds.size(), 1000);
+
+        if (fds[0].revents & POLLIN) {
+            for (auto sock = listener.accept(); sock.valid(); sock = listener.accept()) {
+                sock.set_nonblocking();
+                connections.emplace(next_client++, connection{ .sock=std::move(sock) });
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            while (::read(wake[0], chunk.data(), chunk.size()) > 0) {}
+            batches.take_done(done);
+            for (const auto& d : done) {
+                const auto it = connections.find(d.client);
+                if (it == connections.end()) continue;
+                encode_eval_result(d.request_id, d.shot_index, d.result, it->second.output);
+            }
+            done.clear();
+        }
+
+        for (std::size_t i = 0; i != ids.size(); ++i) {
+            const auto id = ids[i];
+            auto& conn = connections.at(id);
+            auto closed = (fds[i + 2].revents & (POLLERR | POLLNVAL)) != 0;
+
+            if (!closed && (fds[i + 2].revents & (POLLIN | POLLHUP))) {
+                // Only read up to max_input buffered bytes, the rest waits in the socket
+                auto budget = opts.max_input - std::min(conn.input.size(), opts.max_input);
+                while (budget > 0) {
+                    const auto n = conn.sock.read_some(std::span{chunk}.first(std::min(chunk.size(), budget)));
+                    if (!n) break;
+                    if (*n == 0) {
+                        closed = true;
+                        break;
+                    }
+                    conn.input.insert(conn.input.end(), chunk.begin(), chunk.begin() + *n);
+                    budget -= *n;
+                }
+            }
+
+            // Turn complete requests in the buffer into queued shots while the queue has
+            // room. Whatever is left is decoded on a later pass, once shots have finished.
+            if (!closed && !conn.input.empty()) {
+                const auto queued = batches.queued();
+                auto offset = std::size_t{0};
+                while (!closed && queued + items.size() < opts.max_queued) {
+                    auto consumed = std::size_t{0};
+                    const auto status = decode_eval_request(std::span{conn.input}.subspan(offset), request, consumed);
+                    if (status == eval_decode_status::incomplete) break;
+                    if (status == eval_decode_status::malformed) {
+                        std::print("client {} sent a malformed request, disconnecting\n", id);
+                        closed = true;
+                        break;
+                    }
+                    offset += consumed;
+
+                    const auto layout = std::make_shared<const table>(make_eval_table(request));
+                    for (std::size_t s = 0; s != request.shots.size(); ++s) {
+                        items.push_back({id, request.request_id, static_cast<u32>(s), static_cast<i32>(request.max_steps), layout, request.shots[s]});
+                    }
+                    ++requests;
+                    shots += request.shots.size();
+                }
+                conn.input.erase(conn.input.begin(), conn.input.begin() + offset);
+                if (!items.empty()) batches.push(items);
+            }
+
+            if (!closed && conn.output_sent < conn.output.size()) {
+                while (conn.output_sent < conn.output.size()) {
+                    const auto n = conn.sock.write_some(std::span{conn.output}.subspan(conn.output_sent));
+                    if (!n) break;
+                    if (*n == 0) {
+                        closed = true;
+                        break;
+                    }
+                    conn.output_sent += *n;
+                }
+                if (conn.output_sent == conn.output.size()) {
+                    conn.output.clear();
+                    conn.output_sent = 0;
+                }
+            }
+
+            if (!closed && conn.output.size() - conn.output_sent > opts.max_output) {
+                std::print("client {} is not reading its results, disconnecting\n", id);
+                closed = true;
+            }
+
+            if (closed) {
+                batches.forget(id);
+                connections.erase(id);
+            }
+        }
+
+        if (const auto now = std::chrono::steady_clock::now(); now - last_report > std::chrono::seconds{5}) {
+            const auto seconds = std::chrono::duration<f64>(now - last_report).count();
+            const auto num_batches = batches.batches();
+            std::print("  {} clients, {:.0f} requests/s, {:.0f} shots/s, {} queued, mean batch {:.1f}\n",
+                       connections.size(), requests / seconds, shots / seconds, batches.queued(),
+                       num_batches ? static_cast<f64>(batches.batched_shots()) / num_batches : 0.0);
+            last_report = now;
+            requests = 0;
+            shots = 0;
+        }
+    }
+}
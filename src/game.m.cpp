@@ -3,10 +3,18 @@
 #include "utility.hpp"
 #include "renderer.hpp"
 #include "ui.hpp"
+#include "alloc_tracker.hpp"
+#include "executor.hpp"
+#include "thread_pool.hpp"
 #include "collision.hpp"
 
 #include "table.hpp"
+#include "table_view.hpp"
 #include "simulation.hpp"
+#include "rollout.hpp"
+#include "state_export.hpp"
+#include "step_clock.hpp"
+#include "rewind.hpp"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
@@ -14,6 +22,7 @@
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <format>
 #include <print>
 #include <initializer_list>
@@ -25,6 +34,8 @@
 #include <unordered_set>
 #include <source_location>
 #include <random>
+#include <cstdlib>
+#include <thread>
 
 using namespace snooker;
 
@@ -35,15 +46,14 @@ enum class next_state
     exit,
 };
 
-struct table_dimensions
+// Render quality changes are rare, so each one is logged
+auto log_quality_decision(const std::optional<snooker::quality_decision>& decision) -> void
 {
-    float border_width;
-    float centre_pocket_radius;
-    float corner_pocket_radius;
-    
-    float centre_pocket_offset;
-    float centre_pocket_back_pinch;
-};
+    if (!decision) return;
+    std::print("render quality {} -> {} at frame {}, median frame time {:.1f}ms{}\n",
+               snooker::name_of(decision->from), snooker::name_of(decision->to), decision->frame,
+               1000.0 * decision->median_frame_time, decision->probe ? " (probing)" : "");
+}
 
 auto scene_main_menu(snooker::window& window, snooker::renderer& renderer) -> next_state
 {
@@ -104,129 +114,6 @@ auto scene_main_menu(snooker::window& window, snooker::renderer& renderer) -> ne
     return next_state::exit;
 }
 
-auto add_triangle(table& t, glm::vec2 front_pos) -> void
-{
-    const auto left = glm::vec2{std::sqrt(3) * ball_radius, -ball_radius};
-    const auto down = glm::vec2{0, 2 * ball_radius};
-
-    const auto red = glm::vec4{1, 0, 0, 1};
-    const auto yel = glm::vec4{1, 1, 0, 1};
-    const auto blk = glm::vec4{0, 0, 0, 1};
-
-    // small random positional jitter so each break plays out differently
-    auto rng    = std::mt19937{std::random_device{}()};
-    auto jitter = std::uniform_real_distribution<float>{-0.1f, 0.1f};
-    auto j      = [&] { return glm::vec2{jitter(rng), jitter(rng)}; };
-
-    t.add_ball(front_pos + 0.0f * left + 0.0f * down + j(), red);
-
-    t.add_ball(front_pos + 1.0f * left + 0.0f * down + j(), red);
-    t.add_ball(front_pos + 1.0f * left + 1.0f * down + j(), yel);
-
-    t.add_ball(front_pos + 2.0f * left + 0.0f * down + j(), yel);
-    t.add_ball(front_pos + 2.0f * left + 1.0f * down + j(), blk);
-    t.add_ball(front_pos + 2.0f * left + 2.0f * down + j(), red);
-
-    t.add_ball(front_pos + 3.0f * left + 0.0f * down + j(), red);
-    t.add_ball(front_pos + 3.0f * left + 1.0f * down + j(), yel);
-    t.add_ball(front_pos + 3.0f * left + 2.0f * down + j(), red);
-    t.add_ball(front_pos + 3.0f * left + 3.0f * down + j(), yel);
-
-    t.add_ball(front_pos + 4.0f * left + 0.0f * down + j(), yel);
-    t.add_ball(front_pos + 4.0f * left + 1.0f * down + j(), yel);
-    t.add_ball(front_pos + 4.0f * left + 2.0f * down + j(), red);
-    t.add_ball(front_pos + 4.0f * left + 3.0f * down + j(), yel);
-    t.add_ball(front_pos + 4.0f * left + 4.0f * down + j(), red);
-}
-
-auto add_chain(table& t, const std::vector<glm::vec2>& points)
-{
-    assert_that(points.size() >= 2, "chain requires 2 points");
-    for (std::size_t i = 0; i != points.size() - 1; ++i) {
-        t.border_boxes.push_back(t.sim.add_static_line(points[i], points[i+1]));
-    }
-    t.border_boxes.push_back(t.sim.add_static_line(points.back(), points.front()));
-}
-
-auto add_border(table& t) -> void
-{
-    static constexpr auto cfg = table_dimensions{
-        .border_width = 4.0f,
-        .centre_pocket_radius = 6.0f,
-        .corner_pocket_radius = 7.0f,
-        .centre_pocket_offset = 3.0f,
-        .centre_pocket_back_pinch = 2.0f
-    };
-
-    t.add_pocket({0.0f,            0.0f}, cfg.corner_pocket_radius);
-    t.add_pocket({t.length / 2.0f, -cfg.centre_pocket_offset}, cfg.centre_pocket_radius);
-    t.add_pocket({t.length,        0.0f}, cfg.corner_pocket_radius);
-
-    t.add_pocket({0.0f,            t.width}, cfg.corner_pocket_radius);
-    t.add_pocket({t.length / 2.0f, t.width + cfg.centre_pocket_offset}, cfg.centre_pocket_radius);
-    t.add_pocket({t.length,        t.width}, cfg.corner_pocket_radius);
-
-    add_chain(t, std::vector<glm::vec2>{
-        // top left pocket
-        glm::vec2{cfg.border_width, cfg.corner_pocket_radius + cfg.border_width},
-        glm::vec2{-cfg.corner_pocket_radius, 0},
-        glm::vec2{0, -cfg.corner_pocket_radius},
-        glm::vec2{cfg.corner_pocket_radius + cfg.border_width, cfg.border_width},
-
-        // top centre pocket
-        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius, cfg.border_width},
-        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius + cfg.centre_pocket_back_pinch, -cfg.border_width},
-        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius - cfg.centre_pocket_back_pinch, -cfg.border_width},
-        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius, cfg.border_width},
-
-        // top right pocket
-        glm::vec2{t.length - cfg.corner_pocket_radius - cfg.border_width, cfg.border_width},
-        glm::vec2{t.length, -cfg.corner_pocket_radius},
-        glm::vec2{t.length + cfg.corner_pocket_radius, 0},
-        glm::vec2{t.length - cfg.border_width, cfg.corner_pocket_radius + cfg.border_width},
-
-        // bottom right pocket
-        glm::vec2{t.length - cfg.border_width, t.width - cfg.corner_pocket_radius - cfg.border_width},
-        glm::vec2{t.length + cfg.corner_pocket_radius, t.width},
-        glm::vec2{t.length, t.width + cfg.corner_pocket_radius},
-        glm::vec2{t.length - cfg.corner_pocket_radius - cfg.border_width, t.width - cfg.border_width},
-
-        // bottom centre pocket
-        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius, t.width - cfg.border_width},
-        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius - cfg.centre_pocket_back_pinch, t.width + cfg.border_width},
-        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius + cfg.centre_pocket_back_pinch, t.width + cfg.border_width},
-        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius, t.width - cfg.border_width},
-
-        // bottom left pocket
-        glm::vec2{cfg.corner_pocket_radius + cfg.border_width, t.width - cfg.border_width},
-        glm::vec2{0, t.width + cfg.corner_pocket_radius},
-        glm::vec2{-cfg.corner_pocket_radius, t.width},
-        glm::vec2{cfg.border_width, t.width - cfg.corner_pocket_radius - cfg.border_width},
-    });
-}
-
-auto cue_trajectory_single_check(ray r, float radius, const collider& other) -> std::optional<float>
-{
-    return std::visit(overloaded{
-        // To cast a circle at another circle is the same as casting a point at a circle with the radius sum
-        [&](const circle_shape& shape) -> std::optional<float> {
-            const auto c = circle{.centre=other.pos, .radius=shape.radius};
-            return ray_cast(r, inflate(c, radius));
-        },
-        [&](const box_shape& shape) -> std::optional<float> {
-            const auto b = box{.centre=other.pos, .width=shape.width, .height=shape.height};
-            return ray_cast(r, inflate(b, radius));
-        },
-        [&](const line_shape& shape) -> std::optional<float> {
-            const auto l = line{.start=other.pos + shape.start, .end=other.pos+shape.end};
-            return ray_cast(r, inflate(l, radius));
-        },
-        [](auto&&) -> std::optional<float> {
-            return {};
-        }
-    }, other.shape);
-}
-
 struct trajectory
 {
     float       distance;
@@ -238,22 +125,12 @@ auto cue_trajectory(const table& t, glm::vec2 start, glm::vec2 dir) -> std::opti
     assert_that(std::holds_alternative<circle_shape>(t.sim.get(t.cue_ball.id).shape), "cue ball must be a circle");
     const auto cue_ball_radius = std::get<circle_shape>(t.sim.get(t.cue_ball.id).shape).radius;
 
-    auto best = std::optional<trajectory>{};
+    const auto hit = t.sim.raycast(ray{.start=start, .dir=dir}, cue_ball_radius, t.cue_ball.id);
+    if (!hit) return {};
 
-    const auto r = ray{.start=start, .dir=dir};
-
-    for (const auto& ball : t.object_balls) {
-        if (const auto R = cue_trajectory_single_check(r, cue_ball_radius, t.sim.get(ball.id))) {
-            if (!best || *R < best->distance) best = { *R, ball.id };
-        }
-    }
-    for (const auto& id : t.border_boxes) {
-        if (const auto R = cue_trajectory_single_check(r, cue_ball_radius, t.sim.get(id))) {
-            if (!best || *R < best->distance) best = { *R, {} };
-        }
-    }
-
-    return best;
+    // Only balls are reported as hit objects, cushions leave it empty
+    const auto hit_ball = std::holds_alternative<dynamic_body>(t.sim.get(hit->id).body);
+    return trajectory{ hit->distance, hit_ball ? hit->id : std::size_t{} };
 }
 
 class converter
@@ -270,6 +147,8 @@ public:
     auto to_board(glm::vec2 value) const -> glm::vec2 { return value / d_board_to_screen - d_top_left; }
     auto to_screen(glm::vec2 value) const -> glm::vec2 { return (d_top_left + value) * d_board_to_screen; }
     auto to_screen(float value) const -> float { return value * d_board_to_screen; }
+
+    auto viewport() const -> table_viewport { return {to_screen(glm::vec2{0.0f, 0.0f}), d_board_to_screen}; }
 };
 
 auto adjust_alpha(glm::vec4 colour, float alpha) -> glm::vec4
@@ -293,17 +172,72 @@ auto scene_game(snooker::window& window, snooker::renderer& renderer) -> next_st
     auto timer    = snooker::timer{};
     auto ui       = snooker::ui_engine{&renderer};
 
-    auto t = table{182.88f, 91.44f}; // english pool table dimensions in cm (6ft x 3ft)
-    t.set_cue_ball({50.0f, t.width / 2.0f});
-    add_triangle(t, {0.8f * t.length, t.width / 2.0f});
-    add_border(t); // TODO: replace with a better construction
+    auto t = make_standard_table(std::random_device{}());
     
     auto cue = std::optional<shot>{};
 
-    double accumulator = 0.0;
+    // Background work for the scene. The executor is declared after the pool so that
+    // it is destroyed first, which waits for any jobs still in flight.
+    auto pool = thread_pool{std::max(2u, std::thread::hardware_concurrency()) - 1};
+    auto exec = executor{pool};
+
+    // Outcome of the aimed shot at a few different powers, refreshed when the aim moves
+    constexpr auto preview_powers = std::array{100.0f, 200.0f, 300.0f, 400.0f};
+    auto preview = job<std::vector<rollout_result>>{};
+    auto preview_direction = glm::vec2{0.0f, 0.0f};
+
+    // Live state for external tools, published after every step when enabled by
+    // setting SNOOKER_STATE_EXPORT to the name of the shared memory segment
+    auto exporter = std::optional<state_exporter>{};
+    if (const auto name = std::getenv("SNOOKER_STATE_EXPORT")) {
+        exporter.emplace(name);
+        if (!exporter->valid()) {
+            std::print("could not create state export segment {}\n", name);
+            exporter.reset();
+        }
+    }
+    auto shot_counter = u64{0};
+
+    // Steps per frame are capped so a hitch doesn't snowball. SNOOKER_CATCH_UP picks
+    // what happens to the time that didn't fit, for example "drop" or "dilate:4".
+    auto clock_config = step_clock_config{};
+    if (const auto text = std::getenv("SNOOKER_CATCH_UP")) {
+        if (const auto parsed = parse_step_clock_config(text)) clock_config = *parsed;
+        else std::print("ignoring SNOOKER_CATCH_UP={}, expected dilate or drop with an optional :steps\n", text);
+    }
+    auto clock = step_clock{clock_config};
+
+    // The last shot can be undone (U) or scrubbed through (left and right arrows),
+    // which pauses the game until enter carries on from the scrubbed position. Seeks
+    // are applied at the start of the next frame, before anything holds a reference
+    // into the table.
+    auto rewind = rewind_buffer{};
+    auto scrub = std::optional<i32>{};
+    auto pending_seek = std::optional<i32>{};
+    auto undo_requested = false;
+    constexpr auto scrub_steps = 5;
+
+    auto last_frame_allocs = alloc_stats{};
     while (window.is_running()) {
         const double dt = timer.on_update();
-        window.begin_frame(clear_colour);
+        log_quality_decision(renderer.end_frame(dt));
+        last_frame_allocs = thread_alloc_stats();
+        reset_thread_alloc_stats();
+
+        if (pending_seek && rewind.has_shot()) {
+            rewind.seek(t, *pending_seek);
+            if (undo_requested) {
+                rewind.clear();
+                scrub = {};
+            }
+        }
+        pending_seek = {};
+        undo_requested = false;
+
+        {
+            auto scope = alloc_scope{alloc_category::events};
+            window.begin_frame(clear_colour);
+        }
         
         const auto c = converter{window.dimensions(), t.dimensions(), 0.8f};
         const auto mouse_pos = c.to_board(window.mouse_pos());
@@ -311,31 +245,81 @@ auto scene_game(snooker::window& window, snooker::renderer& renderer) -> next_st
         auto& cue_ball_coll = t.sim.get(t.cue_ball.id);
         const auto aim_direction = cue ? cue->direction : glm::normalize(mouse_pos - cue_ball_coll.pos);
         
-        for (const auto event : window.events()) {
-            ui.on_event(event);
-            if (const auto e = event.get_if<mouse_pressed_event>(); e && e->button == mouse::left) {
-                cue = shot{0.0f, aim_direction, mouse_pos};
-            }
-            if (const auto e = event.get_if<mouse_scrolled_event>(); e && cue) {
-                cue->spin_factor = std::clamp(cue->spin_factor + 0.1f * e->offset.y, -1.0f, 1.0f);
-            }
-            if (const auto e = event.get_if<mouse_released_event>(); e && e->button == mouse::left) {
-                if (cue) {
-                    auto& body = std::get<dynamic_body>(cue_ball_coll.body);
-                    body.vel   = cue->power * aim_direction;
-
-                    // The axis of spin is always perpendicular to the direction of motion
-                    const auto radius = std::get<circle_shape>(cue_ball_coll.shape).radius;
-                    body.angular_vel = cue->spin_factor * glm::vec2{-body.vel.y, body.vel.x} / radius;
-                    cue = {};
+        {
+            auto scope = alloc_scope{alloc_category::events};
+            for (const auto event : window.events()) {
+                ui.on_event(event);
+                if (const auto e = event.get_if<mouse_pressed_event>(); e && e->button == mouse::left) {
+                    cue = shot{0.0f, aim_direction, mouse_pos};
+                }
+                if (const auto e = event.get_if<mouse_scrolled_event>(); e && cue) {
+                    cue->spin_factor = std::clamp(cue->spin_factor + 0.1f * e->offset.y, -1.0f, 1.0f);
+                }
+                if (const auto e = event.get_if<keyboard_pressed_event>(); e && rewind.has_shot()) {
+                    if (e->key == keyboard::U) {
+                        pending_seek = 0;
+                        undo_requested = true;
+                    }
+                    if (e->key == keyboard::enter && scrub) {
+                        rewind.truncate(*scrub);
+                        scrub = {};
+                    }
                 }
+                // Holding an arrow keeps scrubbing
+                auto arrow = std::optional<keyboard>{};
+                if (const auto e = event.get_if<keyboard_pressed_event>()) arrow = e->key;
+                if (const auto e = event.get_if<keyboard_held_event>()) arrow = e->key;
+                if ((arrow == keyboard::left || arrow == keyboard::right) && rewind.has_shot()) {
+                    const auto delta = arrow == keyboard::left ? -scrub_steps : scrub_steps;
+                    scrub = std::clamp(scrub.value_or(rewind.steps()) + delta, 0, rewind.steps());
+                    pending_seek = scrub;
+                }
+                if (const auto e = event.get_if<mouse_released_event>(); e && e->button == mouse::left) {
+                    if (cue) {
+                        const auto played = cue_shot{ .direction=aim_direction, .power=cue->power, .spin_factor=cue->spin_factor };
+                        if (scrub) rewind.truncate(*scrub);
+                        scrub = {};
+                        rewind.begin_shot(t, played);
+                        apply_shot(t, played);
+                        cue = {};
+                        ++shot_counter;
+                    }
+                }
+            }
+        }
+
+        // Results of background jobs are delivered here, between input and the simulation step
+        exec.run_main_continuations();
+
+        // Only one preview batch runs at a time. Moving the aim cancels it, and as the
+        // rollouts check for that between steps the batch for the new aim is spawned a
+        // frame or so later, once the cancelled one has been delivered.
+        const auto aim_moved = glm::dot(aim_direction, preview_direction) < 0.9999f;
+        const auto preview_running = preview.valid() && !preview.ready();
+        if (aim_moved && preview_running) preview.cancel();
+        if (!cue && t.sim.is_at_rest() && aim_moved && !preview_running) {
+            auto shots = std::vector<cue_shot>{};
+            for (const auto power : preview_powers) {
+                shots.push_back(cue_shot{ .direction=aim_direction, .power=power });
             }
+            preview = exec.spawn([&](std::stop_token stop) {
+                return rollout_batch(exec, t, std::move(shots), stop);
+            });
+            preview_direction = aim_direction;
         }
 
-        accumulator += dt;
-        while (accumulator > simulation::time_step) {
-            t.sim.step();
-            accumulator -= simulation::time_step;
+        // Pocketed balls are removed after every step rather than once per frame, so
+        // what happens doesn't depend on how the steps were spread across frames
+        {
+            auto scope = alloc_scope{alloc_category::sim_step};
+            auto steps = clock.advance(dt);
+            if (scrub) steps = 0; // paused, but still let the clock see the frame so there's no burst on resuming
+            for (i32 i = 0; i != steps; ++i) {
+                t.sim.step();
+                remove_pocketed_balls(t);
+                rewind.record_step(t);
+                if (exporter) exporter->publish(t, shot_counter);
+            }
         }
 
         // Advance each ball's visual orientation using its current angular velocity.
@@ -351,70 +335,20 @@ auto scene_game(snooker::window& window, snooker::renderer& renderer) -> next_st
         };
         update_orientation(t.cue_ball);
         for (auto& b : t.object_balls) update_orientation(b);
-        
-        // Handle pocketed balls
-        for (auto& ball : t.object_balls) {
-            for (const auto& pocket : t.pockets) {
-                assert_that(std::holds_alternative<circle_shape>(t.sim.get(pocket).shape), "pockets must be circles for now");
-                assert_that(std::holds_alternative<circle_shape>(t.sim.get(ball.id).shape), "balls must be circles for now");
-                const auto ball_r = std::get<circle_shape>(t.sim.get(ball.id).shape).radius;
-                const auto pock_r = std::get<circle_shape>(t.sim.get(pocket).shape).radius;
-                const auto dist = glm::distance(t.sim.get(ball.id).pos, t.sim.get(pocket).pos);
-                if (dist + ball_r < pock_r) {
-                    ball.is_pocketed = true;
-                    break;
-                }
-            }
-        }
-        for (auto& ball : t.object_balls) {
-            if (ball.is_pocketed) {
-                t.sim.remove(ball.id);
-            }
-        }
-        std::erase_if(t.object_balls, [&](const ball& b) { return b.is_pocketed; }); 
 
         // Draw table
-        const auto delta = 0.0f;
-        renderer.push_rect(c.to_screen({-delta, -delta}), c.to_screen(t.length+2*delta), c.to_screen(t.width+2*delta), board_colour);
-
-        // Draw pockets
-        for (const auto& id : t.pockets) {
-            const auto& coll = t.sim.get(id);
-            renderer.push_circle(c.to_screen(coll.pos), from_hex(0x422007), c.to_screen(std::get<circle_shape>(coll.shape).radius));
-        }
+        auto render_scope = alloc_scope{alloc_category::render_prep};
+        push_table(renderer, t, c.viewport());
 
-        renderer.draw(window.width(), window.height());
-
-        // Draw cue ball with a red dot so the spin is visible against the white surface
-        {
-            const auto& ball = t.cue_ball;
-            const auto& coll = t.sim.get(ball.id);
-            assert_that(std::holds_alternative<circle_shape>(coll.shape), "only supporting balls for now");
-            const auto radius = std::get<circle_shape>(coll.shape).radius;
-            renderer.push_sphere(c.to_screen(coll.pos), ball.colour, c.to_screen(radius), ball.orientation, {1, 0, 0, 1});
-        }
-
-        // Draw object balls
+        // Draw the aim line up to where the cue ball would make contact, and a ghost ball there
         const auto contact = cue_trajectory(t, cue_ball_coll.pos, aim_direction);
         if (contact) {
-            const auto& ball = t.cue_ball;
-            const auto& coll = t.sim.get(ball.id);
-            assert_that(std::holds_alternative<circle_shape>(coll.shape), "only supporting balls for now");
-            const auto radius = std::get<circle_shape>(coll.shape).radius;
-            
             renderer.push_line(c.to_screen(cue_ball_coll.pos), c.to_screen(cue_ball_coll.pos + aim_direction * contact->distance), adjust_alpha(t.cue_ball.colour, 0.5f), 2.0f);
-            renderer.push_circle(c.to_screen(cue_ball_coll.pos + aim_direction * contact->distance), adjust_alpha(t.cue_ball.colour, 0.5f), c.to_screen(radius));
-        }
-
-        for (const auto& ball : t.object_balls) {
-            const auto& coll = t.sim.get(ball.id);
-            assert_that(std::holds_alternative<circle_shape>(coll.shape), "only supporting balls for now");
-            const auto radius = std::get<circle_shape>(coll.shape).radius;
-            renderer.push_sphere(c.to_screen(coll.pos), ball.colour, c.to_screen(radius), ball.orientation);
+            if (renderer.quality() != render_quality::low) renderer.push_circle(c.to_screen(cue_ball_coll.pos + aim_direction * contact->distance), adjust_alpha(t.cue_ball.colour, 0.5f), c.to_screen(ball_radius));
         }
 
         // Draw the direction of both balls after 
-        if (contact && t.sim.is_valid(contact->hit_object)) {
+        if (contact && t.sim.is_valid(contact->hit_object) && renderer.quality() == render_quality::high) {
             const auto aim_line_len = 20.0f;
             const auto other_pos = t.sim.get(contact->hit_object).pos;
             const auto cue_pos = t.sim.get(t.cue_ball.id).pos + contact->distance * aim_direction;
@@ -425,52 +359,103 @@ auto scene_game(snooker::window& window, snooker::renderer& renderer) -> next_st
             renderer.push_line(c.to_screen(cue_pos), c.to_screen(cue_pos + cue_dir * aim_line_len * glm::dot(cue_dir, aim_direction)), adjust_alpha(t.cue_ball.colour, 0.5f), 2.0f);
         }
 
-        // Draw the boundary boxes
-        for (const auto id : t.border_boxes) {
-            const auto& coll = t.sim.get(id);
-            std::visit(overloaded{
-                [&](const box_shape& b) {
-                    renderer.push_quad(c.to_screen(coll.pos), c.to_screen(b.width), c.to_screen(b.height), 0, from_hex(0x73380b));
-                },
-                [&](const line_shape& l) {
-                    renderer.push_line(c.to_screen(coll.pos + l.start), c.to_screen(coll.pos + l.end), from_hex(0x73380b), 2.0f);
-                },
-                [&](auto&&) {}
-            }, coll.shape);
-        }
-
         // Draw cue
         renderer.push_line(c.to_screen(cue_ball_coll.pos), c.to_screen(cue_ball_coll.pos) + aim_direction * c.to_screen(5.0f), {0, 0, 1, 1}, 2.0f);
 
-        if (cue) {
-            const auto A = cue->start_mouse_pos - cue_ball_coll.pos;
-            const auto B = mouse_pos - cue_ball_coll.pos;
+        {
+            auto ui_scope = alloc_scope{alloc_category::ui};
+            if (cue) {
+                const auto A = cue->start_mouse_pos - cue_ball_coll.pos;
+                const auto B = mouse_pos - cue_ball_coll.pos;
             
-            const auto magnitude = glm::dot(A, B) / glm::length(A);
-            const auto offset = magnitude * glm::normalize(A);
+                const auto magnitude = glm::dot(A, B) / glm::length(A);
+                const auto offset = magnitude * glm::normalize(A);
+
+                auto C = cue_ball_coll.pos + offset - cue->start_mouse_pos;
+                if (glm::dot(C, -aim_direction) < 0) { // only allow pulling the cue back
+                    C = {0.0f, 0.0f};
+                }
+                if (glm::length(C) > 30.0f) { // TODO: don't hardcode the maximum draw back
+                    C = glm::normalize(C) * 30.0f;
+                }
+                cue->power = cue->max_power * glm::length(C) / 30.0f;
+                ui.text(std::format("Power: {}", std::trunc(cue->power)), {210, 0}, 200, 50, 3);
+                const auto spin_label = cue->spin_factor >  0.05f ? "Top"
+                                      : cue->spin_factor < -0.05f ? "Back"
+                                      : "Stun";
+                ui.text(std::format("Spin: {} ({:+.0f}%)", spin_label, cue->spin_factor * 100.0f), {410, 0}, 250, 50, 3);
+                renderer.push_line(c.to_screen(cue_ball_coll.pos), c.to_screen(cue_ball_coll.pos + C), {0, 1, 0, 1}, 2.0f);
+            }
 
-            auto C = cue_ball_coll.pos + offset - cue->start_mouse_pos;
-            if (glm::dot(C, -aim_direction) < 0) { // only allow pulling the cue back
-                C = {0.0f, 0.0f};
+            ui.text(std::format("Speed: {:.1f}", glm::length(std::get<dynamic_body>(t.sim.get(t.cue_ball.id).body).vel)), {670, 0}, 200, 50, 3);
+            if (ui.button("Back", {0, 0}, 200, 50, 3)) {
+                return next_state::main_menu;
             }
-            if (glm::length(C) > 30.0f) { // TODO: don't hardcode the maximum draw back
-                C = glm::normalize(C) * 30.0f;
+            if (rewind.has_shot() && ui.button("Undo shot", {880, 0}, 250, 50, 3)) {
+                pending_seek = 0;
+                undo_requested = true;
+            }
+            if (scrub) {
+                std::array<char, 128> buf = {};
+                const auto msg = snooker::format_to(buf, "Rewind: step {} of {} ({} snapshots, {}B), enter to play on",
+                    *scrub, rewind.steps(), rewind.snapshots(), rewind.memory_used());
+                ui.text(msg, {0, 60}, window.width(), 30, 2);
             }
-            cue->power = cue->max_power * glm::length(C) / 30.0f;
-            ui.text(std::format("Power: {}", std::trunc(cue->power)), {210, 0}, 200, 50, 3);
-            const auto spin_label = cue->spin_factor >  0.05f ? "Top"
-                                  : cue->spin_factor < -0.05f ? "Back"
-                                  : "Stun";
-            ui.text(std::format("Spin: {} ({:+.0f}%)", spin_label, cue->spin_factor * 100.0f), {410, 0}, 250, 50, 3);
-            renderer.push_line(c.to_screen(cue_ball_coll.pos), c.to_screen(cue_ball_coll.pos + C), {0, 1, 0, 1}, 2.0f);
-        }
 
-        ui.text(std::format("Speed: {:.1f}", glm::length(std::get<dynamic_body>(t.sim.get(t.cue_ball.id).body).vel)), {670, 0}, 200, 50, 3);
-        if (ui.button("Back", {0, 0}, 200, 50, 3)) {
-            return next_state::main_menu;
+            if (const auto stats = t.sim.stats().latest()) {
+                std::array<char, 128> buf = {};
+                const auto msg = snooker::format_to(buf, "Step {:.3f}ms pairs {} tests {} contacts {} iters {} residual {:.4f} sliding {} rolling {} rest {}",
+                    stats->step_time_ms, stats->broadphase_pairs, stats->narrowphase_tests, stats->contacts,
+                    stats->solver_iterations, stats->solver_residual,
+                    stats->balls_sliding, stats->balls_rolling, stats->balls_at_rest);
+                ui.text(msg, {0, window.height() - 60}, window.width(), 30, 2);
+            }
+
+            if (const auto& g = renderer.governor(); g.stats().downgrades > 0 || g.config().fixed) {
+                std::array<char, 128> buf = {};
+                const auto& s = g.stats();
+                const auto msg = g.last_decision()
+                    ? snooker::format_to(buf, "Quality {} ({:.1f}ms target): {} down, {} up, {} failed probes, last {} -> {} at {:.1f}ms",
+                        name_of(g.level()), 1000.0 * g.config().target_frame_time, s.downgrades, s.upgrades, s.failed_probes,
+                        name_of(g.last_decision()->from), name_of(g.last_decision()->to), 1000.0 * g.last_decision()->median_frame_time)
+                    : snooker::format_to(buf, "Quality {} (fixed)", name_of(g.level()));
+                ui.text(msg, {0, window.height() - 150}, window.width(), 30, 2);
+            }
+
+            if (const auto& s = clock.stats(); s.capped_frames > 0) {
+                std::array<char, 128> buf = {};
+                const auto msg = snooker::format_to(buf, "Catch-up ({}): {} capped frames, {:.2f}s slowed, {:.2f}s dropped, {:.0f}ms behind",
+                    clock.config().policy == catch_up_policy::drop ? "drop" : "dilate",
+                    s.capped_frames, s.dilated_time, s.dropped_time, 1000.0 * clock.backlog());
+                ui.text(msg, {0, window.height() - 120}, window.width(), 30, 2);
+            }
+
+            if (preview.ready() && std::ranges::all_of(preview.result(), &rollout_result::completed)) {
+                std::array<char, 128> buf = {};
+                auto out = std::string_view{};
+                auto len = std::size_t{0};
+                for (const auto& r : preview.result()) {
+                    out = snooker::format_to(std::span{buf}.subspan(len), "{}power {:.0f} pots {}{}",
+                        len == 0 ? "Preview: " : ", ", r.shot.power, r.balls_potted, r.cue_ball_in_pocket ? " (foul)" : "");
+                    len += out.size();
+                }
+                ui.text(std::string_view{buf.data(), len}, {0, window.height() - 90}, window.width(), 30, 2);
+            }
+
+            if (alloc_tracking_enabled()) {
+                const auto& a = last_frame_allocs;
+                std::array<char, 128> buf = {};
+                const auto msg = snooker::format_to(buf, "Allocs/frame sim {} ({}B) render {} ({}B) ui {} ({}B) events {} ({}B)",
+                    a[alloc_category::sim_step].count,    a[alloc_category::sim_step].bytes,
+                    a[alloc_category::render_prep].count, a[alloc_category::render_prep].bytes,
+                    a[alloc_category::ui].count,          a[alloc_category::ui].bytes,
+                    a[alloc_category::events].count,      a[alloc_category::events].bytes);
+                ui.text(msg, {0, window.height() - 30}, window.width(), 30, 2);
+            }
+
+            ui.end_frame(dt);
         }
 
-        ui.end_frame(dt);
         renderer.draw(window.width(), window.height());
         window.end_frame();
     }
@@ -484,6 +469,13 @@ auto main() -> int
 
     auto window = snooker::window{"Snooker Game", 1280, 720};
     auto renderer = snooker::renderer{};
+
+    // SNOOKER_RENDER_QUALITY pins the render quality or sets the governor's target,
+    // for example "low" or "auto:30"
+    if (const auto text = std::getenv("SNOOKER_RENDER_QUALITY")) {
+        if (const auto parsed = parse_quality_governor_config(text)) renderer.set_quality_config(*parsed);
+        else std::print("ignoring SNOOKER_RENDER_QUALITY={}, expected auto, low, medium or high\n", text);
+    }
     auto next   = next_state::main_menu;
 
     while (true) {
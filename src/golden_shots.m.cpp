@@ -0,0 +1,422 @@
+// Runs a fixed corpus of shots and compares the final ball positions against the
+// recorded results in res/golden_shots.txt, failing if any shot moved outside its
+// tolerance or took longer than its time budget. Each shot is checked with every
+// broadphase, as they must all give the same contacts, but only the default sweep
+// and prune is held to the budget as the others are there for comparison.
+//
+//   golden_shots                 check final states are within tolerance
+//   golden_shots --exact         check final states are bit-identical (deterministic mode)
+//   golden_shots --record        re-record the corpus after an intentional physics change
+//   golden_shots --monitor       also report energy/momentum violations from the contact solver
+//   golden_shots --broadphase K  only check with broadphase K (brute_force, grid or sweep_and_prune)
+//   golden_shots --solver block  use the block cluster contact solver, which settles clusters
+//                                differently, against its own corpus res/golden_shots_block.txt
+//
+// An optional trailing argument overrides the corpus path.
+#include "broadphase.hpp"
+#include "table.hpp"
+#include "simulation.hpp"
+#include "rollout.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+struct golden_shot
+{
+    std::string                 name;
+    std::function<void(table&)> setup;
+    cue_shot                    shot;
+    float                       tolerance; // max allowed position error in cm
+    double                      budget_ms; // max wall time to simulate to rest with the default broadphase
+};
+
+struct ball_state
+{
+    std::size_t id;
+    glm::vec2   pos;
+    glm::vec2   vel;
+};
+
+struct shot_result
+{
+    std::string             name;
+    i32                     steps = 0;
+    u64                     hash  = 0;
+    std::vector<ball_state> balls;
+};
+
+auto empty_table() -> table
+{
+    auto t = table{182.88f, 91.44f};
+    add_border(t);
+    return t;
+}
+
+// The table a shot starts from, for aiming at where setup put the balls
+auto set_up(const std::function<void(table&)>& setup) -> table
+{
+    auto t = empty_table();
+    setup(t);
+    return t;
+}
+
+auto position_of(const table& t, std::size_t id) -> glm::vec2
+{
+    return t.sim.get(id).pos;
+}
+
+// Direction the cue ball must travel in to pot the object ball into the pocket
+auto aim_at(const table& t, const ball& object, glm::vec2 pocket) -> glm::vec2
+{
+    const auto ob_pos = position_of(t, object.id);
+    const auto ghost = ob_pos - 2.0f * ball_radius * glm::normalize(pocket - ob_pos);
+    return glm::normalize(ghost - position_of(t, t.cue_ball.id));
+}
+
+auto make_corpus() -> std::vector<golden_shot>
+{
+    auto corpus = std::vector<golden_shot>{};
+
+    corpus.push_back({
+        .name = "break",
+        .setup = [](table& t) {
+            t.set_cue_ball({50.0f, t.width / 2.0f});
+            add_triangle(t, {0.8f * t.length, t.width / 2.0f}, 1);
+        },
+        .shot = cue_shot{ .direction={1.0f, 0.0f}, .power=break_speed },
+        .tolerance = 1.0f,
+        .budget_ms = 300.0
+    });
+
+    {
+        const auto setup = [](table& t) {
+            t.set_cue_ball({40.0f, 0.3f * t.width});
+            add_triangle(t, {0.8f * t.length, t.width / 2.0f}, 2);
+        };
+        const auto t = set_up(setup);
+        const auto target = position_of(t, t.object_balls.front().id) + glm::vec2{0.0f, 0.5f * ball_radius};
+        corpus.push_back({
+            .name = "soft_break_off_centre",
+            .setup = setup,
+            .shot = cue_shot{ .direction=glm::normalize(target - position_of(t, t.cue_ball.id)), .power=400.0f },
+            .tolerance = 1.0f,
+            .budget_ms = 300.0
+        });
+    }
+
+    {
+        const auto setup = [](table& t) {
+            t.set_cue_ball({100.0f, 20.0f});
+            add_triangle(t, {0.8f * t.length, t.width / 2.0f}, 3);
+        };
+        const auto t = set_up(setup);
+        const auto target = position_of(t, t.object_balls[5].id);
+        corpus.push_back({
+            .name = "cluster_nudge",
+            .setup = setup,
+            .shot = cue_shot{ .direction=glm::normalize(target - position_of(t, t.cue_ball.id)), .power=150.0f },
+            .tolerance = 0.5f,
+            .budget_ms = 150.0
+        });
+    }
+
+    {
+        const auto setup = [](table& t) {
+            t.set_cue_ball({60.0f, 50.0f});
+            t.add_ball({150.0f, 25.0f}, {1, 0, 0, 1});
+        };
+        const auto t = set_up(setup);
+        corpus.push_back({
+            .name = "cut_corner",
+            .setup = setup,
+            .shot = cue_shot{ .direction=aim_at(t, t.object_balls.front(), {t.length, 0.0f}), .power=250.0f },
+            .tolerance = 0.1f,
+            .budget_ms = 50.0
+        });
+    }
+
+    {
+        const auto setup = [](table& t) {
+            t.set_cue_ball({40.0f, 70.0f});
+            t.add_ball({100.0f, 12.0f}, {1, 0, 0, 1});
+        };
+        const auto t = set_up(setup);
+        corpus.push_back({
+            .name = "thin_cut_centre",
+            .setup = setup,
+            .shot = cue_shot{ .direction=aim_at(t, t.object_balls.front(), {t.length / 2.0f, -standard_dimensions.centre_pocket_offset}), .power=300.0f },
+            .tolerance = 0.1f,
+            .budget_ms = 50.0
+        });
+    }
+
+    corpus.push_back({
+        .name = "screw_back",
+        .setup = [](table& t) {
+            t.set_cue_ball({60.0f, t.width / 2.0f});
+            t.add_ball({110.0f, t.width / 2.0f}, {1, 1, 0, 1});
+        },
+        .shot = cue_shot{ .direction={1.0f, 0.0f}, .power=300.0f, .spin_factor=-1.0f },
+        .tolerance = 0.1f,
+        .budget_ms = 50.0
+    });
+
+    corpus.push_back({
+        .name = "top_spin_follow",
+        .setup = [](table& t) {
+            t.set_cue_ball({60.0f, t.width / 2.0f});
+            t.add_ball({110.0f, t.width / 2.0f}, {1, 1, 0, 1});
+        },
+        .shot = cue_shot{ .direction={1.0f, 0.0f}, .power=250.0f, .spin_factor=1.0f },
+        .tolerance = 0.1f,
+        .budget_ms = 50.0
+    });
+
+    {
+        const auto setup = [](table& t) {
+            t.set_cue_ball({70.0f, 60.0f});
+            t.add_ball({100.0f, 40.0f}, {0, 0, 0, 1});
+        };
+        const auto t = set_up(setup);
+        corpus.push_back({
+            .name = "stun_screw_angle",
+            .setup = setup,
+            .shot = cue_shot{ .direction=aim_at(t, t.object_balls.front(), {t.length, 0.0f}), .power=350.0f, .spin_factor=-0.5f },
+            .tolerance = 0.1f,
+            .budget_ms = 50.0
+        });
+    }
+
+    corpus.push_back({
+        .name = "two_cushion_bank",
+        .setup = [](table& t) {
+            t.set_cue_ball({30.0f, 30.0f});
+        },
+        .shot = cue_shot{ .direction=glm::normalize(glm::vec2{1.0f, 0.6f}), .power=350.0f },
+        .tolerance = 0.1f,
+        .budget_ms = 50.0
+    });
+
+    return corpus;
+}
+
+auto report_violations(const simulation& sim) -> void
+{
+    const auto monitor = sim.monitor();
+    if (!monitor || monitor->violation_count == 0) return;
+    std::print("     {} invariant violations in {} sampled substeps\n", monitor->violation_count, monitor->substeps_sampled);
+    for (const auto& v : monitor->violations) {
+        const auto kind = v.kind == invariant_kind::energy_gain ? "energy" : "momentum";
+        std::print("     step {} substep {}: {} {} -> {} at contact {}-{}\n", v.step_index, v.substep, kind, v.before, v.after, v.body_a, v.body_b);
+    }
+}
+
+constexpr auto broadphases = std::array{
+    broadphase_kind::brute_force, broadphase_kind::grid, broadphase_kind::sweep_and_prune
+};
+
+auto parse_broadphase(std::string_view name) -> broadphase_kind
+{
+    const auto it = std::ranges::find(broadphases, name, [](broadphase_kind k) { return name_of(k); });
+    assert_that(it != broadphases.end(), std::format("unknown broadphase {}", name));
+    return *it;
+}
+
+auto parse_solver(std::string_view name) -> contact_solver_kind
+{
+    for (const auto kind : {contact_solver_kind::pgs, contact_solver_kind::block_cluster}) {
+        if (name_of(kind) == name) return kind;
+    }
+    assert_that(false, std::format("unknown contact solver {}", name));
+    std::unreachable();
+}
+
+auto run(const golden_shot& spec, broadphase_kind broadphase, contact_solver_kind solver, bool monitor) -> std::pair<shot_result, double>
+{
+    auto t = set_up(spec.setup);
+    t.sim.set_broadphase(broadphase);
+    t.sim.set_contact_solver(solver);
+    apply_shot(t, spec.shot);
+    if (monitor) {
+        t.sim.enable_invariant_monitor(1);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto steps = simulate_to_rest(t);
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto result = shot_result{ .name=spec.name, .steps=steps, .hash=t.sim.state_hash() };
+    auto record = [&](const ball& b) {
+        const auto& coll = t.sim.get(b.id);
+        result.balls.push_back({b.id, coll.pos, std::get<dynamic_body>(coll.body).vel});
+    };
+    record(t.cue_ball);
+    for (const auto& b : t.object_balls) record(b);
+    report_violations(t.sim);
+    return {result, elapsed};
+}
+
+auto parse_float(std::string_view token) -> float
+{
+    auto value = 0.0f;
+    const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    assert_that(ec == std::errc{}, std::format("bad float in corpus: {}", token));
+    return value;
+}
+
+auto load_corpus(const std::string& path) -> std::vector<shot_result>
+{
+    auto file = std::ifstream{path};
+    assert_that(file.good(), std::format("could not open corpus {}", path));
+
+    auto results = std::vector<shot_result>{};
+    auto line = std::string{};
+    while (std::getline(file, line)) {
+        auto stream = std::istringstream{line};
+        auto kind = std::string{};
+        stream >> kind;
+        if (kind == "shot") {
+            auto& r = results.emplace_back();
+            auto label = std::string{};
+            stream >> r.name >> label >> r.steps >> label >> r.hash;
+        }
+        else if (kind == "ball") {
+            assert_that(!results.empty(), "ball entry before any shot");
+            auto b = ball_state{};
+            auto x = std::string{}, y = std::string{}, vx = std::string{}, vy = std::string{};
+            stream >> b.id >> x >> y >> vx >> vy;
+            b.pos = {parse_float(x), parse_float(y)};
+            b.vel = {parse_float(vx), parse_float(vy)};
+            results.back().balls.push_back(b);
+        }
+    }
+    return results;
+}
+
+auto save_corpus(const std::string& path, const std::vector<shot_result>& results, contact_solver_kind solver) -> void
+{
+    auto file = std::ofstream{path};
+    assert_that(file.good(), std::format("could not write corpus {}", path));
+    file << std::format("# golden shot corpus, re-record with: golden_shots --record --solver {}\n", name_of(solver));
+    for (const auto& r : results) {
+        file << std::format("shot {} steps {} hash {}\n", r.name, r.steps, r.hash);
+        for (const auto& b : r.balls) {
+            // {} gives the shortest representation that round trips exactly
+            file << std::format("ball {} {} {} {} {}\n", b.id, b.pos.x, b.pos.y, b.vel.x, b.vel.y);
+        }
+    }
+}
+
+// Returns a description of the first difference, or an empty string if they match
+auto compare(const shot_result& expected, const shot_result& actual, float tolerance, bool exact) -> std::string
+{
+    if (exact && expected.steps != actual.steps) {
+        return std::format("took {} steps, expected {}", actual.steps, expected.steps);
+    }
+    if (exact && expected.hash != actual.hash) {
+        return std::format("state hash {} differs from {}", actual.hash, expected.hash);
+    }
+    if (expected.balls.size() != actual.balls.size()) {
+        return std::format("{} balls left on the table, expected {}", actual.balls.size(), expected.balls.size());
+    }
+    for (std::size_t i = 0; i != expected.balls.size(); ++i) {
+        const auto& e = expected.balls[i];
+        const auto& a = actual.balls[i];
+        if (e.id != a.id) {
+            return std::format("ball {} is on the table, expected ball {}", a.id, e.id);
+        }
+        const auto error = glm::distance(e.pos, a.pos);
+        if (exact ? (e.pos != a.pos || e.vel != a.vel) : error > tolerance) {
+            return std::format("ball {} ended at {} but expected {} (error {:.4f}cm)", a.id, to_string(a.pos), to_string(e.pos), error);
+        }
+    }
+    return {};
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    auto record = false;
+    auto exact  = false;
+    auto monitor = false;
+    auto broadphase = std::optional<broadphase_kind>{};
+    auto solver = contact_solver_kind::pgs;
+    auto path   = std::string{};
+    for (int i = 1; i != argc; ++i) {
+        const auto arg = std::string_view{argv[i]};
+        if (arg == "--record")     record = true;
+        else if (arg == "--exact") exact = true;
+        else if (arg == "--monitor") monitor = true;
+        else if (arg == "--broadphase" && i + 1 != argc) broadphase = parse_broadphase(argv[++i]);
+        else if (arg == "--solver" && i + 1 != argc)     solver = parse_solver(argv[++i]);
+        else                       path = arg;
+    }
+    if (path.empty()) {
+        path = solver == contact_solver_kind::pgs ? "res/golden_shots.txt" : "res/golden_shots_block.txt";
+    }
+
+    const auto corpus = make_corpus();
+
+    if (record) {
+        auto results = std::vector<shot_result>{};
+        for (const auto& spec : corpus) {
+            const auto [result, elapsed] = run(spec, broadphase.value_or(broadphase_kind::sweep_and_prune), solver, monitor);
+            std::print("recorded {:<24} {:>5} steps {:>8.2f}ms\n", spec.name, result.steps, elapsed);
+            results.push_back(result);
+        }
+        save_corpus(path, results, solver);
+        return 0;
+    }
+
+    const auto expected = load_corpus(path);
+    const auto kinds = broadphase ? std::vector{*broadphase} : std::vector(broadphases.begin(), broadphases.end());
+    auto runs = std::size_t{0};
+    auto failures = std::size_t{0};
+    for (const auto& spec : corpus) {
+        const auto it = std::ranges::find(expected, spec.name, &shot_result::name);
+        if (it == expected.end()) {
+            std::print("FAIL {:<24} missing from corpus, re-record it\n", spec.name);
+            runs += kinds.size();
+            failures += kinds.size();
+            continue;
+        }
+
+        for (const auto kind : kinds) {
+            const auto [result, elapsed] = run(spec, kind, solver, monitor);
+            auto error = compare(*it, result, spec.tolerance, exact);
+            if (error.empty() && kind == broadphase_kind::sweep_and_prune && elapsed > spec.budget_ms) {
+                error = std::format("took {:.2f}ms, budget is {:.2f}ms", elapsed, spec.budget_ms);
+            }
+
+            ++runs;
+            if (error.empty()) {
+                std::print("ok   {:<24} {:<16} {:>5} steps {:>8.2f}ms\n", spec.name, name_of(kind), result.steps, elapsed);
+            } else {
+                std::print("FAIL {:<24} {:<16} {}\n", spec.name, name_of(kind), error);
+                ++failures;
+            }
+        }
+    }
+
+    std::print("{} of {} runs passed with the {} solver{}\n", runs - failures, runs, name_of(solver), exact ? " (exact)" : "");
+    return failures == 0 ? 0 : 1;
+}
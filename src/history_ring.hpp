@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+#include <type_traits>
+
+namespace snooker {
+
+// Fixed size ring buffer holding the last N values pushed. There must only be a
+// single writer, but any number of threads may read concurrently without taking
+// a lock; each slot is guarded by its own sequence number (a seqlock), so a reader
+// that races with the writer retries rather than seeing a torn value.
+template <typename T, std::size_t N>
+class history_ring
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(N > 0);
+
+    struct slot
+    {
+        std::atomic<std::uint64_t> seq = 0; // odd while the writer is mid-update
+        T                          value = {};
+    };
+
+    std::array<slot, N>        d_slots;
+    std::atomic<std::uint64_t> d_count = 0;
+
+public:
+    history_ring() = default;
+
+    // Copying is not synchronised with the writer of the source ring; it is only
+    // intended for duplicating whole simulations.
+    history_ring(const history_ring& other)
+    {
+        *this = other;
+    }
+
+    history_ring& operator=(const history_ring& other)
+    {
+        for (std::size_t i = 0; i != N; ++i) {
+            d_slots[i].seq.store(0, std::memory_order_relaxed);
+            d_slots[i].value = other.d_slots[i].value;
+        }
+        d_count.store(other.d_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    static constexpr auto capacity() -> std::size_t { return N; }
+
+    auto push(const T& value) -> void
+    {
+        const auto count = d_count.load(std::memory_order_relaxed);
+        auto& s = d_slots[count % N];
+        const auto seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.value = value;
+        s.seq.store(seq + 2, std::memory_order_release);
+        d_count.store(count + 1, std::memory_order_release);
+    }
+
+    // Total number of values ever pushed
+    auto total() const -> std::uint64_t
+    {
+        return d_count.load(std::memory_order_acquire);
+    }
+
+    // Returns the value pushed "back" pushes ago, where 0 is the most recent. Returns
+    // nothing if that value was never written or has already been overwritten.
+    auto latest(std::size_t back = 0) const -> std::optional<T>
+    {
+        const auto count = total();
+        if (back >= N || back >= count) return {};
+        const auto& s = d_slots[(count - 1 - back) % N];
+
+        while (true) {
+            const auto before = s.seq.load(std::memory_order_acquire);
+            if (before % 2 == 1) continue;
+            const auto value = s.value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != before) continue;
+            if (total() - count + back >= N) return {}; // lapped by the writer while reading
+            return value;
+        }
+    }
+};
+
+}
@@ -1,7 +1,8 @@
 #pragma once
 #include <vector>
-#include <unordered_map>
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 
 #include "utility.hpp"
 
@@ -12,23 +13,51 @@ namespace snooker {
 // The constraints that are maintained is that the IDs are stable and the 
 // underlying vector is packed contiguously. The ordering of elements can change
 // when elements are removed.
+// IDs are handed out in increasing order and never reused, so the ID to index map
+// is a plain vector indexed by ID. That keeps lookups to one load and makes copying
+// the whole container a flat copy.
+// All storage comes from a std::pmr memory resource, the default one unless given.
+// Like the standard containers, a plain copy uses the default resource rather than
+// the source's, so pass one explicitly to copy into an arena.
 template <typename T>
 class id_vector
 {
-    std::vector<T>           d_data;
-    std::vector<std::size_t> d_data_id;
-    std::unordered_map<std::size_t, std::size_t> d_id_to_index;
+    std::pmr::vector<T>           d_data;
+    std::pmr::vector<std::size_t> d_data_id;
+    std::pmr::vector<std::size_t> d_id_to_index; // npos for IDs that were erased
     std::size_t d_next = 1; // 0 is never valid
 
+    static constexpr auto npos = static_cast<std::size_t>(-1);
+
 public:
+    id_vector() = default;
+
+    explicit id_vector(std::pmr::memory_resource* resource)
+        : d_data{resource}
+        , d_data_id{resource}
+        , d_id_to_index{resource}
+    {}
+
+    id_vector(const id_vector& other, std::pmr::memory_resource* resource)
+        : d_data{other.d_data, resource}
+        , d_data_id{other.d_data_id, resource}
+        , d_id_to_index{other.d_id_to_index, resource}
+        , d_next{other.d_next}
+    {}
+
+    auto resource() const -> std::pmr::memory_resource*
+    {
+        return d_data.get_allocator().resource();
+    }
     auto is_valid(std::size_t id) const -> bool
     {
-        return d_id_to_index.contains(id);
+        return id < d_id_to_index.size() && d_id_to_index[id] != npos;
     }
     auto insert(const T& c) -> std::size_t
     {
         const auto id = ++d_next;
         const auto index = d_data.size();
+        d_id_to_index.resize(id + 1, npos);
         d_id_to_index[id] = index;
         d_data.emplace_back(c);
         d_data_id.emplace_back(id);
@@ -45,16 +74,42 @@ public:
 
         // update the map for the element swapped in
         d_id_to_index[d_data_id[index]] = index;
-        d_id_to_index.erase(id);
+        d_id_to_index[id] = npos;
 
         // remove the element we want to remove
         d_data.pop_back();
         d_data_id.pop_back();
     }
-    auto data() -> std::vector<T>&
+    // Moves the element at index order[i] to index i, leaving all IDs valid. The
+    // order must be a permutation of the current indices.
+    auto reorder(std::span<const std::size_t> order) -> void
+    {
+        assert_that(order.size() == d_data.size(), "reorder needs an index for every element\n");
+        auto data = std::pmr::vector<T>{resource()};
+        auto data_id = std::pmr::vector<std::size_t>{resource()};
+        data.reserve(d_data.size());
+        data_id.reserve(d_data.size());
+        for (const auto index : order) {
+            d_id_to_index[d_data_id[index]] = data.size();
+            data.emplace_back(std::move(d_data[index]));
+            data_id.emplace_back(d_data_id[index]);
+        }
+        d_data = std::move(data);
+        d_data_id = std::move(data_id);
+    }
+    auto data() -> std::pmr::vector<T>&
+    {
+        return d_data;
+    }
+    auto data() const -> const std::pmr::vector<T>&
     {
         return d_data;
     }
+    // IDs of the elements, parallel to data()
+    auto ids() const -> const std::pmr::vector<std::size_t>&
+    {
+        return d_data_id;
+    }
     auto get(std::size_t id) -> T&
     {
         assert_that(is_valid(id), std::format("invalid id {}\n", id));
@@ -63,7 +118,7 @@ public:
     auto get(std::size_t id) const -> const T&
     {
         assert_that(is_valid(id), std::format("invalid id {}\n", id));
-        return d_data[d_id_to_index.at(id)];
+        return d_data[d_id_to_index[id]];
     }
 };
 
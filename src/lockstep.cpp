@@ -0,0 +1,124 @@
+#include "lockstep.hpp"
+
+#include <cstring>
+#include <span>
+
+namespace snooker {
+namespace {
+
+template <typename T>
+auto send_value(local_socket& sock, const T& value) -> bool
+{
+    return sock.write_all(std::as_bytes(std::span{&value, 1}));
+}
+
+template <typename T>
+auto receive_value(local_socket& sock, T& value) -> bool
+{
+    return sock.read_exact(std::as_writable_bytes(std::span{&value, 1}));
+}
+
+}
+
+auto send_lockstep_hello(local_socket& sock, u32 seed, i32 max_shots) -> bool
+{
+    return send_value(sock, lockstep_hello{lockstep_magic, lockstep_version, seed, max_shots});
+}
+
+auto receive_lockstep_hello(local_socket& sock) -> std::optional<lockstep_hello>
+{
+    auto hello = lockstep_hello{};
+    if (!receive_value(sock, hello) || hello.magic != lockstep_magic || hello.version != lockstep_version) return {};
+    return hello;
+}
+
+lockstep_peer::lockstep_peer(local_socket& sock, i32 player, u32 seed, i32 max_shots)
+    : d_sock{sock}
+    , d_player{player}
+    , d_match{seed, match_config{ .max_shots=max_shots, .external_shots=true }}
+    , d_rng{seed ^ (0x9e3779b9u * static_cast<u32>(player + 1))}
+{
+}
+
+auto lockstep_peer::exchange_shot() -> bool
+{
+    const auto& t = d_match.get_table();
+    const auto index = d_match.get_replay().shots.size();
+    const auto frame = static_cast<u32>(d_match.total_steps());
+    const auto hash = t.sim.state_hash();
+
+    if (d_match.current_player() == d_player) {
+        const auto shot = choose_ai_shot(t, d_rng);
+        const auto message = lockstep_shot{
+            .shot_index = static_cast<u32>(index),
+            .frame = frame,
+            .dx = shot.direction.x,
+            .dy = shot.direction.y,
+            .power = shot.power,
+            .spin = shot.spin_factor,
+            .state_hash = hash
+        };
+        if (!send_value(d_sock, message)) return false;
+        d_bytes_sent += sizeof(message);
+        d_match.take_shot(shot);
+        return true;
+    }
+
+    auto message = lockstep_shot{};
+    if (!receive_value(d_sock, message)) return false;
+    d_bytes_received += sizeof(message);
+    if (message.shot_index != index || message.frame != frame || message.state_hash != hash) {
+        d_desync = lockstep_desync{index, frame, message.frame, hash, message.state_hash};
+        return false;
+    }
+
+    auto shot = cue_shot{ .direction={message.dx, message.dy}, .power=message.power, .spin_factor=message.spin };
+    if (d_fault_shot == index) shot.power *= 1.0001f;
+    d_match.take_shot(shot);
+    return true;
+}
+
+auto lockstep_peer::exchange_final_hash() -> bool
+{
+    const auto index = d_match.get_replay().shots.size();
+    const auto frame = static_cast<u32>(d_match.total_steps());
+    const auto hash = d_match.get_table().sim.state_hash();
+
+    // Both peers send before reading, which the socket buffers for such a small message
+    const auto message = lockstep_shot{ .shot_index=static_cast<u32>(index), .frame=frame, .state_hash=hash };
+    if (!send_value(d_sock, message)) return false;
+    d_bytes_sent += sizeof(message);
+
+    auto remote = lockstep_shot{};
+    if (!receive_value(d_sock, remote)) return false;
+    d_bytes_received += sizeof(remote);
+    if (remote.shot_index != index || remote.frame != frame || remote.state_hash != hash) {
+        d_desync = lockstep_desync{index, frame, remote.frame, hash, remote.state_hash};
+        return false;
+    }
+    return true;
+}
+
+auto lockstep_peer::advance(i32 max_steps) -> match_status
+{
+    const auto start = d_match.total_steps();
+    while (d_match.status() == match_status::playing) {
+        const auto used = static_cast<i32>(d_match.total_steps() - start);
+        if (used >= max_steps) break;
+
+        d_match.advance(max_steps - used);
+        if (!d_match.awaiting_shot()) continue;
+        if (!exchange_shot()) {
+            d_disconnected = !d_desync;
+            d_match.abort();
+        }
+    }
+
+    if (d_match.status() == match_status::finished && !d_final_checked) {
+        d_final_checked = true;
+        if (!exchange_final_hash()) d_disconnected = !d_desync;
+    }
+    return d_match.status();
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "local_socket.hpp"
+#include "match.hpp"
+#include "utility.hpp"
+
+#include <optional>
+#include <random>
+
+namespace snooker {
+
+// Two player lockstep over a local socket. Each peer runs the whole match on its own
+// simulation and the only traffic is one lockstep_shot per shot, sent by whoever is
+// to play. Every shot carries the sender's frame number and state hash from just
+// before the shot, so the receiver notices a desync the first time the two
+// simulations disagree. When the match ends both peers send one more lockstep_shot,
+// with no shot in it, so that the result of the last shot is checked too.
+constexpr auto lockstep_magic   = u32{0x504b534c}; // "LSKP"
+constexpr auto lockstep_version = u32{2};
+
+struct lockstep_hello
+{
+    u32 magic;
+    u32 version;
+    u32 seed;
+    i32 max_shots;
+};
+
+struct lockstep_shot
+{
+    u32 shot_index;
+    u32 frame;
+    f32 dx;
+    f32 dy;
+    f32 power;
+    f32 spin;
+    u64 state_hash;
+};
+
+struct lockstep_desync
+{
+    std::size_t shot_index; // shots played when the states were compared
+    u32         local_frame;
+    u32         remote_frame;
+    u64         local_hash;
+    u64         remote_hash;
+};
+
+// The host picks the seed and plays first
+auto send_lockstep_hello(local_socket& sock, u32 seed, i32 max_shots) -> bool;
+auto receive_lockstep_hello(local_socket& sock) -> std::optional<lockstep_hello>;
+
+class lockstep_peer
+{
+    local_socket&                  d_sock;
+    i32                            d_player;
+    match                          d_match;
+    std::mt19937                   d_rng; // for our own AI's shots
+    std::optional<lockstep_desync> d_desync;
+    std::optional<std::size_t>     d_fault_shot;
+    u64                            d_bytes_sent = 0;
+    u64                            d_bytes_received = 0;
+    bool                           d_disconnected = false;
+    bool                           d_final_checked = false;
+
+    auto exchange_shot() -> bool;
+    auto exchange_final_hash() -> bool;
+
+public:
+    lockstep_peer(local_socket& sock, i32 player, u32 seed, i32 max_shots);
+
+    // Advances up to max_steps simulation steps, exchanging a shot with the other
+    // peer whenever the balls come to rest. The match is aborted on a desync or if
+    // the other peer goes away. Once it finishes the final states are compared, and
+    // a desync there is reported although the match still counts as finished.
+    auto advance(i32 max_steps) -> match_status;
+
+    // For testing desync detection: perturbs the other player's shot with this
+    // index as if it had been received wrongly
+    auto inject_fault_at(std::size_t shot_index) -> void { d_fault_shot = shot_index; }
+
+    auto get_match() const -> const match& { return d_match; }
+    auto desync() const -> const std::optional<lockstep_desync>& { return d_desync; }
+    auto disconnected() const -> bool { return d_disconnected; }
+    auto bytes_sent() const -> u64 { return d_bytes_sent; }
+    auto bytes_received() const -> u64 { return d_bytes_received; }
+};
+
+}
@@ -0,0 +1,140 @@
+// Two player lockstep match between AI players, each running its own simulation and
+// exchanging only shots. Each peer writes its replay so that a desync can be looked
+// into afterwards with desync_report.
+//
+//   lockstep host  [--socket PATH] [--seed N] [--shots N] [--out FILE] [--fault-at K]
+//   lockstep join  [--socket PATH] [--out FILE] [--fault-at K]
+//   lockstep local [--seed N] [--shots N] [--fault-at K]
+//
+// "local" runs both peers in this process over a socket pair and writes
+// lockstep_0.txt and lockstep_1.txt. --fault-at perturbs the shot with that index as
+// the peer receives it, to check that the desync is caught and reported.
+#include "local_socket.hpp"
+#include "lockstep.hpp"
+#include "match.hpp"
+#include "replay.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <format>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace snooker;
+
+namespace {
+
+struct options
+{
+    std::string                mode   = "local";
+    std::string                socket = "/tmp/snooker_lockstep.sock";
+    u32                        seed   = 1;
+    i32                        shots  = 200;
+    std::string                out;
+    std::optional<std::size_t> fault_at;
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    if (argc > 1) opts.mode = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--socket")   opts.socket = value;
+        else if (flag == "--seed")     opts.seed = static_cast<u32>(std::stoul(value));
+        else if (flag == "--shots")    opts.shots = std::stoi(value);
+        else if (flag == "--out")      opts.out = value;
+        else if (flag == "--fault-at") opts.fault_at = std::stoul(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    return opts;
+}
+
+// Plays the match out and reports how it went. Returns false on a desync.
+auto play(local_socket& sock, i32 player, u32 seed, i32 max_shots, const options& opts, const std::string& out) -> bool
+{
+    auto peer = lockstep_peer{sock, player, seed, max_shots};
+    if (opts.fault_at) peer.inject_fault_at(*opts.fault_at);
+    while (peer.advance(600) == match_status::playing) {}
+
+    const auto& m = peer.get_match();
+    const auto shots = m.get_replay().shots.size();
+    const auto bytes = peer.bytes_sent() + peer.bytes_received();
+    assert_that(save_replay(out, m.get_replay()), std::format("could not write replay {}", out));
+
+    std::print("player {}: {} shots, {} steps, score {} {}, {} bytes exchanged ({:.1f} per shot), replay in {}\n",
+               player, shots, m.total_steps(), m.scores()[0], m.scores()[1], bytes,
+               shots ? static_cast<f64>(bytes) / shots : 0.0, out);
+    if (const auto& d = peer.desync()) {
+        const auto where = m.status() == match_status::finished ? std::string{"at the end of the match"} : std::format("before shot {}", d->shot_index);
+        std::print("player {}: DESYNC {}: local frame {} hash {:016x}, remote frame {} hash {:016x}\n",
+                   player, where, d->local_frame, d->local_hash, d->remote_frame, d->remote_hash);
+        return false;
+    }
+    if (peer.disconnected()) {
+        std::print("player {}: the other player went away\n", player);
+    }
+    return true;
+}
+
+auto host(const options& opts) -> int
+{
+    auto listener = local_socket::listen(opts.socket);
+    assert_that(listener.valid(), std::format("could not listen on {}", opts.socket));
+    std::print("waiting for a player on {}\n", opts.socket);
+    auto sock = listener.accept();
+    if (!sock.valid() || !send_lockstep_hello(sock, opts.seed, opts.shots)) return 1;
+    return play(sock, 0, opts.seed, opts.shots, opts, opts.out.empty() ? "lockstep_0.txt" : opts.out) ? 0 : 1;
+}
+
+auto join(const options& opts) -> int
+{
+    auto sock = local_socket::connect(opts.socket);
+    if (!sock.valid()) {
+        std::print("could not connect to {}\n", opts.socket);
+        return 1;
+    }
+    const auto hello = receive_lockstep_hello(sock);
+    if (!hello) {
+        std::print("{} is not a lockstep host of this version\n", opts.socket);
+        return 1;
+    }
+    return play(sock, 1, hello->seed, hello->max_shots, opts, opts.out.empty() ? "lockstep_1.txt" : opts.out) ? 0 : 1;
+}
+
+auto local(const options& opts) -> int
+{
+    auto [a, b] = local_socket::pair();
+    assert_that(a.valid() && b.valid(), "could not create a socket pair");
+
+    // Only the joining side gets the fault, so the two replays differ
+    auto host_opts = opts;
+    host_opts.fault_at.reset();
+    auto ok = std::array<bool, 2>{};
+    {
+        auto joiner = std::jthread{[&] {
+            const auto hello = receive_lockstep_hello(b);
+            ok[1] = hello && play(b, 1, hello->seed, hello->max_shots, opts, "lockstep_1.txt");
+            b = {}; // let the host know if we stopped early
+        }};
+        ok[0] = send_lockstep_hello(a, opts.seed, opts.shots) && play(a, 0, opts.seed, opts.shots, host_opts, "lockstep_0.txt");
+        a = {};
+    }
+    return ok[0] && ok[1] ? 0 : 1;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    if (opts.mode == "host")  return host(opts);
+    if (opts.mode == "join")  return join(opts);
+    if (opts.mode == "local") return local(opts);
+    std::print("unknown mode '{}'\n", opts.mode);
+    return 1;
+}
@@ -0,0 +1,199 @@
+#include "match.hpp"
+
+#include <cmath>
+#include <numbers>
+
+namespace snooker {
+namespace {
+
+auto rotate(glm::vec2 v, float angle) -> glm::vec2
+{
+    const auto c = std::cos(angle);
+    const auto s = std::sin(angle);
+    return {c * v.x - s * v.y, s * v.x + c * v.y};
+}
+
+// Respots a fouled cue ball, returning whether it was in a pocket
+auto apply_rules(table& t) -> bool
+{
+    const auto foul = cue_ball_in_pocket(t);
+    if (foul) respot_cue_ball(t);
+    return foul;
+}
+
+}
+
+auto ai_shot_power(f32 cue_distance, f32 pocket_distance, f32 cut) -> f32
+{
+    return std::clamp(80.0f + 1.5f * (cue_distance + pocket_distance / cut), 120.0f, 600.0f);
+}
+
+auto choose_ai_shot(const table& t, std::mt19937& rng, const pot_table* pots) -> cue_shot
+{
+    const auto& sim = t.sim;
+    const auto cue_pos = sim.get(t.cue_ball.id).pos;
+
+    auto best = std::optional<cue_shot>{};
+    auto best_score = 0.0f;
+    for (const auto& object : t.object_balls) {
+        const auto ob_pos = sim.get(object.id).pos;
+        for (const auto pocket : t.pockets) {
+            const auto pocket_pos = sim.get(pocket).pos;
+            const auto to_pocket = glm::normalize(pocket_pos - ob_pos);
+            const auto ghost = ob_pos - 2.0f * ball_radius * to_pocket;
+            const auto aim = ghost - cue_pos;
+            const auto cue_dist = glm::length(aim);
+            if (cue_dist < 1e-3f) continue;
+            const auto dir = aim / cue_dist;
+
+            // Very thin cuts are too hard to judge
+            const auto cut = glm::dot(dir, to_pocket);
+            if (cut < 0.3f) continue;
+
+            // The cue ball must reach the object ball first
+            const auto hit = sim.raycast(ray{.start=cue_pos, .dir=dir}, ball_radius, t.cue_ball.id);
+            if (!hit || hit->id != object.id) continue;
+
+            // and the object ball must have a clear path to the pocket
+            const auto pocket_dist = glm::distance(ob_pos, pocket_pos);
+            const auto path = sim.raycast(ray{.start=ob_pos, .dir=to_pocket}, ball_radius, object.id);
+            if (path && path->distance < pocket_dist && std::holds_alternative<dynamic_body>(sim.get(path->id).body)) continue;
+
+            const auto score = pots
+                ? pots->probability(kind_of_pocket(t, pocket), std::acos(std::min(cut, 1.0f)) * 180.0f / std::numbers::pi_v<f32>, pocket_dist, cue_dist)
+                : cut / (cue_dist + pocket_dist);
+            if (score > best_score) {
+                best_score = score;
+                best = cue_shot{ .direction=dir, .power=ai_shot_power(cue_dist, pocket_dist, cut) };
+            }
+        }
+    }
+
+    // Nothing is pottable, so just roll into the nearest ball
+    if (!best) {
+        const auto target = sim.nearest_ball(cue_pos, t.cue_ball.id);
+        const auto dir = target ? glm::normalize(sim.get(*target).pos - cue_pos) : glm::vec2{1.0f, 0.0f};
+        best = cue_shot{ .direction=dir, .power=300.0f };
+    }
+
+    auto angle_error = std::normal_distribution<float>{0.0f, 0.004f};
+    auto power_error = std::uniform_real_distribution<float>{0.9f, 1.1f};
+    best->direction = rotate(best->direction, angle_error(rng));
+    best->power *= power_error(rng);
+    return *best;
+}
+
+match::match(u32 seed, match_config config)
+    : d_config{config}
+    , d_table{make_standard_table(seed)}
+    , d_rng{seed}
+    , d_replay{ .seed=seed }
+{
+}
+
+auto match::out_of_shots() const -> bool
+{
+    return d_table.object_balls.empty() || static_cast<i32>(d_replay.shots.size()) >= d_config.max_shots;
+}
+
+auto match::choose_shot() -> cue_shot
+{
+    if (d_config.library) {
+        for (const auto& shot : suggest_shots(*d_config.library, d_table, 8)) {
+            const auto result = rollout(d_table, shot, d_config.max_steps_per_shot);
+            if (result.balls_potted > 0 && !result.cue_ball_in_pocket) return shot;
+        }
+    }
+    return choose_ai_shot(d_table, d_rng, d_config.pots);
+}
+
+auto match::begin_shot(const cue_shot& shot) -> void
+{
+    d_shot = shot;
+    apply_shot(d_table, d_shot);
+    d_balls_before = static_cast<i32>(d_table.object_balls.size());
+    d_shot_steps = 0;
+    d_shot_in_progress = true;
+}
+
+auto match::end_shot() -> void
+{
+    const auto potted = d_balls_before - static_cast<i32>(d_table.object_balls.size());
+    const auto foul = apply_rules(d_table);
+    d_replay.shots.push_back({d_player, d_shot, d_shot_steps, d_table.sim.state_hash()});
+    d_last_outcome = {potted, foul, d_shot_steps};
+
+    if (foul || potted == 0) {
+        d_player = 1 - d_player;
+    } else {
+        d_scores[d_player] += potted;
+    }
+    d_shot_in_progress = false;
+}
+
+auto match::advance(i32 max_steps) -> match_status
+{
+    // Mirrors simulate_to_rest, so that verify_replay reproduces each shot exactly
+    for (i32 i = 0; i < max_steps && d_status == match_status::playing;) {
+        if (!d_shot_in_progress) {
+            if (out_of_shots()) {
+                d_status = match_status::finished;
+                break;
+            }
+            if (d_config.external_shots) break;
+            begin_shot(choose_shot());
+        }
+        else if (d_table.sim.is_at_rest() || d_shot_steps == d_config.max_steps_per_shot) {
+            end_shot();
+        }
+        else {
+            d_table.sim.step();
+            remove_pocketed_balls(d_table);
+            ++d_shot_steps;
+            ++d_total_steps;
+            ++i;
+        }
+    }
+    return d_status;
+}
+
+auto match::awaiting_shot() const -> bool
+{
+    return d_config.external_shots && d_status == match_status::playing && !d_shot_in_progress && !out_of_shots();
+}
+
+auto match::take_shot(const cue_shot& shot) -> void
+{
+    assert_that(awaiting_shot(), "took a shot when the match wasn't waiting for one");
+    begin_shot(shot);
+}
+
+auto match::winner() const -> std::optional<i32>
+{
+    if (d_status != match_status::finished || d_scores[0] == d_scores[1]) return {};
+    return d_scores[0] > d_scores[1] ? 0 : 1;
+}
+
+auto resimulate_replay(const replay& r) -> std::vector<u64>
+{
+    auto hashes = std::vector<u64>{};
+    auto t = make_standard_table(r.seed);
+    for (const auto& s : r.shots) {
+        apply_shot(t, s.shot);
+        simulate_to_rest(t, s.steps);
+        apply_rules(t);
+        hashes.push_back(t.sim.state_hash());
+    }
+    return hashes;
+}
+
+auto verify_replay(const replay& r) -> std::optional<std::size_t>
+{
+    const auto hashes = resimulate_replay(r);
+    for (std::size_t i = 0; i != r.shots.size(); ++i) {
+        if (hashes[i] != r.shots[i].state_hash) return i;
+    }
+    return {};
+}
+
+}
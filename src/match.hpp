@@ -0,0 +1,103 @@
+#pragma once
+#include "replay.hpp"
+#include "pot_table.hpp"
+#include "rollout.hpp"
+#include "shot_library.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace snooker {
+
+// How hard the AI hits a pot, given the cue ball's distance to the ghost ball, the
+// object ball's distance to the pocket and the cosine of the cut angle
+auto ai_shot_power(f32 cue_distance, f32 pocket_distance, f32 cut) -> f32;
+
+// Picks a pot by aiming the cue ball at the ghost ball position for every object
+// ball and pocket pair with a clear path. Pots are ranked by their chance in the
+// pot table if there is one, and otherwise by preferring straight and short pots.
+// The rng adds a small execution error so that matches don't all play out the same.
+auto choose_ai_shot(const table& t, std::mt19937& rng, const pot_table* pots = nullptr) -> cue_shot;
+
+struct match_config
+{
+    i32  max_shots          = 200;
+    i32  max_steps_per_shot = 60 * 60;
+    bool external_shots     = false; // shots are given with take_shot rather than chosen by the AI
+
+    // If set, the AI first tries the shots that worked from similar past layouts,
+    // checking each with a rollout, before aiming one itself
+    const shot_library* library = nullptr;
+    const pot_table*    pots    = nullptr;
+};
+
+enum class match_status
+{
+    playing,
+    finished,
+    aborted, // stopped early, for example by running out of time
+};
+
+// A two player AI match that is advanced a slice at a time so that many matches can
+// share a thread pool. Players score one point per ball potted and keep the table
+// until they miss or pot the cue ball, which is a foul and respotted.
+class match
+{
+    match_config       d_config;
+    table              d_table;
+    std::mt19937       d_rng;
+    replay             d_replay;
+    std::array<i32, 2> d_scores = {};
+    i32                d_player = 0;
+    match_status       d_status = match_status::playing;
+
+    bool         d_shot_in_progress = false;
+    cue_shot     d_shot = {};
+    i32          d_shot_steps = 0;
+    i32          d_balls_before = 0;
+    u64          d_total_steps = 0;
+    shot_outcome d_last_outcome = {};
+
+    auto out_of_shots() const -> bool;
+    auto choose_shot() -> cue_shot;
+    auto begin_shot(const cue_shot& shot) -> void;
+    auto end_shot() -> void;
+
+public:
+    explicit match(u32 seed, match_config config = {});
+
+    // Runs at most max_steps simulation steps, taking a shot whenever the balls
+    // come to rest. Returns the status afterwards.
+    auto advance(i32 max_steps) -> match_status;
+    auto abort() -> void { d_status = match_status::aborted; }
+
+    // With external shots, advance stops once the balls are at rest and the match
+    // waits here until the player to move takes their shot
+    auto awaiting_shot() const -> bool;
+    auto take_shot(const cue_shot& shot) -> void;
+
+    auto status() const -> match_status { return d_status; }
+    auto scores() const -> const std::array<i32, 2>& { return d_scores; }
+    auto total_steps() const -> u64 { return d_total_steps; }
+    auto current_player() const -> i32 { return d_player; }
+    auto last_outcome() const -> const shot_outcome& { return d_last_outcome; }
+    auto get_replay() const -> const replay& { return d_replay; }
+    auto get_table() const -> const table& { return d_table; }
+
+    // The player with the higher score once finished, nothing for a draw
+    auto winner() const -> std::optional<i32>;
+};
+
+// Replays the shots on a table rebuilt from the seed, returning the state hash after
+// each shot as this build computes it.
+auto resimulate_replay(const replay& r) -> std::vector<u64>;
+
+// Replays the shots on a table rebuilt from the seed. Returns the index of the first
+// shot whose state hash doesn't match the recording, or nothing if all of them do.
+auto verify_replay(const replay& r) -> std::optional<std::size_t>;
+
+}
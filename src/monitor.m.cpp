@@ -0,0 +1,119 @@
+// Tournament monitor: plays many AI matches at once in real time and shows them all
+// in a grid, each table scaled into its own cell. Every table is queued into the
+// same instance stream and drawn with one renderer::draw, so the frame costs about
+// the same for 64 small tables as for the same number of balls on a few large ones.
+//
+//   monitor [--tables N] [--seed N]
+//
+// A finished match is replaced by a new one with the next seed.
+#include "match.hpp"
+#include "renderer.hpp"
+#include "step_clock.hpp"
+#include "table_view.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+#include "window.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+struct options
+{
+    i32 tables = 16;
+    u32 seed   = 1;
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--tables") opts.tables = std::stoi(value);
+        else if (flag == "--seed")   opts.seed = static_cast<u32>(std::stoul(value));
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    assert_that(1 <= opts.tables && opts.tables <= 64, "the monitor shows 1 to 64 tables");
+    return opts;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+
+    auto window = snooker::window{"Snooker Monitor", 1280, 720};
+    auto renderer = snooker::renderer{};
+    if (const auto text = std::getenv("SNOOKER_RENDER_QUALITY")) {
+        if (const auto parsed = parse_quality_governor_config(text)) renderer.set_quality_config(*parsed);
+        else std::print("ignoring SNOOKER_RENDER_QUALITY={}, expected auto, low, medium or high\n", text);
+    }
+
+    auto pool = thread_pool{std::max(1u, std::thread::hardware_concurrency())};
+    auto clock = step_clock{};
+    auto timer = snooker::timer{};
+
+    auto next_seed = opts.seed;
+    auto matches = std::vector<match>{};
+    matches.reserve(opts.tables);
+    for (i32 i = 0; i != opts.tables; ++i) matches.emplace_back(next_seed++);
+
+    constexpr auto header_height = 40.0f;
+    const auto table_size = glm::vec2{matches.front().get_table().length, matches.front().get_table().width};
+    auto finished = u64{0};
+
+    while (window.is_running()) {
+        const double dt = timer.on_update();
+        if (const auto decision = renderer.end_frame(dt)) {
+            std::print("render quality {} -> {} at frame {}, median frame time {:.1f}ms\n",
+                       name_of(decision->from), name_of(decision->to), decision->frame, 1000.0 * decision->median_frame_time);
+        }
+        window.begin_frame(clear_colour);
+
+        // Matches are independent, so they step in parallel. Replacements are made
+        // afterwards so that the seeds don't depend on the order tables finish in.
+        const auto steps = clock.advance(dt);
+        pool.parallel_for(matches.size(), [&](std::size_t i) { matches[i].advance(steps); });
+        for (auto& m : matches) {
+            if (m.status() == match_status::playing) continue;
+            m = match{next_seed++};
+            ++finished;
+        }
+
+        const auto area = glm::vec2{window.width(), window.height() - header_height};
+        const auto viewports = grid_viewports(matches.size(), table_size, {0.0f, header_height}, area);
+        auto balls = std::size_t{0};
+        for (std::size_t i = 0; i != matches.size(); ++i) {
+            const auto& m = matches[i];
+            push_table(renderer, m.get_table(), viewports[i]);
+            balls += m.get_table().object_balls.size() + 1;
+
+            std::array<char, 32> buf = {};
+            const auto scale = viewports[i].scale > 3.0f ? 2 : 1;
+            const auto score = snooker::format_to(buf, "{} - {}", m.scores()[0], m.scores()[1]);
+            renderer.push_text(score, glm::ivec2{viewports[i].to_screen({10.0f, 2.0f})} + glm::ivec2{0, 7 * scale}, scale, {1, 1, 1, 1});
+        }
+
+        std::array<char, 128> buf = {};
+        const auto header = snooker::format_to(buf, "{} tables {} balls {} finished {} fps {} quality {} KB/frame",
+            matches.size(), balls, finished, timer.frame_rate(), name_of(renderer.quality()), renderer.upload_bytes() / 1024);
+        renderer.push_text(header, {10, 30}, 2, {1, 1, 1, 1});
+
+        renderer.draw(window.width(), window.height());
+        window.end_frame();
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "pot_table.hpp"
+#include "match.hpp"
+#include "rollout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <random>
+
+namespace snooker {
+namespace {
+
+constexpr auto pocket_kinds = 2;
+
+auto rotate(glm::vec2 v, float angle) -> glm::vec2
+{
+    const auto c = std::cos(angle);
+    const auto s = std::sin(angle);
+    return {c * v.x - s * v.y, s * v.x + c * v.y};
+}
+
+auto radians(f32 degrees) -> f32
+{
+    return degrees * std::numbers::pi_v<f32> / 180.0f;
+}
+
+auto grid_size(const pot_table_config& config) -> std::size_t
+{
+    return std::size_t{config.cut.count} * config.pocket_distance.count * config.cue_distance.count;
+}
+
+// Replaces each NaN in count values spaced stride apart with the nearest real value,
+// if there is one
+auto fill_gaps(f32* values, std::size_t count, std::size_t stride) -> void
+{
+    for (std::size_t i = 0; i != count; ++i) {
+        if (!std::isnan(values[i * stride])) continue;
+        for (std::size_t d = 1; d != count; ++d) {
+            if (d <= i && !std::isnan(values[(i - d) * stride])) {
+                values[i * stride] = values[(i - d) * stride];
+                break;
+            }
+            if (i + d < count && !std::isnan(values[(i + d) * stride])) {
+                values[i * stride] = values[(i + d) * stride];
+                break;
+            }
+        }
+    }
+}
+
+}
+
+auto pot_table_axis::position(f32 v) const -> f32
+{
+    return std::clamp((v - min) / (max - min), 0.0f, 1.0f) * (count - 1);
+}
+
+auto simulate_pot_chance(const pot_table_config& config, pocket_kind kind, f32 cut_degrees, f32 pocket_distance,
+                         f32 cue_distance, u32 seed) -> f32
+{
+    // Built only to find where the pockets and cushions are
+    const auto probe = make_layout_table({0.0f, 0.0f}, {});
+    const auto pocket_id = *std::ranges::find_if(probe.pockets, [&](std::size_t id) { return kind_of_pocket(probe, id) == kind; });
+    const auto pocket = probe.sim.get(pocket_id).pos;
+    const auto centre = glm::vec2{probe.length, probe.width} / 2.0f;
+
+    // Corner pockets are approached along the diagonal and centre pockets square on,
+    // give or take a spread of approach angles
+    const auto away = centre - pocket;
+    const auto inward = kind == pocket_kind::corner
+                      ? glm::normalize(glm::vec2{away.x > 0 ? 1.0f : -1.0f, away.y > 0 ? 1.0f : -1.0f})
+                      : glm::vec2{0.0f, away.y > 0 ? 1.0f : -1.0f};
+    const auto spread = radians(kind == pocket_kind::corner ? 20.0f : 30.0f);
+
+    const auto margin = standard_dimensions.border_width + ball_radius + 0.5f;
+    const auto on_table = [&](glm::vec2 p) {
+        return p.x > margin && p.x < probe.length - margin && p.y > margin && p.y < probe.width - margin;
+    };
+
+    auto rng = std::mt19937{seed};
+    auto approach = std::uniform_real_distribution<f32>{-spread, spread};
+    auto coin = std::bernoulli_distribution{0.5};
+    auto aim_error = std::normal_distribution<f32>{0.0f, config.aim_error};
+    auto power_error = std::uniform_real_distribution<f32>{0.9f, 1.1f};
+    const auto cut = radians(cut_degrees);
+
+    auto played = 0;
+    auto potted = 0;
+    for (u32 s = 0; s != config.samples; ++s) {
+        // Not every approach angle leaves both balls on the table, so try a few
+        auto found = false;
+        auto cue = glm::vec2{};
+        auto object = glm::vec2{};
+        auto ghost = glm::vec2{};
+        for (i32 attempt = 0; attempt != 16 && !found; ++attempt) {
+            const auto to_table = rotate(inward, approach(rng));
+            object = pocket + pocket_distance * to_table;
+            ghost = object + 2.0f * ball_radius * to_table;
+            cue = ghost - cue_distance * rotate(-to_table, coin(rng) ? cut : -cut);
+            found = on_table(object) && on_table(cue) && glm::distance(cue, object) > 2.0f * ball_radius + 0.1f;
+        }
+        if (!found) continue;
+
+        const auto direction = rotate(glm::normalize(ghost - cue), aim_error(rng));
+        const auto power = ai_shot_power(cue_distance, pocket_distance, std::cos(cut)) * power_error(rng);
+        const auto balls = std::array{object};
+        const auto result = rollout(make_layout_table(cue, balls), cue_shot{ .direction=direction, .power=power }, config.max_steps);
+        ++played;
+        potted += result.balls_potted > 0 && !result.cue_ball_in_pocket;
+    }
+    return played ? static_cast<f32>(potted) / played : std::numeric_limits<f32>::quiet_NaN();
+}
+
+auto build_pot_table(thread_pool& pool, const pot_table_config& config) -> std::vector<f32>
+{
+    const auto per_kind = grid_size(config);
+    auto data = std::vector<f32>(pocket_kinds * per_kind);
+    pool.parallel_for(data.size(), [&](std::size_t index) {
+        const auto kind = index / per_kind == 0 ? pocket_kind::corner : pocket_kind::centre;
+        const auto cell = index % per_kind;
+        const auto cue = static_cast<u32>(cell % config.cue_distance.count);
+        const auto pocket = static_cast<u32>(cell / config.cue_distance.count % config.pocket_distance.count);
+        const auto cut = static_cast<u32>(cell / config.cue_distance.count / config.pocket_distance.count);
+        const auto seed = config.seed * 0x9e3779b9u + static_cast<u32>(index);
+        data[index] = simulate_pot_chance(config, kind, config.cut.value(cut), config.pocket_distance.value(pocket),
+                                          config.cue_distance.value(cue), seed);
+    });
+
+    // Some combinations can't be set up on the table at all, such as a long straight
+    // pot into a centre pocket with the cue ball far behind. Lookups still clamp into
+    // them, so borrow from the nearest cue distance that could be played, then from
+    // the nearest pocket distance.
+    const auto cues = config.cue_distance.count;
+    const auto rows = data.size() / cues;
+    for (std::size_t row = 0; row != rows; ++row) {
+        fill_gaps(data.data() + row * cues, cues, 1);
+    }
+    const auto pockets = config.pocket_distance.count;
+    for (std::size_t plane = 0; plane != rows / pockets; ++plane) {
+        for (std::size_t cue = 0; cue != cues; ++cue) {
+            fill_gaps(data.data() + plane * pockets * cues + cue, pockets, cues);
+        }
+    }
+    std::ranges::replace_if(data, [](f32 v) { return std::isnan(v); }, 0.0f);
+    return data;
+}
+
+auto write_pot_table(const std::string& path, const pot_table_config& config, const std::vector<f32>& data) -> bool
+{
+    assert_that(data.size() == pocket_kinds * grid_size(config), "pot table data doesn't match its config");
+    auto file = std::ofstream{path, std::ios::binary};
+    if (!file) return false;
+    const auto header = pot_table_header{
+        .magic = pot_table_magic,
+        .version = pot_table_version,
+        .samples = config.samples,
+        .aim_error = config.aim_error,
+        .cut = config.cut,
+        .pocket_distance = config.pocket_distance,
+        .cue_distance = config.cue_distance
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(f32)));
+    return file.good();
+}
+
+pot_table::pot_table(const std::string& path)
+    : d_file{path}
+{
+    if (!d_file.valid() || d_file.size() < sizeof(pot_table_header)) return;
+    std::memcpy(&d_header, d_file.data(), sizeof(d_header));
+    if (d_header.magic != pot_table_magic || d_header.version != pot_table_version) return;
+    for (const auto& axis : {d_header.cut, d_header.pocket_distance, d_header.cue_distance}) {
+        if (axis.count < 2 || !(axis.max > axis.min)) return;
+    }
+    const auto count = std::size_t{pocket_kinds} * d_header.cut.count * d_header.pocket_distance.count * d_header.cue_distance.count;
+    if (d_file.size() < sizeof(pot_table_header) + count * sizeof(f32)) return;
+    d_data = reinterpret_cast<const f32*>(d_file.data() + sizeof(pot_table_header));
+}
+
+auto pot_table::at(pocket_kind kind, u32 cut, u32 pocket, u32 cue) const -> f32
+{
+    const auto k = kind == pocket_kind::corner ? 0u : 1u;
+    const auto index = ((std::size_t{k} * d_header.cut.count + cut) * d_header.pocket_distance.count + pocket) * d_header.cue_distance.count + cue;
+    return d_data[index];
+}
+
+auto pot_table::probability(pocket_kind kind, f32 cut_degrees, f32 pocket_distance, f32 cue_distance) const -> f32
+{
+    const auto positions = std::array{
+        d_header.cut.position(cut_degrees),
+        d_header.pocket_distance.position(pocket_distance),
+        d_header.cue_distance.position(cue_distance)
+    };
+    const auto counts = std::array{d_header.cut.count, d_header.pocket_distance.count, d_header.cue_distance.count};
+
+    auto lo = std::array<u32, 3>{};
+    auto frac = std::array<f32, 3>{};
+    for (std::size_t axis = 0; axis != 3; ++axis) {
+        lo[axis] = std::min(static_cast<u32>(positions[axis]), counts[axis] - 2);
+        frac[axis] = positions[axis] - lo[axis];
+    }
+
+    auto result = 0.0f;
+    for (u32 corner = 0; corner != 8; ++corner) {
+        auto weight = 1.0f;
+        auto index = std::array<u32, 3>{};
+        for (std::size_t axis = 0; axis != 3; ++axis) {
+            const auto upper = (corner >> axis) & 1;
+            index[axis] = lo[axis] + upper;
+            weight *= upper ? frac[axis] : 1.0f - frac[axis];
+        }
+        result += weight * at(kind, index[0], index[1], index[2]);
+    }
+    return result;
+}
+
+}
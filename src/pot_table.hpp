@@ -0,0 +1,84 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "table.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <string>
+#include <vector>
+
+namespace snooker {
+
+// Chance of potting a lone object ball, as a function of the cut angle, the object
+// ball's distance to the pocket, the cue ball's distance to the object ball and the
+// kind of pocket. Built offline from noisy simulated shots and sampled with
+// trilinear interpolation, so scoring a shot is a lookup rather than rollouts.
+//
+// The file is a pot_table_header followed by the probabilities as f32, indexed
+// [pocket kind][cut][pocket distance][cue distance], and is used in place.
+constexpr auto pot_table_magic   = u32{0x4c42544f}; // "OTBL"
+constexpr auto pot_table_version = u32{1};
+
+struct pot_table_axis
+{
+    f32 min;
+    f32 max;
+    u32 count; // grid points, including both ends
+
+    auto position(f32 value) const -> f32; // fractional grid index, clamped to the axis
+    auto value(u32 index) const -> f32 { return min + (max - min) * index / (count - 1); }
+};
+
+struct pot_table_config
+{
+    pot_table_axis cut             = {0.0f, 75.0f, 16};  // degrees
+    pot_table_axis pocket_distance = {5.0f, 80.0f, 12};  // cm, object ball centre to pocket centre
+    pot_table_axis cue_distance    = {5.0f, 120.0f, 12}; // cm, cue ball centre to the ghost ball
+    u32            samples         = 32;                 // shots simulated per grid point
+    f32            aim_error       = 0.004f;             // standard deviation of the aim in radians
+    u32            seed            = 1;
+    i32            max_steps       = 60 * 15;
+};
+
+struct pot_table_header
+{
+    u32            magic;
+    u32            version;
+    u32            samples;
+    f32            aim_error;
+    pot_table_axis cut;
+    pot_table_axis pocket_distance;
+    pot_table_axis cue_distance;
+};
+
+// Estimates the pot chance for one grid point by playing samples shots at it. NaN if
+// the balls can't be placed on the table that way.
+auto simulate_pot_chance(const pot_table_config& config, pocket_kind kind, f32 cut_degrees, f32 pocket_distance,
+                         f32 cue_distance, u32 seed) -> f32;
+
+// Simulates every grid point, spread across the pool
+auto build_pot_table(thread_pool& pool, const pot_table_config& config) -> std::vector<f32>;
+auto write_pot_table(const std::string& path, const pot_table_config& config, const std::vector<f32>& data) -> bool;
+
+class pot_table
+{
+    mapped_file      d_file;
+    pot_table_header d_header = {};
+    const f32*       d_data = nullptr;
+
+    pot_table(const pot_table&) = delete;
+    pot_table& operator=(const pot_table&) = delete;
+
+    auto at(pocket_kind kind, u32 cut, u32 pocket, u32 cue) const -> f32;
+
+public:
+    explicit pot_table(const std::string& path);
+
+    auto valid() const -> bool { return d_data != nullptr; }
+    auto header() const -> const pot_table_header& { return d_header; }
+
+    // Values outside the axes are clamped to their ends
+    auto probability(pocket_kind kind, f32 cut_degrees, f32 pocket_distance, f32 cue_distance) const -> f32;
+};
+
+}
@@ -0,0 +1,183 @@
+// Builds and inspects pot probability tables.
+//
+//   pot_table build FILE [--samples N] [--threads N] [--cut N] [--pocket N] [--cue N]
+//       simulate every grid point and write the table
+//   pot_table show FILE
+//       print the corner and centre tables at a middling cue ball distance
+//   pot_table check FILE [--points N] [--samples N]
+//       compare lookups at random points between the grid against fresh simulations,
+//       and the cost of a lookup against simulating
+//   pot_table compare FILE [--matches N]
+//       balls potted per shot by the AI with and without the table to rank its pots
+#include "match.hpp"
+#include "pot_table.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace snooker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::string      mode;
+    std::string      file;
+    pot_table_config config;
+    std::size_t      threads = std::max(1u, std::thread::hardware_concurrency());
+    i32              points  = 64;
+    i32              matches = 16;
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    assert_that(argc >= 3, "usage: pot_table build|show|check|compare FILE [options]");
+    auto opts = options{ .mode=argv[1], .file=argv[2] };
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--samples") opts.config.samples = static_cast<u32>(std::stoul(value));
+        else if (flag == "--threads") opts.threads = std::stoul(value);
+        else if (flag == "--cut")     opts.config.cut.count = static_cast<u32>(std::stoul(value));
+        else if (flag == "--pocket")  opts.config.pocket_distance.count = static_cast<u32>(std::stoul(value));
+        else if (flag == "--cue")     opts.config.cue_distance.count = static_cast<u32>(std::stoul(value));
+        else if (flag == "--points")  opts.points = std::stoi(value);
+        else if (flag == "--matches") opts.matches = std::stoi(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    return opts;
+}
+
+auto elapsed_ms(clock_type::time_point start) -> f64
+{
+    return std::chrono::duration<f64, std::milli>(clock_type::now() - start).count();
+}
+
+auto check_valid(const pot_table& pots, const std::string& path) -> void
+{
+    assert_that(pots.valid(), std::format("{} is not a pot table", path));
+}
+
+auto build(const options& opts) -> int
+{
+    const auto& c = opts.config;
+    std::print("simulating {} grid points x {} shots on {} threads\n",
+               2 * c.cut.count * c.pocket_distance.count * c.cue_distance.count, c.samples, opts.threads);
+    auto pool = thread_pool{opts.threads - 1};
+    const auto start = clock_type::now();
+    const auto data = build_pot_table(pool, c);
+    assert_that(write_pot_table(opts.file, c, data), std::format("could not write {}", opts.file));
+    std::print("wrote {} in {:.1f}s\n", opts.file, elapsed_ms(start) / 1000.0);
+    return 0;
+}
+
+auto show(const options& opts) -> int
+{
+    const auto pots = pot_table{opts.file};
+    check_valid(pots, opts.file);
+    const auto& h = pots.header();
+    const auto cue = (h.cue_distance.min + h.cue_distance.max) / 2.0f;
+
+    for (const auto kind : {pocket_kind::corner, pocket_kind::centre}) {
+        std::print("{} pocket, cue ball {:.0f}cm from the ghost ball ({} shots per point)\n",
+                   kind == pocket_kind::corner ? "corner" : "centre", cue, h.samples);
+        std::print("  cut \\ dist");
+        for (u32 p = 0; p != h.pocket_distance.count; ++p) std::print(" {:5.0f}", h.pocket_distance.value(p));
+        std::print("\n");
+        for (u32 c = 0; c != h.cut.count; ++c) {
+            std::print("  {:8.1f}", h.cut.value(c));
+            for (u32 p = 0; p != h.pocket_distance.count; ++p) {
+                std::print(" {:5.2f}", pots.probability(kind, h.cut.value(c), h.pocket_distance.value(p), cue));
+            }
+            std::print("\n");
+        }
+    }
+    return 0;
+}
+
+auto check(const options& opts) -> int
+{
+    const auto pots = pot_table{opts.file};
+    check_valid(pots, opts.file);
+    const auto& h = pots.header();
+    auto config = opts.config;
+    config.aim_error = h.aim_error;
+
+    auto rng = std::mt19937{12345};
+    auto uniform = [&](const pot_table_axis& axis) { return std::uniform_real_distribution<f32>{axis.min, axis.max}(rng); };
+
+    auto total_error = 0.0;
+    auto compared = 0;
+    auto simulate_ms = 0.0;
+    for (i32 i = 0; i != opts.points; ++i) {
+        const auto kind = i % 2 == 0 ? pocket_kind::corner : pocket_kind::centre;
+        const auto cut = uniform(h.cut);
+        const auto pocket = uniform(h.pocket_distance);
+        const auto cue = uniform(h.cue_distance);
+
+        const auto start = clock_type::now();
+        const auto simulated = simulate_pot_chance(config, kind, cut, pocket, cue, static_cast<u32>(i));
+        simulate_ms += elapsed_ms(start);
+        if (std::isnan(simulated)) continue;
+        total_error += std::abs(pots.probability(kind, cut, pocket, cue) - simulated);
+        ++compared;
+    }
+
+    constexpr auto lookups = 1'000'000;
+    auto sum = 0.0f;
+    const auto start = clock_type::now();
+    for (i32 i = 0; i != lookups; ++i) {
+        sum += pots.probability(i % 2 == 0 ? pocket_kind::corner : pocket_kind::centre, uniform(h.cut), uniform(h.pocket_distance), uniform(h.cue_distance));
+    }
+    const auto lookup_ns = elapsed_ms(start) * 1e6 / lookups;
+
+    std::print("{} playable random points: mean |lookup - simulated| {:.3f} with {} shots per simulation\n",
+               compared, compared ? total_error / compared : 0.0, config.samples);
+    std::print("lookup {:.0f}ns including three random numbers (checksum {:.1f}), simulating {:.1f}ms per point\n",
+               lookup_ns, sum, simulate_ms / opts.points);
+    return 0;
+}
+
+auto compare(const options& opts) -> int
+{
+    const auto pots = pot_table{opts.file};
+    check_valid(pots, opts.file);
+    for (const auto with_table : {false, true}) {
+        auto shots = std::size_t{0};
+        auto potted = 0;
+        const auto start = clock_type::now();
+        for (i32 i = 0; i != opts.matches; ++i) {
+            auto m = match{static_cast<u32>(1000 + i), match_config{ .pots=with_table ? &pots : nullptr }};
+            while (m.advance(60 * 60) == match_status::playing) {}
+            shots += m.get_replay().shots.size();
+            potted += m.scores()[0] + m.scores()[1];
+        }
+        std::print("{:<13} {} matches, {:.3f} balls potted per shot, {:.0f}ms\n", with_table ? "with table" : "without",
+                   opts.matches, static_cast<f64>(potted) / std::max<std::size_t>(shots, 1), elapsed_ms(start));
+    }
+    return 0;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    if (opts.mode == "build")   return build(opts);
+    if (opts.mode == "show")    return show(opts);
+    if (opts.mode == "check")   return check(opts);
+    if (opts.mode == "compare") return compare(opts);
+    std::print("unknown mode '{}'\n", opts.mode);
+    return 1;
+}
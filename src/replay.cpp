@@ -0,0 +1,58 @@
+#include "replay.hpp"
+
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace snooker {
+namespace {
+
+auto parse_float(const std::string& token) -> float
+{
+    auto value = 0.0f;
+    const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    assert_that(ec == std::errc{}, std::format("bad float in replay: {}", token));
+    return value;
+}
+
+}
+
+auto save_replay(const std::string& path, const replay& r) -> bool
+{
+    auto file = std::ofstream{path};
+    if (!file.good()) return false;
+    file << std::format("seed {}\n", r.seed);
+    for (const auto& s : r.shots) {
+        file << std::format("shot {} {} {} {} {} {} {}\n", s.player, s.shot.direction.x, s.shot.direction.y,
+                            s.shot.power, s.shot.spin_factor, s.steps, s.state_hash);
+    }
+    return file.good();
+}
+
+auto load_replay(const std::string& path) -> std::optional<replay>
+{
+    auto file = std::ifstream{path};
+    if (!file.good()) return {};
+
+    auto r = replay{};
+    auto line = std::string{};
+    while (std::getline(file, line)) {
+        auto stream = std::istringstream{line};
+        auto kind = std::string{};
+        stream >> kind;
+        if (kind == "seed") {
+            stream >> r.seed;
+        }
+        else if (kind == "shot") {
+            auto s = replay_shot{};
+            auto dx = std::string{}, dy = std::string{}, power = std::string{}, spin = std::string{};
+            stream >> s.player >> dx >> dy >> power >> spin >> s.steps >> s.state_hash;
+            s.shot = cue_shot{ .direction={parse_float(dx), parse_float(dy)}, .power=parse_float(power), .spin_factor=parse_float(spin) };
+            r.shots.push_back(s);
+        }
+    }
+    return r;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "rollout.hpp"
+#include "utility.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace snooker {
+
+struct replay_shot
+{
+    i32      player;
+    cue_shot shot;
+    i32      steps;      // steps taken until the balls came to rest
+    u64      state_hash; // simulation state hash once at rest
+};
+
+// Everything needed to reproduce a match: the table is rebuilt from the seed and
+// the shots are replayed in order, checking the state hash after each one.
+struct replay
+{
+    u32                      seed = 0;
+    std::vector<replay_shot> shots;
+};
+
+// Text format, one "seed" line followed by one "shot" line per shot. Floats are
+// written in their shortest round trip form so replays reproduce exactly.
+auto save_replay(const std::string& path, const replay& r) -> bool;
+auto load_replay(const std::string& path) -> std::optional<replay>;
+
+}
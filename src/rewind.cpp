@@ -0,0 +1,250 @@
+#include "rewind.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace snooker {
+namespace {
+
+constexpr auto floats_per_ball = 6;
+
+auto to_floats(const glm::vec2& pos, const glm::vec2& vel, const glm::vec2& angular_vel) -> std::array<f32, floats_per_ball>
+{
+    return {pos.x, pos.y, vel.x, vel.y, angular_vel.x, angular_vel.y};
+}
+
+}
+
+rewind_buffer::rewind_buffer(rewind_config config)
+    : d_config{config}
+    , d_interval{config.interval}
+{
+    assert_that(config.interval > 0, "rewind interval must be positive");
+}
+
+auto rewind_buffer::read_state(const table& t, std::vector<ball_state>& out) const -> void
+{
+    out.resize(d_slots.size());
+    for (std::size_t i = 0; i != d_slots.size(); ++i) {
+        if (!d_on_table[i]) continue;
+        const auto& coll = t.sim.get(d_slots[i]);
+        const auto& body = std::get<dynamic_body>(coll.body);
+        out[i] = ball_state{ .pos=coll.pos, .vel=body.vel, .angular_vel=body.angular_vel };
+    }
+}
+
+auto rewind_buffer::begin_shot(const table& t, const cue_shot& shot) -> void
+{
+    clear();
+    d_start = t;
+    d_shot = shot;
+    d_slots.push_back(t.cue_ball.id);
+    for (const auto& b : t.object_balls) d_slots.push_back(b.id);
+    d_on_table.assign(d_slots.size(), true);
+
+    auto played = t;
+    apply_shot(played, shot);
+    read_state(played, d_base);
+    d_last = d_base;
+}
+
+// Appends a snapshot holding a bitmap of the balls that changed since the last
+// snapshot, then for each of those a byte saying which of its floats changed
+// followed by their bits
+auto rewind_buffer::encode(const table& t) -> void
+{
+    d_snapshots.push_back({d_steps, d_bytes.size()});
+    const auto bitmap_at = d_bytes.size();
+    d_bytes.resize(d_bytes.size() + (d_slots.size() + 7) / 8);
+
+    for (std::size_t i = 0; i != d_slots.size(); ++i) {
+        if (!d_on_table[i]) continue;
+        const auto& coll = t.sim.get(d_slots[i]);
+        const auto& body = std::get<dynamic_body>(coll.body);
+        const auto now = to_floats(coll.pos, body.vel, body.angular_vel);
+        const auto before = to_floats(d_last[i].pos, d_last[i].vel, d_last[i].angular_vel);
+
+        auto mask = u8{0};
+        for (i32 k = 0; k != floats_per_ball; ++k) {
+            if (std::bit_cast<u32>(now[k]) != std::bit_cast<u32>(before[k])) mask |= u8{1} << k;
+        }
+        if (mask == 0) continue;
+
+        d_bytes[bitmap_at + i / 8] |= std::byte{1} << (i % 8);
+        d_bytes.push_back(std::byte{mask});
+        for (i32 k = 0; k != floats_per_ball; ++k) {
+            if (!(mask & (u8{1} << k))) continue;
+            const auto offset = d_bytes.size();
+            d_bytes.resize(offset + sizeof(f32));
+            std::memcpy(d_bytes.data() + offset, &now[k], sizeof(f32));
+        }
+        d_last[i] = ball_state{ .pos=coll.pos, .vel=body.vel, .angular_vel=body.angular_vel };
+    }
+}
+
+auto rewind_buffer::apply_snapshot(std::size_t s, std::vector<ball_state>& state) const -> void
+{
+    const auto bitmap_at = d_snapshots[s].offset;
+    auto offset = bitmap_at + (d_slots.size() + 7) / 8;
+    for (std::size_t i = 0; i != d_slots.size(); ++i) {
+        if ((d_bytes[bitmap_at + i / 8] & (std::byte{1} << (i % 8))) == std::byte{0}) continue;
+        const auto mask = std::to_integer<u8>(d_bytes[offset++]);
+        auto floats = to_floats(state[i].pos, state[i].vel, state[i].angular_vel);
+        for (i32 k = 0; k != floats_per_ball; ++k) {
+            if (!(mask & (u8{1} << k))) continue;
+            std::memcpy(&floats[k], d_bytes.data() + offset, sizeof(f32));
+            offset += sizeof(f32);
+        }
+        state[i] = ball_state{ .pos={floats[0], floats[1]}, .vel={floats[2], floats[3]}, .angular_vel={floats[4], floats[5]} };
+    }
+}
+
+auto rewind_buffer::decode(std::size_t count) const -> std::vector<ball_state>
+{
+    auto state = d_base;
+    for (std::size_t s = 0; s != count; ++s) apply_snapshot(s, state);
+    return state;
+}
+
+// Keeps every other snapshot, re-encoding the survivors against each other. The
+// snapshots are decoded in one pass, keeping the running state at each survivor.
+auto rewind_buffer::thin_out() -> void
+{
+    auto kept = std::vector<std::pair<i32, std::vector<ball_state>>>{};
+    kept.reserve(d_snapshots.size() / 2);
+    auto state = d_base;
+    for (std::size_t s = 0; s != d_snapshots.size(); ++s) {
+        apply_snapshot(s, state);
+        if (s % 2 == 1) kept.emplace_back(d_snapshots[s].step, state);
+    }
+    const auto on_table = d_on_table;
+
+    d_snapshots.clear();
+    d_bytes.clear();
+    d_last = d_base;
+    auto scratch = *d_start;
+    for (const auto& [step, state] : kept) {
+        // Encode reads the table, so stage each state in a scratch copy first
+        d_on_table.assign(d_slots.size(), true);
+        for (const auto& event : d_pockets) {
+            if (event.step > step) break;
+            d_on_table[std::ranges::find(d_slots, event.id) - d_slots.begin()] = false;
+        }
+        for (std::size_t i = 0; i != d_slots.size(); ++i) {
+            if (!d_on_table[i]) continue;
+            auto& coll = scratch.sim.get(d_slots[i]);
+            auto& body = std::get<dynamic_body>(coll.body);
+            coll.pos = state[i].pos;
+            body.vel = state[i].vel;
+            body.angular_vel = state[i].angular_vel;
+        }
+        const auto steps = d_steps;
+        d_steps = step;
+        encode(scratch);
+        d_steps = steps;
+    }
+    d_on_table = on_table;
+    d_interval *= 2;
+}
+
+auto rewind_buffer::record_step(const table& t) -> void
+{
+    if (!d_start || d_finished) return;
+    ++d_steps;
+
+    // remove_pocketed_balls works through the balls in order, as does this, so
+    // replaying these events removes them in the same order and leaves the collider
+    // storage exactly as it was
+    for (std::size_t i = 0; i != d_slots.size(); ++i) {
+        if (d_on_table[i] && !t.sim.is_valid(d_slots[i])) {
+            d_on_table[i] = false;
+            d_pockets.push_back({d_steps, d_slots[i]});
+        }
+    }
+
+    // Once the balls stop there is nothing left to scrub through, so the recording
+    // ends there with a snapshot of where they stopped
+    d_finished = t.sim.is_at_rest();
+    if (d_steps % d_interval != 0 && !d_finished) return;
+    encode(t);
+    if (d_bytes.size() > d_config.max_bytes) thin_out();
+}
+
+auto rewind_buffer::seek(table& t, i32 step) const -> void
+{
+    assert_that(d_start.has_value(), "no shot to seek through");
+    step = std::clamp(step, 0, d_steps);
+    t = *d_start;
+    if (step == 0) return;
+    apply_shot(t, d_shot);
+
+    const auto it = std::ranges::upper_bound(d_snapshots, step, {}, &snapshot::step);
+    const auto count = static_cast<std::size_t>(it - d_snapshots.begin());
+    auto from = 0;
+    if (count > 0) {
+        from = d_snapshots[count - 1].step;
+        for (const auto& event : d_pockets) {
+            if (event.step > from) break;
+            t.sim.remove(event.id);
+            std::erase_if(t.object_balls, [&](const ball& b) { return b.id == event.id; });
+        }
+        const auto state = decode(count);
+        for (std::size_t i = 0; i != d_slots.size(); ++i) {
+            if (!t.sim.is_valid(d_slots[i])) continue;
+            auto& coll = t.sim.get(d_slots[i]);
+            auto& body = std::get<dynamic_body>(coll.body);
+            coll.pos = state[i].pos;
+            body.vel = state[i].vel;
+            body.angular_vel = state[i].angular_vel;
+        }
+    }
+
+    for (auto s = from; s != step; ++s) {
+        t.sim.step();
+        remove_pocketed_balls(t);
+    }
+}
+
+auto rewind_buffer::truncate(i32 step) -> void
+{
+    if (!d_start || step >= d_steps) return;
+    step = std::max(step, 0);
+    const auto it = std::ranges::upper_bound(d_snapshots, step, {}, &snapshot::step);
+    const auto count = static_cast<std::size_t>(it - d_snapshots.begin());
+    d_bytes.resize(count < d_snapshots.size() ? d_snapshots[count].offset : d_bytes.size());
+    d_snapshots.resize(count);
+    d_last = decode(count);
+
+    std::erase_if(d_pockets, [&](const pocket_event& e) { return e.step > step; });
+    d_on_table.assign(d_slots.size(), true);
+    for (const auto& event : d_pockets) {
+        d_on_table[std::ranges::find(d_slots, event.id) - d_slots.begin()] = false;
+    }
+    d_steps = step;
+    d_finished = false;
+}
+
+auto rewind_buffer::clear() -> void
+{
+    d_start.reset();
+    d_slots.clear();
+    d_base.clear();
+    d_last.clear();
+    d_on_table.clear();
+    d_snapshots.clear();
+    d_bytes.clear();
+    d_pockets.clear();
+    d_steps = 0;
+    d_finished = false;
+    d_interval = d_config.interval;
+}
+
+auto rewind_buffer::memory_used() const -> std::size_t
+{
+    return d_bytes.size() + d_snapshots.size() * sizeof(snapshot) + d_pockets.size() * sizeof(pocket_event)
+         + (d_base.size() + d_last.size()) * sizeof(ball_state);
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "rollout.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace snooker {
+
+struct rewind_config
+{
+    i32         interval  = 6;         // steps between snapshots, doubled whenever the budget is hit
+    std::size_t max_bytes = 64 * 1024; // budget for the encoded snapshots of one shot
+};
+
+// Records the shot in progress so it can be undone or scrubbed through. The table
+// is copied once when the shot is played and after that a snapshot of the balls is
+// taken every few steps. Each snapshot stores only the floats that changed since the
+// one before, bit for bit, so balls at rest cost a single bit and any snapshot can be
+// restored exactly. Seeking restores the nearest snapshot at or before the target
+// and steps forward from there, which reproduces the original shot exactly. When the
+// snapshots outgrow their budget every other one is dropped and the interval doubles,
+// so memory stays bounded however long the balls take to stop.
+class rewind_buffer
+{
+    struct ball_state
+    {
+        glm::vec2 pos;
+        glm::vec2 vel;
+        glm::vec2 angular_vel;
+    };
+
+    struct snapshot
+    {
+        i32         step;
+        std::size_t offset; // into d_bytes
+    };
+
+    struct pocket_event
+    {
+        i32         step;
+        std::size_t id;
+    };
+
+    rewind_config d_config;
+    i32           d_interval;
+
+    std::optional<table>      d_start; // before the shot was played
+    cue_shot                  d_shot = {};
+    std::vector<std::size_t>  d_slots; // cue ball then object balls, as at the start
+    std::vector<ball_state>   d_base;  // just after the shot was played
+    std::vector<ball_state>   d_last;  // as of the last snapshot
+    std::vector<bool>         d_on_table;
+    std::vector<snapshot>     d_snapshots;
+    std::vector<std::byte>    d_bytes;
+    std::vector<pocket_event> d_pockets;
+    i32                       d_steps = 0;
+    bool                      d_finished = false; // the balls came to rest
+
+    auto read_state(const table& t, std::vector<ball_state>& out) const -> void;
+    auto encode(const table& t) -> void;
+    auto apply_snapshot(std::size_t s, std::vector<ball_state>& state) const -> void;
+    auto decode(std::size_t count) const -> std::vector<ball_state>; // state after the first count snapshots
+    auto thin_out() -> void;
+
+public:
+    explicit rewind_buffer(rewind_config config = {});
+
+    // Starts recording a shot, given the table just before the shot is applied
+    auto begin_shot(const table& t, const cue_shot& shot) -> void;
+
+    // Call after every step of the shot, once pocketed balls have been removed. The
+    // recording ends when the balls come to rest and later steps are ignored.
+    auto record_step(const table& t) -> void;
+
+    // Sets t to how the recorded shot stood after the given number of steps, where 0
+    // is just before it was played. Steps past the end of the recording are clamped.
+    auto seek(table& t, i32 step) const -> void;
+
+    // Forgets everything after the given step, so that recording can carry on from a
+    // table that was seeked there
+    auto truncate(i32 step) -> void;
+
+    auto clear() -> void;
+
+    auto has_shot() const -> bool { return d_start.has_value(); }
+    auto steps() const -> i32 { return d_steps; }
+    auto snapshots() const -> std::size_t { return d_snapshots.size(); }
+    auto interval() const -> i32 { return d_interval; }
+    auto memory_used() const -> std::size_t;
+};
+
+}
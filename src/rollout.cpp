@@ -0,0 +1,65 @@
+#include "rollout.hpp"
+
+namespace snooker {
+namespace {
+
+auto rollout_task(const table& t, cue_shot shot, std::stop_token stop) -> task<rollout_result>
+{
+    if (stop.stop_requested()) co_return rollout_result{ .shot=shot };
+    co_return rollout(t, shot, 60 * 60, stop);
+}
+
+}
+
+auto apply_shot(table& t, const cue_shot& shot) -> void
+{
+    auto& coll = t.sim.get(t.cue_ball.id);
+    auto& body = std::get<dynamic_body>(coll.body);
+    body.vel   = shot.power * shot.direction;
+
+    // The axis of spin is always perpendicular to the direction of motion
+    const auto radius = std::get<circle_shape>(coll.shape).radius;
+    body.angular_vel = shot.spin_factor * glm::vec2{-body.vel.y, body.vel.x} / radius;
+}
+
+auto simulate_to_rest(table& t, i32 max_steps, std::stop_token stop) -> i32
+{
+    for (i32 step = 0; step != max_steps; ++step) {
+        if (t.sim.is_at_rest() || stop.stop_requested()) return step;
+        t.sim.step();
+        remove_pocketed_balls(t);
+    }
+    return max_steps;
+}
+
+auto rollout(table t, const cue_shot& shot, i32 max_steps, std::stop_token stop) -> rollout_result
+{
+    const auto balls_before = static_cast<i32>(t.object_balls.size());
+    apply_shot(t, shot);
+    const auto steps = simulate_to_rest(t, max_steps, stop);
+
+    return rollout_result{
+        .shot=shot,
+        .completed=steps == max_steps || t.sim.is_at_rest(),
+        .steps=steps,
+        .balls_potted=balls_before - static_cast<i32>(t.object_balls.size()),
+        .cue_ball_in_pocket=cue_ball_in_pocket(t)
+    };
+}
+
+auto rollout(const table& t, const cue_shot& shot, i32 max_steps, std::pmr::memory_resource* resource) -> rollout_result
+{
+    return rollout(copy_table(t, resource), shot, max_steps);
+}
+
+auto rollout_batch(executor& exec, table t, std::vector<cue_shot> shots, std::stop_token stop) -> task<std::vector<rollout_result>>
+{
+    auto tasks = std::vector<task<rollout_result>>{};
+    tasks.reserve(shots.size());
+    for (const auto& shot : shots) {
+        tasks.push_back(rollout_task(t, shot, stop));
+    }
+    co_return co_await exec.when_all(std::move(tasks));
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "table.hpp"
+#include "utility.hpp"
+#include "executor.hpp"
+#include "task.hpp"
+
+#include <glm/glm.hpp>
+
+#include <stop_token>
+#include <vector>
+
+namespace snooker {
+
+struct cue_shot
+{
+    glm::vec2 direction;          // unit vector
+    float     power;              // initial cue ball speed in cm/s
+    float     spin_factor = 0.0f; // -1 = full backspin, 0 = stun, +1 = full topspin
+};
+
+// Strikes the cue ball with the given shot.
+auto apply_shot(table& t, const cue_shot& shot) -> void;
+
+// Steps the simulation, removing pocketed balls as it goes, until every ball has
+// stopped, max_steps have been taken or stop is requested. Returns the number of
+// steps taken.
+auto simulate_to_rest(table& t, i32 max_steps = 60 * 60, std::stop_token stop = {}) -> i32;
+
+struct rollout_result
+{
+    cue_shot shot;
+    bool     completed    = false; // false if cancelled before it finished
+    i32      steps        = 0;
+    i32      balls_potted = 0;
+    bool     cue_ball_in_pocket = false;
+};
+
+// Plays the shot out on a copy of the table, giving up if stop is requested.
+auto rollout(table t, const cue_shot& shot, i32 max_steps = 60 * 60, std::stop_token stop = {}) -> rollout_result;
+
+// As above, with the copy's simulation drawing from the given resource. Everything
+// it allocated has been freed again by the time this returns, so a per-worker arena
+// can be released between rollouts.
+auto rollout(const table& t, const cue_shot& shot, i32 max_steps, std::pmr::memory_resource* resource) -> rollout_result;
+
+// Plays every shot out on its own copy of the table across the executor's pool. The
+// table is copied when this is called, so the caller may keep stepping its own.
+// Stopping is checked between steps, so a cancelled batch finishes within a step
+// and its unfinished shots are left not completed.
+auto rollout_batch(executor& exec, table t, std::vector<cue_shot> shots, std::stop_token stop) -> task<std::vector<rollout_result>>;
+
+}
@@ -0,0 +1,252 @@
+#include "shot_library.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+namespace snooker {
+namespace {
+
+// Every layout is on the standard table
+constexpr auto table_length = 182.88f;
+constexpr auto table_width  = 91.44f;
+
+auto distance_squared(const library_features& a, const library_features& b) -> f32
+{
+    auto sum = 0.0f;
+    for (std::size_t i = 0; i != library_dims; ++i) {
+        const auto d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+// Builds the implicit tree over order[lo, hi), splitting on the widest dimension
+auto build_tree(const std::vector<library_features>& features, std::vector<std::size_t>& order, std::vector<u8>& splits,
+                std::size_t lo, std::size_t hi) -> void
+{
+    if (hi - lo <= 1) return;
+
+    auto lowest = library_features{};
+    auto highest = library_features{};
+    lowest.fill(std::numeric_limits<f32>::max());
+    highest.fill(std::numeric_limits<f32>::lowest());
+    for (auto i = lo; i != hi; ++i) {
+        for (std::size_t d = 0; d != library_dims; ++d) {
+            lowest[d] = std::min(lowest[d], features[order[i]][d]);
+            highest[d] = std::max(highest[d], features[order[i]][d]);
+        }
+    }
+    auto dim = std::size_t{0};
+    for (std::size_t d = 1; d != library_dims; ++d) {
+        if (highest[d] - lowest[d] > highest[dim] - lowest[dim]) dim = d;
+    }
+
+    const auto mid = lo + (hi - lo) / 2;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](std::size_t a, std::size_t b) {
+        return features[a][dim] < features[b][dim];
+    });
+    splits[mid] = static_cast<u8>(dim);
+    build_tree(features, order, splits, lo, mid);
+    build_tree(features, order, splits, mid + 1, hi);
+}
+
+struct search_state
+{
+    const library_features&             query;
+    std::size_t                         k;
+    std::vector<std::pair<f32, std::size_t>> best; // max heap on distance
+};
+
+auto search_tree(const library_features* features, const u8* splits, search_state& state, std::size_t lo, std::size_t hi) -> void
+{
+    if (lo >= hi) return;
+    const auto mid = lo + (hi - lo) / 2;
+
+    const auto d = distance_squared(state.query, features[mid]);
+    if (state.best.size() < state.k) {
+        state.best.emplace_back(d, mid);
+        std::ranges::push_heap(state.best);
+    } else if (d < state.best.front().first) {
+        std::ranges::pop_heap(state.best);
+        state.best.back() = {d, mid};
+        std::ranges::push_heap(state.best);
+    }
+    if (hi - lo == 1) return;
+
+    const auto dim = splits[mid];
+    const auto diff = state.query[dim] - features[mid][dim];
+    const auto [near_lo, near_hi, far_lo, far_hi] = diff < 0.0f ? std::array{lo, mid, mid + 1, hi} : std::array{mid + 1, hi, lo, mid};
+    search_tree(features, splits, state, near_lo, near_hi);
+    if (state.best.size() < state.k || diff * diff < state.best.front().first) {
+        search_tree(features, splits, state, far_lo, far_hi);
+    }
+}
+
+template <typename T>
+auto write_array(std::ofstream& file, const T* data, std::size_t count) -> void
+{
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+}
+
+auto layout_features(glm::vec2 cue_ball, std::span<const glm::vec2> object_balls) -> library_features
+{
+    auto features = library_features{};
+    features[0] = library_cue_weight * cue_ball.x / table_length;
+    features[1] = library_cue_weight * cue_ball.y / table_length;
+
+    // Lattice points sit at the centres of a library_lattice_x by library_lattice_y grid
+    const auto cell = glm::vec2{table_length / library_lattice_x, table_width / library_lattice_y};
+    for (const auto pos : object_balls) {
+        const auto p = pos / cell - 0.5f;
+        const auto x0 = std::clamp(static_cast<i32>(std::floor(p.x)), 0, library_lattice_x - 2);
+        const auto y0 = std::clamp(static_cast<i32>(std::floor(p.y)), 0, library_lattice_y - 2);
+        const auto fx = std::clamp(p.x - x0, 0.0f, 1.0f);
+        const auto fy = std::clamp(p.y - y0, 0.0f, 1.0f);
+        const auto add = [&](i32 x, i32 y, f32 w) { features[2 + y * library_lattice_x + x] += w; };
+        add(x0,     y0,     (1 - fx) * (1 - fy));
+        add(x0 + 1, y0,     fx * (1 - fy));
+        add(x0,     y0 + 1, (1 - fx) * fy);
+        add(x0 + 1, y0 + 1, fx * fy);
+    }
+    return features;
+}
+
+auto layout_features(const table& t) -> library_features
+{
+    auto object_balls = std::vector<glm::vec2>{};
+    for (const auto& b : t.object_balls) {
+        object_balls.push_back(t.sim.get(b.id).pos);
+    }
+    return layout_features(t.sim.get(t.cue_ball.id).pos, object_balls);
+}
+
+auto shot_library_builder::add(const table& t, const cue_shot& shot, const shot_outcome& outcome) -> void
+{
+    auto entry = library_entry{
+        .cue_ball = t.sim.get(t.cue_ball.id).pos,
+        .object_balls = {},
+        .num_object_balls = 0,
+        .dx = shot.direction.x,
+        .dy = shot.direction.y,
+        .power = shot.power,
+        .spin = shot.spin_factor,
+        .balls_potted = outcome.balls_potted,
+        .foul = outcome.foul ? 1 : 0,
+        .steps = outcome.steps
+    };
+    for (const auto& b : t.object_balls) {
+        if (entry.num_object_balls == library_max_balls) break;
+        entry.object_balls[entry.num_object_balls++] = t.sim.get(b.id).pos;
+    }
+    add(entry);
+}
+
+auto shot_library_builder::add(const library_entry& entry) -> void
+{
+    add(layout_features(entry.cue_ball, std::span{entry.object_balls}.first(entry.num_object_balls)), entry);
+}
+
+auto shot_library_builder::add(const library_features& features, const library_entry& entry) -> void
+{
+    d_features.push_back(features);
+    d_entries.push_back(entry);
+}
+
+auto shot_library_builder::merge(const shot_library_builder& other) -> void
+{
+    d_features.insert(d_features.end(), other.d_features.begin(), other.d_features.end());
+    d_entries.insert(d_entries.end(), other.d_entries.begin(), other.d_entries.end());
+}
+
+auto shot_library_builder::write(const std::string& path) -> bool
+{
+    auto order = std::vector<std::size_t>(d_entries.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    auto splits = std::vector<u8>(d_entries.size());
+    build_tree(d_features, order, splits, 0, order.size());
+
+    auto features = std::vector<library_features>{};
+    auto entries = std::vector<library_entry>{};
+    features.reserve(order.size());
+    entries.reserve(order.size());
+    for (const auto i : order) {
+        features.push_back(d_features[i]);
+        entries.push_back(d_entries[i]);
+    }
+
+    auto file = std::ofstream{path, std::ios::binary};
+    if (!file) return false;
+    const auto header = library_header{library_magic, library_version, library_dims, library_max_balls, order.size()};
+    write_array(file, &header, 1);
+    write_array(file, features.data(), features.size());
+    write_array(file, splits.data(), splits.size());
+
+    // Keep the entries aligned after the byte-sized splits
+    const auto padding = (alignof(library_entry) - (sizeof(header) + features.size() * sizeof(library_features) + splits.size()) % alignof(library_entry)) % alignof(library_entry);
+    const auto zeros = std::array<char, alignof(library_entry)>{};
+    file.write(zeros.data(), static_cast<std::streamsize>(padding));
+    write_array(file, entries.data(), entries.size());
+    return file.good();
+}
+
+shot_library::shot_library(const std::string& path)
+    : d_file{path}
+{
+    if (!d_file.valid() || d_file.size() < sizeof(library_header)) return;
+    auto header = library_header{};
+    std::memcpy(&header, d_file.data(), sizeof(header));
+    if (header.magic != library_magic || header.version != library_version
+        || header.dims != library_dims || header.max_balls != library_max_balls) {
+        return;
+    }
+
+    const auto features_offset = sizeof(library_header);
+    const auto splits_offset = features_offset + header.count * sizeof(library_features);
+    auto entries_offset = splits_offset + header.count;
+    entries_offset += (alignof(library_entry) - entries_offset % alignof(library_entry)) % alignof(library_entry);
+    if (d_file.size() < entries_offset + header.count * sizeof(library_entry)) return;
+
+    d_count = header.count;
+    d_features = reinterpret_cast<const library_features*>(d_file.data() + features_offset);
+    d_splits = reinterpret_cast<const u8*>(d_file.data() + splits_offset);
+    d_entries = reinterpret_cast<const library_entry*>(d_file.data() + entries_offset);
+}
+
+auto shot_library::nearest(const library_features& query, std::size_t k) const -> std::vector<library_match>
+{
+    auto state = search_state{query, k, {}};
+    if (valid() && k > 0) {
+        state.best.reserve(k);
+        search_tree(d_features, d_splits, state, 0, d_count);
+    }
+    std::ranges::sort_heap(state.best);
+
+    auto matches = std::vector<library_match>{};
+    matches.reserve(state.best.size());
+    for (const auto& [d, index] : state.best) {
+        matches.push_back({std::sqrt(d), &d_entries[index]});
+    }
+    return matches;
+}
+
+auto shot_library::nearest(const table& t, std::size_t k) const -> std::vector<library_match>
+{
+    return nearest(layout_features(t), k);
+}
+
+auto suggest_shots(const shot_library& library, const table& t, std::size_t k) -> std::vector<cue_shot>
+{
+    auto shots = std::vector<cue_shot>{};
+    for (const auto& m : library.nearest(t, k)) {
+        if (m.entry->balls_potted > 0 && !m.entry->foul) shots.push_back(m.entry->shot());
+    }
+    return shots;
+}
+
+}
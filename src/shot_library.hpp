@@ -0,0 +1,127 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "rollout.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace snooker {
+
+// Layouts are compared by a small feature vector that doesn't depend on the order of
+// the balls: the cue ball position, weighted up since it matters most for which shot
+// works, followed by how many object balls are near each point of a coarse lattice
+// over the table. Each ball is spread bilinearly over its four nearest lattice
+// points, so moving a ball slightly only changes the features slightly.
+constexpr auto library_lattice_x  = 4;
+constexpr auto library_lattice_y  = 2;
+constexpr auto library_dims       = 2 + library_lattice_x * library_lattice_y;
+constexpr auto library_cue_weight = 4.0f;
+constexpr auto library_max_balls  = 15;
+
+using library_features = std::array<f32, library_dims>;
+
+auto layout_features(glm::vec2 cue_ball, std::span<const glm::vec2> object_balls) -> library_features;
+auto layout_features(const table& t) -> library_features;
+
+struct shot_outcome
+{
+    i32  balls_potted = 0;
+    bool foul         = false;
+    i32  steps        = 0;
+};
+
+// Everything recorded about one past shot. The layout is what the table looked like
+// before the shot was played.
+struct library_entry
+{
+    glm::vec2                                 cue_ball;
+    std::array<glm::vec2, library_max_balls>  object_balls;
+    u32                                       num_object_balls;
+    f32                                       dx;
+    f32                                       dy;
+    f32                                       power;
+    f32                                       spin;
+    i32                                       balls_potted;
+    i32                                       foul;
+    i32                                       steps;
+
+    auto shot() const -> cue_shot { return { .direction={dx, dy}, .power=power, .spin_factor=spin }; }
+};
+
+struct library_match
+{
+    f32                  distance; // in feature space
+    const library_entry* entry;
+};
+
+// On disk a library is a header followed by three arrays in k-d tree order: the
+// features, the split dimension of each node and the entries. The tree is implicit:
+// the node for entries [lo, hi) is at (lo + hi) / 2, with the entries below it
+// on its split dimension to the left. A search only touches the features and splits,
+// which are a fifth of the file, and the whole thing is used straight from the mapping.
+constexpr auto library_magic   = u32{0x42494c53}; // "SLIB"
+constexpr auto library_version = u32{1};
+
+struct library_header
+{
+    u32 magic;
+    u32 version;
+    u32 dims;
+    u32 max_balls;
+    u64 count;
+};
+
+// Collects entries in memory and writes them out as a library file
+class shot_library_builder
+{
+    std::vector<library_features> d_features;
+    std::vector<library_entry>    d_entries;
+
+public:
+    auto add(const table& t, const cue_shot& shot, const shot_outcome& outcome) -> void;
+    auto add(const library_entry& entry) -> void;
+    auto add(const library_features& features, const library_entry& entry) -> void;
+    auto merge(const shot_library_builder& other) -> void;
+    auto size() const -> std::size_t { return d_entries.size(); }
+
+    // Builds the tree, which reorders the entries, and writes the file
+    auto write(const std::string& path) -> bool;
+};
+
+class shot_library
+{
+    mapped_file             d_file;
+    u64                     d_count    = 0;
+    const library_features* d_features = nullptr;
+    const u8*               d_splits   = nullptr;
+    const library_entry*    d_entries  = nullptr;
+
+    shot_library(const shot_library&) = delete;
+    shot_library& operator=(const shot_library&) = delete;
+
+public:
+    explicit shot_library(const std::string& path);
+
+    // False if the file is missing, truncated or from another version
+    auto valid() const -> bool { return d_entries != nullptr; }
+    auto size() const -> std::size_t { return d_count; }
+    auto features(std::size_t index) const -> const library_features& { return d_features[index]; }
+    auto entry(std::size_t index) const -> const library_entry& { return d_entries[index]; }
+
+    // The k entries with the most similar layouts, closest first
+    auto nearest(const library_features& query, std::size_t k) const -> std::vector<library_match>;
+    auto nearest(const table& t, std::size_t k) const -> std::vector<library_match>;
+};
+
+// Shots that potted a ball without a foul from the most similar of the k nearest
+// layouts, for an AI to try before searching from scratch
+auto suggest_shots(const shot_library& library, const table& t, std::size_t k) -> std::vector<cue_shot>;
+
+}
@@ -0,0 +1,228 @@
+// Builds and queries shot libraries.
+//
+//   shot_library build FILE [--matches N] [--threads N] [--append 1]
+//       play AI matches and record every shot with its layout and outcome
+//   shot_library synth FILE [--count N]
+//       random layouts and shots with no outcomes, for testing search at scale
+//   shot_library query FILE [--seed N] [--k N]
+//       the most similar layouts to a fresh rack and what was played from them
+//   shot_library bench FILE [--queries N] [--k N]
+//       query latency over random layouts
+//   shot_library compare FILE [--matches N]
+//       balls potted per shot by the AI with and without the library to start from
+#include "match.hpp"
+#include "shot_library.hpp"
+#include "table.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <numbers>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::string mode;
+    std::string file;
+    i32         matches = 64;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool        append  = false;
+    i32         count   = 1'000'000;
+    u32         seed    = 1;
+    i32         k       = 8;
+    i32         queries = 10'000;
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    assert_that(argc >= 3, "usage: shot_library build|synth|query|bench|compare FILE [options]");
+    auto opts = options{ .mode=argv[1], .file=argv[2] };
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--matches") opts.matches = std::stoi(value);
+        else if (flag == "--threads") opts.threads = std::stoul(value);
+        else if (flag == "--append")  opts.append = value != "0";
+        else if (flag == "--count")   opts.count = std::stoi(value);
+        else if (flag == "--seed")    opts.seed = static_cast<u32>(std::stoul(value));
+        else if (flag == "--k")       opts.k = std::stoi(value);
+        else if (flag == "--queries") opts.queries = std::stoi(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    return opts;
+}
+
+auto elapsed_ms(clock_type::time_point start) -> f64
+{
+    return std::chrono::duration<f64, std::milli>(clock_type::now() - start).count();
+}
+
+auto random_layout(std::mt19937& rng) -> std::pair<glm::vec2, std::vector<glm::vec2>>
+{
+    auto x = std::uniform_real_distribution<float>{5.0f, 177.0f};
+    auto y = std::uniform_real_distribution<float>{5.0f, 86.0f};
+    auto count = std::uniform_int_distribution<i32>{1, library_max_balls};
+    auto object_balls = std::vector<glm::vec2>(count(rng));
+    for (auto& pos : object_balls) pos = {x(rng), y(rng)};
+    return {{x(rng), y(rng)}, object_balls};
+}
+
+auto check(const shot_library& library, const std::string& path) -> void
+{
+    assert_that(library.valid(), std::format("{} is not a shot library", path));
+}
+
+auto build(const options& opts) -> int
+{
+    // Each match records into its own builder, so the matches can run in parallel
+    auto builders = std::vector<shot_library_builder>(opts.matches);
+    auto pool = thread_pool{opts.threads - 1};
+    const auto start = clock_type::now();
+    pool.parallel_for(builders.size(), [&](std::size_t i) {
+        const auto seed = static_cast<u32>(opts.seed + i);
+        auto m = match{seed, match_config{ .external_shots=true }};
+        auto rng = std::mt19937{seed};
+        while (m.advance(60 * 60) == match_status::playing) {
+            if (!m.awaiting_shot()) continue;
+            const auto before = m.get_table();
+            const auto shot = choose_ai_shot(before, rng);
+            m.take_shot(shot);
+            while (!m.awaiting_shot() && m.advance(60 * 60) == match_status::playing) {}
+            builders[i].add(before, shot, m.last_outcome());
+        }
+    });
+    std::print("played {} matches in {:.0f}ms\n", opts.matches, elapsed_ms(start));
+
+    auto builder = shot_library_builder{};
+    if (opts.append) {
+        const auto existing = shot_library{opts.file};
+        check(existing, opts.file);
+        for (std::size_t i = 0; i != existing.size(); ++i) {
+            builder.add(existing.features(i), existing.entry(i));
+        }
+    }
+    for (const auto& b : builders) builder.merge(b);
+
+    const auto write_start = clock_type::now();
+    assert_that(builder.write(opts.file), std::format("could not write {}", opts.file));
+    std::print("wrote {} shots to {} in {:.0f}ms\n", builder.size(), opts.file, elapsed_ms(write_start));
+    return 0;
+}
+
+auto synth(const options& opts) -> int
+{
+    auto rng = std::mt19937{opts.seed};
+    auto angle = std::uniform_real_distribution<float>{0.0f, 2.0f * std::numbers::pi_v<float>};
+    auto power = std::uniform_real_distribution<float>{100.0f, 600.0f};
+
+    auto builder = shot_library_builder{};
+    for (i32 i = 0; i != opts.count; ++i) {
+        const auto [cue, object_balls] = random_layout(rng);
+        const auto a = angle(rng);
+        auto entry = library_entry{ .cue_ball=cue, .object_balls={}, .num_object_balls=static_cast<u32>(object_balls.size()),
+                                    .dx=std::cos(a), .dy=std::sin(a), .power=power(rng), .spin=0.0f,
+                                    .balls_potted=0, .foul=0, .steps=0 };
+        std::ranges::copy(object_balls, entry.object_balls.begin());
+        builder.add(entry);
+    }
+
+    const auto start = clock_type::now();
+    assert_that(builder.write(opts.file), std::format("could not write {}", opts.file));
+    std::print("wrote {} synthetic shots to {} in {:.0f}ms\n", builder.size(), opts.file, elapsed_ms(start));
+    return 0;
+}
+
+auto query(const options& opts) -> int
+{
+    const auto library = shot_library{opts.file};
+    check(library, opts.file);
+    const auto t = make_standard_table(opts.seed);
+
+    const auto start = clock_type::now();
+    const auto matches = library.nearest(t, opts.k);
+    const auto ms = elapsed_ms(start);
+
+    std::print("{} nearest of {} layouts in {:.3f}ms\n", matches.size(), library.size(), ms);
+    for (const auto& m : matches) {
+        const auto& e = *m.entry;
+        std::print("  distance {:.4f} cue ({:6.2f}, {:6.2f}) {:>2} balls: dir ({:+.3f}, {:+.3f}) power {:5.1f} -> potted {}{}\n",
+                   m.distance, e.cue_ball.x, e.cue_ball.y, e.num_object_balls, e.dx, e.dy, e.power,
+                   e.balls_potted, e.foul ? " foul" : "");
+    }
+    return 0;
+}
+
+auto bench(const options& opts) -> int
+{
+    const auto library = shot_library{opts.file};
+    check(library, opts.file);
+    auto rng = std::mt19937{opts.seed};
+
+    auto times = std::vector<f64>{};
+    times.reserve(opts.queries);
+    for (i32 i = 0; i != opts.queries; ++i) {
+        const auto [cue, object_balls] = random_layout(rng);
+        const auto features = layout_features(cue, object_balls);
+        const auto start = clock_type::now();
+        const auto matches = library.nearest(features, opts.k);
+        times.push_back(elapsed_ms(start));
+        assert_that(matches.size() == std::min<std::size_t>(opts.k, library.size()), "query returned too few matches");
+    }
+
+    std::ranges::sort(times);
+    const auto percentile = [&](f64 p) { return times[static_cast<std::size_t>(p * (times.size() - 1))]; };
+    std::print("{} queries for {} nearest of {} layouts: p50 {:.3f}ms p99 {:.3f}ms max {:.3f}ms\n",
+               times.size(), opts.k, library.size(), percentile(0.5), percentile(0.99), times.back());
+    return 0;
+}
+
+auto compare(const options& opts) -> int
+{
+    const auto library = shot_library{opts.file};
+    check(library, opts.file);
+    for (const auto with_library : {false, true}) {
+        auto shots = std::size_t{0};
+        auto potted = 0;
+        const auto start = clock_type::now();
+        for (i32 i = 0; i != opts.matches; ++i) {
+            // Seeds the library wasn't built from, by default
+            auto m = match{opts.seed + 100'000 + i, match_config{ .library=with_library ? &library : nullptr }};
+            while (m.advance(60 * 60) == match_status::playing) {}
+            shots += m.get_replay().shots.size();
+            potted += m.scores()[0] + m.scores()[1];
+        }
+        std::print("{:<15} {} matches, {:.3f} balls potted per shot, {:.0f}ms\n",
+                   with_library ? "with library" : "without", opts.matches,
+                   static_cast<f64>(potted) / std::max<std::size_t>(shots, 1), elapsed_ms(start));
+    }
+    return 0;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    if (opts.mode == "build")   return build(opts);
+    if (opts.mode == "synth")   return synth(opts);
+    if (opts.mode == "query")   return query(opts);
+    if (opts.mode == "bench")   return bench(opts);
+    if (opts.mode == "compare") return compare(opts);
+    std::print("unknown mode '{}'\n", opts.mode);
+    return 1;
+}
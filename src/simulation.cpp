@@ -1,14 +1,27 @@
 #include "simulation.hpp"
 #include "table.hpp"
 
+#include <array>
+#include <bit>
+#include <chrono>
+#include <numeric>
+#include <utility>
+
 namespace snooker {
 namespace {
 
-struct contact {
-    std::size_t a;     // collider index
-    std::size_t b;     // collider index
-    glm::vec2 normal;  // from A to B (or into circle for wall)
-    float penetration; // overlap depth
+struct solver_result
+{
+    int   iterations = 0;
+    float residual   = 0.0f; // largest normal impulse change during the final iteration
+};
+
+enum class ball_motion
+{
+    none, // not a ball
+    at_rest,
+    rolling,
+    sliding,
 };
 
 struct collision_info
@@ -67,6 +80,22 @@ auto apply_angular_impulse(collider& c, glm::vec2 torque_impulse) -> void
     }
 }
 
+// FNV-1a
+auto hash_combine(u64 hash, u32 value) -> u64
+{
+    for (int i = 0; i != 4; ++i) {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+auto hash_combine(u64 hash, glm::vec2 value) -> u64
+{
+    hash = hash_combine(hash, std::bit_cast<u32>(value.x));
+    return hash_combine(hash, std::bit_cast<u32>(value.y));
+}
+
 auto flip_normal(const collision_info& info) -> collision_info
 {
     auto copy = info;
@@ -193,9 +222,9 @@ auto collision_test(const collider& a, const collider& b) -> std::optional<colli
     }, a.shape, b.shape);
 }
 
-auto generate_contacts(const std::vector<collider>& colliders) -> std::vector<contact>
+auto generate_contacts(const std::pmr::vector<collider>& colliders) -> std::pmr::vector<contact>
 {
-    std::vector<contact> contacts;
+    std::pmr::vector<contact> contacts;
 
     for (std::size_t i = 0; i < colliders.size(); ++i) {
         for (std::size_t j = i + 1; j < colliders.size(); ++j) {
@@ -208,21 +237,180 @@ auto generate_contacts(const std::vector<collider>& colliders) -> std::vector<co
     return contacts;
 }
 
-void solve_contacts(std::vector<collider>& colliders,
-                    const std::vector<contact>& contacts)
+// One projected Gauss-Seidel update of a contact, returning how much its normal
+// impulse changed
+auto solve_contact_pgs(std::pmr::vector<collider>& colliders, const contact& c, float& lambda, contact_cache& cache) -> float
 {
-    const auto N = contacts.size();
-    if (N == 0) return;
+    const auto  v_rel  = velocity(colliders[c.b]) - velocity(colliders[c.a]);
+    const auto  tangent = glm::vec2{-c.normal.y, c.normal.x};
 
-    // Per-contact cache computed once from the initial velocities.
-    struct contact_cache {
-        float v_target;  // desired relative velocity along normal after resolution
-        float eff_mass;  // 1 / (inv_m_a + inv_m_b) - effective mass for normal and tangential impulse
-        float lambda_t = 0.0f; // accumulated tangential impulse (for Coulomb clamping across iterations)
-    };
+    // --- Normal impulse ---
+    // Clamping lambda >= 0 enforces that contacts can only push, never pull.
+    const auto rv_n       = glm::dot(v_rel, c.normal);
+    const auto delta_n    = (cache.v_target - rv_n) * cache.eff_mass;
+    const auto lambda_old = lambda;
+    lambda = std::max(0.0f, lambda + delta_n);
+
+    const auto impulse_n = (lambda - lambda_old) * c.normal;
+    apply_impulse(colliders[c.a], -impulse_n);
+    apply_impulse(colliders[c.b],  impulse_n);
+
+    // --- Tangential impulse (Coulomb friction / throw) ---
+    // Normal impulse is perpendicular to tangent so rv_t is unaffected by impulse_n.
+    // Spin doesn't contribute here: at a ball-ball contact, w x r_contact is along z
+    // (out of the table plane) and has no 2D tangential component.
+    const auto rv_t         = glm::dot(v_rel, tangent);
+    const auto delta_t      = -rv_t * cache.eff_mass;
+    const auto friction_cap = simulation::contact_friction * lambda;
+    const auto lambda_t_old = cache.lambda_t;
+    cache.lambda_t = std::clamp(cache.lambda_t + delta_t, -friction_cap, friction_cap);
+
+    const auto impulse_t = (cache.lambda_t - lambda_t_old) * tangent;
+    apply_impulse(colliders[c.a], -impulse_t);
+    apply_impulse(colliders[c.b],  impulse_t);
+    return std::abs(lambda - lambda_old);
+}
+
+// Solves the normal impulses of a small cluster of contacts exactly, as the linear
+// complementarity problem w = A lambda + q with lambda, w >= 0 and lambda.w = 0, where
+// w is how far each contact's separating speed exceeds its target. Uses block
+// principal pivoting (Judice and Pires), which guesses the set of contacts that push,
+// solves for their impulses directly and swaps the contacts that violate the
+// conditions, usually finishing in a handful of solves. Returns the number of solves,
+// or nothing if it didn't converge and the cluster should go to PGS instead.
+// Contact friction is zero so only the normal impulses are needed.
+auto solve_cluster_exactly(std::pmr::vector<collider>& colliders,
+                           const std::pmr::vector<contact>& contacts,
+                           std::span<const std::size_t> cluster,
+                           const std::pmr::vector<contact_cache>& cache) -> std::optional<int>
+{
+    static_assert(simulation::contact_friction == 0.0f, "the block solver doesn't handle friction impulses");
+    constexpr auto max_n = simulation::max_block_contacts;
+    const auto n = cluster.size();
+
+    // Bodies are compared by index, which is fine for static ones as their inverse mass is 0
+    auto A = std::array<std::array<double, max_n>, max_n>{};
+    auto q = std::array<double, max_n>{};
+    auto max_diagonal = 0.0;
+    for (std::size_t i = 0; i != n; ++i) {
+        const auto& ci = contacts[cluster[i]];
+        const auto inv_a = static_cast<double>(inv_mass(colliders[ci.a]));
+        const auto inv_b = static_cast<double>(inv_mass(colliders[ci.b]));
+        for (std::size_t j = 0; j != n; ++j) {
+            const auto& cj = contacts[cluster[j]];
+            const auto sign = [&](std::size_t body) { return body == cj.b ? 1.0 : body == cj.a ? -1.0 : 0.0; };
+            const auto coupling = inv_b * sign(ci.b) - inv_a * sign(ci.a);
+            A[i][j] = coupling * static_cast<double>(glm::dot(ci.normal, cj.normal));
+        }
+        const auto rv = glm::dot(velocity(colliders[ci.b]) - velocity(colliders[ci.a]), ci.normal);
+        q[i] = static_cast<double>(rv) - static_cast<double>(cache[cluster[i]].v_target);
+        max_diagonal = std::max(max_diagonal, A[i][i]);
+    }
+
+    // Racked balls form closed loops of contacts, which makes A singular, so a tiny
+    // regularisation picks one of the equally valid impulse distributions
+    const auto regularisation = 1e-9 * max_diagonal;
+    const auto tolerance = 1e-6 * std::max(1.0, *std::ranges::max_element(std::span{q}.first(n), {}, [](double v) { return std::abs(v); }));
+
+    auto lambda = std::array<double, max_n>{};
+    auto w = std::array<double, max_n>{};
+    auto pushing = std::array<bool, max_n>{};
+    for (std::size_t i = 0; i != n; ++i) pushing[i] = q[i] < 0.0;
+
+    auto best_infeasible = n + 1;
+    auto full_exchanges_left = 3;
+    const auto max_solves = static_cast<int>(4 * n + 8);
+    for (int solve = 1; solve <= max_solves; ++solve) {
+        // Solve A_FF lambda_F = -q_F by Cholesky, F being the pushing contacts
+        auto F = std::array<std::size_t, max_n>{};
+        auto m = std::size_t{0};
+        for (std::size_t i = 0; i != n; ++i) {
+            if (pushing[i]) F[m++] = i;
+        }
+        auto L = std::array<std::array<double, max_n>, max_n>{};
+        auto ok = true;
+        for (std::size_t r = 0; r != m && ok; ++r) {
+            for (std::size_t c = 0; c <= r; ++c) {
+                auto sum = A[F[r]][F[c]] + (r == c ? regularisation : 0.0);
+                for (std::size_t k = 0; k != c; ++k) sum -= L[r][k] * L[c][k];
+                if (r == c) {
+                    ok = sum > 0.0;
+                    L[r][r] = ok ? std::sqrt(sum) : 0.0;
+                } else {
+                    L[r][c] = sum / L[c][c];
+                }
+            }
+        }
+        if (!ok) return {};
+
+        auto y = std::array<double, max_n>{};
+        for (std::size_t r = 0; r != m; ++r) {
+            auto sum = -q[F[r]];
+            for (std::size_t k = 0; k != r; ++k) sum -= L[r][k] * y[k];
+            y[r] = sum / L[r][r];
+        }
+        lambda = {};
+        for (std::size_t r = m; r-- != 0;) {
+            auto sum = y[r];
+            for (std::size_t k = r + 1; k != m; ++k) sum -= L[k][r] * lambda[F[k]];
+            lambda[F[r]] = sum / L[r][r];
+        }
+
+        // Contacts that pull or that would still be approaching after the solve
+        auto infeasible = std::size_t{0};
+        auto last_infeasible = std::size_t{0};
+        for (std::size_t i = 0; i != n; ++i) {
+            w[i] = q[i];
+            for (std::size_t j = 0; j != n; ++j) w[i] += A[i][j] * lambda[j];
+            const auto bad = pushing[i] ? lambda[i] < 0.0 : w[i] < -tolerance;
+            if (bad) {
+                ++infeasible;
+                last_infeasible = i;
+            }
+        }
+
+        if (infeasible == 0) {
+            for (std::size_t i = 0; i != n; ++i) {
+                if (lambda[i] <= 0.0) continue;
+                const auto& c = contacts[cluster[i]];
+                const auto impulse = static_cast<float>(lambda[i]) * c.normal;
+                apply_impulse(colliders[c.a], -impulse);
+                apply_impulse(colliders[c.b],  impulse);
+            }
+            return solve;
+        }
+
+        // Swap every violating contact while that keeps making progress, and fall
+        // back to swapping one at a time, which can't cycle, when it doesn't
+        if (infeasible < best_infeasible) {
+            best_infeasible = infeasible;
+            full_exchanges_left = 3;
+        }
+        if (full_exchanges_left > 0 && infeasible <= best_infeasible) {
+            if (infeasible == best_infeasible) --full_exchanges_left;
+            for (std::size_t i = 0; i != n; ++i) {
+                if (pushing[i] ? lambda[i] < 0.0 : w[i] < -tolerance) pushing[i] = !pushing[i];
+            }
+        } else {
+            pushing[last_infeasible] = !pushing[last_infeasible];
+        }
+    }
+    return {};
+}
+
+auto solve_contacts(std::pmr::vector<collider>& colliders,
+                    const std::pmr::vector<contact>& contacts,
+                    std::pmr::vector<float>& lambda,
+                    std::pmr::vector<contact_cache>& cache,
+                    block_solver_scratch& scratch,
+                    contact_solver_kind kind,
+                    int iterations) -> solver_result
+{
+    const auto N = contacts.size();
+    if (N == 0) return {};
 
-    std::vector<float>         lambda(N, 0.0f);
-    std::vector<contact_cache> cache(N);
+    lambda.assign(N, 0.0f);
+    cache.assign(N, contact_cache{});
 
     for (int i = 0; i < N; ++i) {
         const auto& c   = contacts[i];
@@ -244,41 +432,184 @@ void solve_contacts(std::vector<collider>& colliders,
 
     // Projected Gauss-Seidel: iterate, updating velocities in-place after each
     // impulse so later contacts in the same pass see the corrected state.
-    for (int iter = 0; iter < simulation::num_solver_iterations; ++iter) {
-        for (int i = 0; i < N; ++i) {
-            const auto& c      = contacts[i];
-            const auto  v_rel  = velocity(colliders[c.b]) - velocity(colliders[c.a]);
-            const auto  tangent = glm::vec2{-c.normal.y, c.normal.x};
+    auto result = solver_result{};
+    if (kind == contact_solver_kind::pgs) {
+        for (int iter = 0; iter < iterations; ++iter) {
+            result.iterations = iter + 1;
+            result.residual = 0.0f;
+            for (int i = 0; i < N; ++i) {
+                result.residual = std::max(result.residual, solve_contact_pgs(colliders, contacts[i], lambda[i], cache[i]));
+            }
+        }
+        return result;
+    }
+
+    // Group contacts into clusters joined by shared moving bodies. Static bodies don't
+    // join clusters as nothing can push them.
+    auto& parent = scratch.parent;
+    parent.resize(colliders.size());
+    std::iota(parent.begin(), parent.end(), std::size_t{0});
+    const auto find = [&](std::size_t i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    const auto is_dynamic = [&](std::size_t i) { return std::holds_alternative<dynamic_body>(colliders[i].body); };
+    for (const auto& c : contacts) {
+        if (is_dynamic(c.a) && is_dynamic(c.b)) {
+            const auto ra = find(c.a);
+            const auto rb = find(c.b);
+            parent[std::max(ra, rb)] = std::min(ra, rb);
+        }
+    }
+
+    // Clusters numbered in order of their first contact, with the contacts counted
+    // into cluster_end
+    auto& cluster_of = scratch.cluster_of;
+    auto& cluster_end = scratch.cluster_end;
+    auto& first_seen = scratch.first_seen;
+    cluster_of.resize(N);
+    cluster_end.clear();
+    first_seen.assign(colliders.size(), N);
+    for (std::size_t i = 0; i != N; ++i) {
+        const auto root = find(is_dynamic(contacts[i].a) ? contacts[i].a : contacts[i].b);
+        if (first_seen[root] == N) {
+            first_seen[root] = cluster_end.size();
+            cluster_end.push_back(0);
+        }
+        cluster_of[i] = first_seen[root];
+        ++cluster_end[cluster_of[i]];
+    }
+
+    // Counting sort of the contacts by cluster, which keeps their order within each
+    // cluster. Placing each contact advances its cluster's start to its end.
+    auto start = std::size_t{0};
+    for (auto& end : cluster_end) end = std::exchange(start, start + end);
+    auto& order = scratch.order;
+    order.resize(N);
+    for (std::size_t i = 0; i != N; ++i) order[cluster_end[cluster_of[i]]++] = i;
+
+    auto& fallback = scratch.fallback;
+    fallback.clear();
+    auto begin = std::size_t{0};
+    for (const auto end : cluster_end) {
+        const auto cluster = std::span{order}.subspan(begin, end - begin);
+        begin = end;
+        if (cluster.size() <= simulation::max_block_contacts) {
+            if (const auto solves = solve_cluster_exactly(colliders, contacts, cluster, cache)) {
+                result.iterations = std::max(result.iterations, *solves);
+                continue;
+            }
+        }
+        fallback.insert(fallback.end(), cluster.begin(), cluster.end());
+    }
+    std::ranges::sort(fallback);
+
+    for (int iter = 0; iter < iterations && !fallback.empty(); ++iter) {
+        result.iterations = std::max(result.iterations, iter + 1);
+        result.residual = 0.0f;
+        for (const auto i : fallback) {
+            result.residual = std::max(result.residual, solve_contact_pgs(colliders, contacts[i], lambda[i], cache[i]));
+        }
+    }
+    return result;
+}
+
+auto kinetic_energy(const collider& c) -> float
+{
+    if (const auto body = std::get_if<dynamic_body>(&c.body)) {
+        return 0.5f * body->mass * glm::dot(body->vel, body->vel)
+             + 0.5f * body->moment_of_inertia * glm::dot(body->angular_vel, body->angular_vel);
+    }
+    return 0.0f;
+}
+
+auto momentum(const collider& c) -> glm::vec2
+{
+    if (const auto body = std::get_if<dynamic_body>(&c.body)) {
+        return body->mass * body->vel;
+    }
+    return {0.0f, 0.0f};
+}
+
+auto total_momentum(const std::pmr::vector<collider>& colliders) -> glm::vec2
+{
+    auto total = glm::vec2{0.0f, 0.0f};
+    for (const auto& c : colliders) total += momentum(c);
+    return total;
+}
+
+auto record_violation(invariant_monitor& monitor, const invariant_violation& violation) -> void
+{
+    ++monitor.violation_count;
+    if (monitor.violations.size() < invariant_monitor::max_recorded) {
+        monitor.violations.push_back(violation);
+    }
+}
+
+// Compares the state after the contact solve against the energies stored in
+// monitor.energy_before and the momentum from before the solve.
+auto check_invariants(invariant_monitor& monitor,
+                      const id_vector<collider>& storage,
+                      const std::pmr::vector<contact>& contacts,
+                      glm::vec2 momentum_before,
+                      u64 step_index,
+                      i32 substep) -> void
+{
+    const auto& colliders = storage.data();
+    const auto& ids = storage.ids();
+    ++monitor.substeps_sampled;
+
+    auto energy_before = 0.0f;
+    auto energy_after = 0.0f;
+    for (std::size_t i = 0; i != colliders.size(); ++i) {
+        energy_before += monitor.energy_before[i];
+        energy_after += kinetic_energy(colliders[i]);
+    }
 
-            // --- Normal impulse ---
-            // Clamping lambda >= 0 enforces that contacts can only push, never pull.
-            const auto rv_n       = glm::dot(v_rel, c.normal);
-            const auto delta_n    = (cache[i].v_target - rv_n) * cache[i].eff_mass;
-            const auto lambda_old = lambda[i];
-            lambda[i] = std::max(0.0f, lambda[i] + delta_n);
+    // Attribute any gain to the contact whose two bodies gained the most energy
+    auto worst = std::size_t{0};
+    auto worst_gain = -std::numeric_limits<float>::infinity();
+    auto only_ball_ball = true;
+    for (std::size_t i = 0; i != contacts.size(); ++i) {
+        const auto& c = contacts[i];
+        const auto gain = kinetic_energy(colliders[c.a]) - monitor.energy_before[c.a]
+                        + kinetic_energy(colliders[c.b]) - monitor.energy_before[c.b];
+        if (gain > worst_gain) {
+            worst_gain = gain;
+            worst = i;
+        }
+        only_ball_ball = only_ball_ball
+                      && std::holds_alternative<dynamic_body>(colliders[c.a].body)
+                      && std::holds_alternative<dynamic_body>(colliders[c.b].body);
+    }
 
-            const auto impulse_n = (lambda[i] - lambda_old) * c.normal;
-            apply_impulse(colliders[c.a], -impulse_n);
-            apply_impulse(colliders[c.b],  impulse_n);
+    const auto violation = [&](invariant_kind kind, float before, float after) {
+        return invariant_violation{
+            .kind       = kind,
+            .step_index = step_index,
+            .substep    = substep,
+            .body_a     = ids[contacts[worst].a],
+            .body_b     = ids[contacts[worst].b],
+            .before     = before,
+            .after      = after
+        };
+    };
 
-            // --- Tangential impulse (Coulomb friction / throw) ---
-            // Normal impulse is perpendicular to tangent so rv_t is unaffected by impulse_n.
-            // Spin doesn't contribute here: at a ball-ball contact, w x r_contact is along z
-            // (out of the table plane) and has no 2D tangential component.
-            const auto rv_t         = glm::dot(v_rel, tangent);
-            const auto delta_t      = -rv_t * cache[i].eff_mass;
-            const auto friction_cap = simulation::contact_friction * lambda[i];
-            const auto lambda_t_old = cache[i].lambda_t;
-            cache[i].lambda_t = std::clamp(cache[i].lambda_t + delta_t, -friction_cap, friction_cap);
+    if (energy_after > energy_before * (1.0f + monitor.energy_tolerance) + 1e-6f) {
+        record_violation(monitor, violation(invariant_kind::energy_gain, energy_before, energy_after));
+    }
 
-            const auto impulse_t = (cache[i].lambda_t - lambda_t_old) * tangent;
-            apply_impulse(colliders[c.a], -impulse_t);
-            apply_impulse(colliders[c.b],  impulse_t);
+    // Cushion contacts legitimately change momentum, so only check pure ball-ball solves
+    if (only_ball_ball) {
+        const auto momentum_after = total_momentum(colliders);
+        const auto scale = std::max(glm::length(momentum_before), 1.0f);
+        if (glm::length(momentum_after - momentum_before) > monitor.momentum_tolerance * scale) {
+            record_violation(monitor, violation(invariant_kind::momentum_change, glm::length(momentum_before), glm::length(momentum_after)));
         }
     }
 }
 
-void fix_positions(std::vector<collider>& colliders, const std::vector<contact>& contacts) {
+void fix_positions(std::pmr::vector<collider>& colliders, const std::pmr::vector<contact>& contacts) {
     for (auto& c : contacts) {
         if (c.penetration <= 0) continue;
         const auto inv_a = inv_mass(colliders[c.a]);
@@ -293,10 +624,10 @@ void fix_positions(std::vector<collider>& colliders, const std::vector<contact>&
 // Applies cloth friction to a single ball for one substep.
 // Distinguishes sliding (high friction, spin catching up to velocity) from
 // rolling (low friction, pure deceleration once spin and velocity are matched).
-void apply_cloth_friction(collider& c, float dt)
+auto apply_cloth_friction(collider& c, float dt) -> ball_motion
 {
-    if (!std::holds_alternative<dynamic_body>(c.body)) return;
-    if (!std::holds_alternative<circle_shape>(c.shape)) return;
+    if (!std::holds_alternative<dynamic_body>(c.body)) return ball_motion::none;
+    if (!std::holds_alternative<circle_shape>(c.shape)) return ball_motion::none;
 
     auto& body         = std::get<dynamic_body>(c.body);
     const auto radius  = std::get<circle_shape>(c.shape).radius;
@@ -328,6 +659,7 @@ void apply_cloth_friction(collider& c, float dt)
         // Spin impulse: torque from friction at contact = r_contact x F
         //   d_spin = p * r / I * (-n.y, n.x)
         body.angular_vel += p * radius * inv_I * glm::vec2{-n_slip.y, n_slip.x};
+        return ball_motion::sliding;
     } else {
         // --- Rolling ---
         // Snap spin to the exact rolling value to avoid drift.
@@ -339,76 +671,603 @@ void apply_cloth_friction(collider& c, float dt)
             const auto decel = std::min(simulation::friction_rolling * dt, speed);
             body.vel  -= (decel / speed) * body.vel;
             body.angular_vel  = glm::vec2{-body.vel.y, body.vel.x} / radius;
+            return ball_motion::rolling;
         } else {
             body.vel  = {0.0f, 0.0f};
             body.angular_vel = {0.0f, 0.0f};
+            return ball_motion::at_rest;
+        }
+    }
+}
+
+// Pulls a ball towards the centre of an attractor that it overlaps
+auto apply_attraction(collider& ball, glm::vec2 to_attractor, float penetration, float dt) -> void
+{
+    const auto strength = penetration * 20.0f;
+    const auto attraction = strength * strength;
+    auto& vel = std::get<dynamic_body>(ball.body).vel;
+    vel += to_attractor * attraction * dt;
+    vel *= (1.0f - 0.2f * strength * dt);
+}
+
+// Tests a pair of colliders, either recording a contact or applying attraction.
+// The lower index is always passed first so that normals match the serial step.
+template <typename Stats>
+auto handle_pair(std::pmr::vector<collider>& colliders, std::size_t i, std::size_t j, float dt,
+                 std::pmr::vector<contact>& contacts, Stats& stats) -> void
+{
+    if (i > j) std::swap(i, j);
+    auto& ci = colliders[i];
+    auto& cj = colliders[j];
+    ++stats.narrowphase_tests;
+    if (const auto col = collision_test(ci, cj)) {
+        if (std::holds_alternative<attractor_body>(ci.body) && std::holds_alternative<attractor_body>(cj.body)) {
+            // nothing to do, attractors don't affect each other
+        }
+        else if (std::holds_alternative<attractor_body>(ci.body)) {
+            ++stats.attractor_interactions;
+            apply_attraction(cj, -col->normal, col->penetration, dt);
+        }
+        else if (std::holds_alternative<attractor_body>(cj.body)) {
+            ++stats.attractor_interactions;
+            apply_attraction(ci, col->normal, col->penetration, dt);
+        }
+        else {
+            contacts.push_back({ i, j, col->normal, col->penetration });
         }
     }
 }
 
+auto bounding_radius(const shape_type& shape) -> float
+{
+    return std::visit(overloaded{
+        [](const circle_shape& s) { return s.radius; },
+        [](const box_shape& s)    { return 0.5f * glm::length(glm::vec2{s.width, s.height}); },
+        [](const line_shape& s)   { return std::max(glm::length(s.start), glm::length(s.end)); }
+    }, shape);
+}
+
+auto bounds_of(const collider& c) -> aabb
+{
+    return std::visit(overloaded{
+        [&](const circle_shape& s) {
+            return aabb{c.pos - s.radius, c.pos + s.radius};
+        },
+        [&](const box_shape& s) {
+            const auto half = glm::vec2{s.width, s.height} / 2.0f;
+            return aabb{c.pos - half, c.pos + half};
+        },
+        [&](const line_shape& s) {
+            return aabb{c.pos + glm::min(s.start, s.end), c.pos + glm::max(s.start, s.end)};
+        }
+    }, c.shape);
+}
+
+// Interleaves the low 16 bits of x and y into a Z-order curve index
+auto morton_code(u32 x, u32 y) -> u32
+{
+    const auto spread = [](u32 v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+// Casting a circle at a shape is the same as casting a point at the shape inflated by the radius
+auto ray_cast_shape(ray r, float radius, const collider& other) -> std::optional<float>
+{
+    return std::visit(overloaded{
+        [&](const circle_shape& shape) {
+            return ray_cast(r, inflate(circle{.centre=other.pos, .radius=shape.radius}, radius));
+        },
+        [&](const box_shape& shape) {
+            return ray_cast(r, inflate(box{.centre=other.pos, .width=shape.width, .height=shape.height}, radius));
+        },
+        [&](const line_shape& shape) {
+            return ray_cast(r, inflate(line{.start=other.pos + shape.start, .end=other.pos + shape.end}, radius));
+        }
+    }, other.shape);
+}
+
+auto region_begin(std::size_t region, std::size_t count) -> std::size_t
+{
+    return region * count / simulation::num_regions;
+}
+
+// Sorts the dynamic bodies by (column, y). Positions move very little between
+// substeps so an insertion sort over the previous order is close to linear.
+auto update_cells(std::pmr::vector<cell_entry>& cells, const std::pmr::vector<collider>& colliders, float cell_size) -> void
+{
+    if (cells.empty()) {
+        for (std::size_t i = 0; i != colliders.size(); ++i) {
+            if (std::holds_alternative<dynamic_body>(colliders[i].body)) {
+                cells.push_back({0, 0.0f, i});
+            }
+        }
+    }
+    for (auto& cell : cells) {
+        const auto pos = colliders[cell.index].pos;
+        cell.column = static_cast<i64>(std::floor(pos.x / cell_size));
+        cell.y = pos.y;
+    }
+
+    const auto less = [](const cell_entry& a, const cell_entry& b) {
+        return a.column != b.column ? a.column < b.column : a.y < b.y;
+    };
+    for (std::size_t i = 1; i < cells.size(); ++i) {
+        auto j = i;
+        const auto entry = cells[i];
+        while (j > 0 && less(entry, cells[j - 1])) {
+            cells[j] = cells[j - 1];
+            --j;
+        }
+        cells[j] = entry;
+    }
+}
+
+// Generates the contacts owned by one region. A pair belongs to the region holding
+// whichever ball comes first in the sorted order: that ball looks forward in its own
+// column and into the next, which may belong to the neighbouring region.
+auto generate_region_contacts(std::pmr::vector<collider>& colliders,
+                              const std::pmr::vector<cell_entry>& cells,
+                              const std::pmr::vector<static_bounds>& statics,
+                              std::size_t begin, std::size_t end,
+                              float reach, float dt,
+                              region_output& out) -> void
+{
+    const auto less = [](const cell_entry& a, const cell_entry& b) {
+        return a.column != b.column ? a.column < b.column : a.y < b.y;
+    };
+
+    for (std::size_t k = begin; k != end; ++k) {
+        const auto& entry = cells[k];
+
+        for (auto m = k + 1; m < cells.size() && cells[m].column == entry.column && cells[m].y - entry.y <= reach; ++m) {
+            ++out.broadphase_pairs;
+            handle_pair(colliders, entry.index, cells[m].index, dt, out.contacts, out);
+        }
+
+        const auto first = cell_entry{entry.column + 1, entry.y - reach, 0};
+        const auto next = std::lower_bound(cells.begin() + k + 1, cells.end(), first, less);
+        for (auto it = next; it != cells.end() && it->column == entry.column + 1 && it->y - entry.y <= reach; ++it) {
+            ++out.broadphase_pairs;
+            handle_pair(colliders, entry.index, it->index, dt, out.contacts, out);
+        }
+
+        // Static and attractor bodies in index order, matching the serial step
+        const auto ball = bounds_of(colliders[entry.index]);
+        for (const auto& s : statics) {
+            ++out.broadphase_pairs;
+            if (!overlaps(ball, s.bounds)) continue;
+            handle_pair(colliders, entry.index, s.index, dt, out.contacts, out);
+        }
+    }
+}
+
+}
+
+auto name_of(contact_solver_kind kind) -> std::string_view
+{
+    switch (kind) {
+        case contact_solver_kind::pgs:           return "pgs";
+        case contact_solver_kind::block_cluster: return "block";
+        default:                                 return "unknown";
+    }
+}
+
+auto overlaps_circle(const collider& c, glm::vec2 pos, float radius) -> bool
+{
+    return std::visit(overloaded{
+        [&](const circle_shape& s) {
+            return glm::distance(c.pos, pos) < s.radius + radius;
+        },
+        [&](const box_shape& s) {
+            const auto half_extents = glm::vec2{s.width, s.height} / 2.0f;
+            return glm::distance(glm::clamp(pos, c.pos - half_extents, c.pos + half_extents), pos) < radius;
+        },
+        [&](const line_shape& s) {
+            const auto start = c.pos + s.start;
+            const auto line_vec = s.end - s.start;
+            const auto line_len_sq = glm::dot(line_vec, line_vec);
+            const auto t = line_len_sq > 0.0f ? glm::clamp(glm::dot(pos - start, line_vec) / line_len_sq, 0.0f, 1.0f) : 0.0f;
+            return glm::distance(start + t * line_vec, pos) < radius;
+        }
+    }, c.shape);
+}
+
+simulation::simulation(std::pmr::memory_resource* resource)
+    : d_colliders{resource}
+    , d_cells{resource}
+    , d_regions{resource}
+    , d_statics{resource}
+    , d_grid{resource}
+    , d_sweep{resource}
+    , d_bounds{resource}
+    , d_pairs{resource}
+    , d_query_statics{resource}
+    , d_contacts{resource}
+    , d_lambda{resource}
+    , d_contact_cache{resource}
+    , d_block_scratch{resource}
+{
+}
+
+simulation::simulation(const simulation& other, std::pmr::memory_resource* resource)
+    : d_colliders{other.d_colliders, resource}
+    , d_step_count{other.d_step_count}
+    , d_substep_count{other.d_substep_count}
+    , d_stats{other.d_stats}
+    , d_monitor{other.d_monitor ? std::optional<invariant_monitor>{std::in_place, *other.d_monitor, resource} : std::nullopt}
+    , d_pool{other.d_pool}
+    , d_parallel_min_bodies{other.d_parallel_min_bodies}
+    , d_cells{resource}
+    , d_regions{resource}
+    , d_statics{resource}
+    , d_broadphase{other.d_broadphase}
+    , d_grid{resource}
+    , d_sweep{resource}
+    , d_bounds{resource}
+    , d_pairs{resource}
+    , d_spatial_sort_interval{other.d_spatial_sort_interval}
+    , d_query_statics{resource}
+    , d_contacts{resource}
+    , d_lambda{resource}
+    , d_contact_cache{resource}
+    , d_block_scratch{resource}
+    , d_contact_solver{other.d_contact_solver}
+    , d_solver_iterations{other.d_solver_iterations}
+{
+}
+
+auto simulation::update_query_index() const -> void
+{
+    if (!d_query_dirty) return;
+    const auto& colliders = d_colliders.data();
+
+    if (d_query_statics.empty()) {
+        for (std::size_t i = 0; i != colliders.size(); ++i) {
+            if (!std::holds_alternative<dynamic_body>(colliders[i].body)) {
+                d_query_statics.push_back(i);
+            }
+        }
+    }
+
+    d_bounds.clear();
+    d_query_max_radius = 0.0f;
+    for (const auto& c : colliders) {
+        d_bounds.push_back(bounds_of(c));
+        if (std::holds_alternative<dynamic_body>(c.body)) {
+            d_query_max_radius = std::max(d_query_max_radius, bounding_radius(c.shape));
+        }
+    }
+    d_sweep.update(d_bounds);
+    d_query_dirty = false;
+}
+
+auto simulation::raycast(ray r, float radius, std::size_t ignore) const -> std::optional<ray_hit>
+{
+    update_query_index();
+    const auto& colliders = d_colliders.data();
+    const auto& ids = d_colliders.ids();
+
+    auto best = std::optional<ray_hit>{};
+    const auto check = [&](std::size_t index) {
+        if (ids[index] == ignore || std::holds_alternative<attractor_body>(colliders[index].body)) return;
+        if (const auto distance = ray_cast_shape(r, radius, colliders[index])) {
+            if (!best || *distance < best->distance) best = ray_hit{ids[index], *distance};
+        }
+    };
+
+    // Walk the balls' near edges in the direction the ray travels along x, stopping
+    // once the next edge couldn't be reached before the best hit so far. Going right
+    // that is the left edges in ascending order, going left the right edges descending.
+    const auto earliest = [&](float gap) {
+        if (gap <= 0.0f) return 0.0f;
+        if (r.dir.x == 0.0f) return std::numeric_limits<float>::infinity();
+        return gap / std::abs(r.dir.x);
+    };
+    const auto is_ball_edge = [&](const sweep_and_prune::endpoint& e, bool is_min) {
+        return e.is_min == is_min && std::holds_alternative<dynamic_body>(colliders[e.index].body);
+    };
+    const auto endpoints = d_sweep.endpoints();
+    const auto diameter = 2.0f * d_query_max_radius;
+    if (r.dir.x >= 0.0f) {
+        auto it = std::lower_bound(endpoints.begin(), endpoints.end(), r.start.x - radius - diameter,
+                                   [](const sweep_and_prune::endpoint& e, float x) { return e.value < x; });
+        for (; it != endpoints.end(); ++it) {
+            if (!is_ball_edge(*it, true)) continue;
+            const auto t = earliest(it->value - radius - r.start.x);
+            if (std::isinf(t) || (best && t > best->distance)) break;
+            check(it->index);
+        }
+    } else {
+        auto it = std::upper_bound(endpoints.begin(), endpoints.end(), r.start.x + radius + diameter,
+                                   [](float x, const sweep_and_prune::endpoint& e) { return x < e.value; });
+        while (it != endpoints.begin()) {
+            --it;
+            if (!is_ball_edge(*it, false)) continue;
+            const auto t = earliest(r.start.x - radius - it->value);
+            if (best && t > best->distance) break;
+            check(it->index);
+        }
+    }
+
+    for (const auto index : d_query_statics) {
+        check(index);
+    }
+    return best;
+}
+
+auto simulation::nearest_ball(glm::vec2 pos, std::size_t ignore) const -> std::optional<std::size_t>
+{
+    update_query_index();
+    const auto& colliders = d_colliders.data();
+    const auto& ids = d_colliders.ids();
+
+    auto best = std::optional<std::size_t>{};
+    auto best_dist = std::numeric_limits<float>::infinity();
+
+    // Search outwards from pos in both directions along the balls' left edges until
+    // the x distance alone is further than the closest ball found. A centre is at
+    // most a radius right of its left edge, which bounds the distance going left.
+    const auto endpoints = d_sweep.endpoints();
+    const auto start = std::lower_bound(endpoints.begin(), endpoints.end(), pos.x,
+                                        [](const sweep_and_prune::endpoint& e, float x) { return e.value < x; });
+    auto right = start;
+    auto left = start;
+    while (right != endpoints.end() || left != endpoints.begin()) {
+        const auto right_gap = right != endpoints.end() ? right->value - pos.x : std::numeric_limits<float>::infinity();
+        const auto left_gap = left != endpoints.begin() ? pos.x - std::prev(left)->value - d_query_max_radius : std::numeric_limits<float>::infinity();
+        if (std::min(right_gap, left_gap) > best_dist) break;
+
+        const auto& e = right_gap <= left_gap ? *right++ : *--left;
+        if (!e.is_min || !std::holds_alternative<dynamic_body>(colliders[e.index].body) || ids[e.index] == ignore) continue;
+        const auto dist = glm::distance(colliders[e.index].pos, pos);
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = ids[e.index];
+        }
+    }
+    return best;
+}
+
+auto simulation::sort_spatially() -> void
+{
+    const auto& colliders = d_colliders.data();
+
+    auto lo = glm::vec2{std::numeric_limits<float>::max()};
+    auto hi = glm::vec2{std::numeric_limits<float>::lowest()};
+    for (const auto& c : colliders) {
+        if (std::holds_alternative<dynamic_body>(c.body)) {
+            lo = glm::min(lo, c.pos);
+            hi = glm::max(hi, c.pos);
+        }
+    }
+    const auto scale = 65535.0f / glm::max(hi - lo, glm::vec2{1e-6f});
+
+    // Static bodies stay at the front in their current order
+    struct sort_key
+    {
+        bool        is_dynamic;
+        u32         code;
+        std::size_t index;
+
+        auto operator<=>(const sort_key&) const = default;
+    };
+    auto keys = std::pmr::vector<sort_key>{resource()};
+    keys.reserve(colliders.size());
+    for (std::size_t i = 0; i != colliders.size(); ++i) {
+        const auto& c = colliders[i];
+        if (std::holds_alternative<dynamic_body>(c.body)) {
+            const auto cell = (c.pos - lo) * scale;
+            keys.push_back({true, morton_code(static_cast<u32>(cell.x), static_cast<u32>(cell.y)), i});
+        } else {
+            keys.push_back({false, 0, i});
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    auto order = std::pmr::vector<std::size_t>{resource()};
+    order.reserve(keys.size());
+    for (const auto& key : keys) {
+        order.push_back(key.index);
+    }
+    d_colliders.reorder(order);
+    invalidate_spatial_state();
 }
 
 void simulation::step()
 {
+    const auto start = std::chrono::steady_clock::now();
+    if (d_spatial_sort_interval > 0 && d_step_count % d_spatial_sort_interval == 0) {
+        sort_spatially();
+    }
     auto& colliders = d_colliders.data();
 
     const auto dt = time_step / num_substeps;
+    auto stats = step_stats{ .step_index=d_step_count++ };
+
+    // Large scenes split the per-body and contact generation work into spatial regions
+    const auto parallel = d_pool && colliders.size() >= d_parallel_min_bodies;
+    auto& regions = d_regions;
+    auto& statics = d_statics;
+    regions.resize(parallel ? num_regions : 1);
+    statics.clear();
+    for (auto& out : regions) {
+        out.balls_sliding = out.balls_rolling = out.balls_at_rest = 0;
+    }
+    auto max_radius = 0.0f;
+    for (const auto& c : colliders) {
+        if (std::holds_alternative<dynamic_body>(c.body)) {
+            max_radius = std::max(max_radius, bounding_radius(c.shape));
+        }
+    }
+    if (parallel) {
+        for (std::size_t i = 0; i != colliders.size(); ++i) {
+            if (!std::holds_alternative<dynamic_body>(colliders[i].body)) {
+                statics.push_back({i, bounds_of(colliders[i])});
+            }
+        }
+        update_cells(d_cells, colliders, 2.0f * max_radius);
+    }
+
+    // Runs f on every dynamic body, split by region when stepping in parallel
+    const auto for_each_body = [&](auto&& f) {
+        if (parallel) {
+            d_pool->parallel_for(num_regions, [&](std::size_t r) {
+                const auto end = region_begin(r + 1, d_cells.size());
+                for (auto k = region_begin(r, d_cells.size()); k != end; ++k) {
+                    f(colliders[d_cells[k].index], regions[r]);
+                }
+            });
+        } else {
+            for (auto& c : colliders) f(c, regions.front());
+        }
+    };
 
     for (int i = 0; i != num_substeps; ++i) {
         // 1. integrate positions
-        for (auto& c : colliders) {
+        for_each_body([&](collider& c, region_output&) {
             if (std::holds_alternative<dynamic_body>(c.body)) {
                 c.pos += std::get<dynamic_body>(c.body).vel * dt;
             }
-        }
+        });
     
         // 2. generate contacts and handle attraction
-        std::vector<contact> contacts;
-
-        for (std::size_t i = 0; i < colliders.size(); ++i) {
-            for (std::size_t j = i + 1; j < colliders.size(); ++j) {
-                auto& ci = colliders[i];
-                auto& cj = colliders[j];
-                if (const auto col = collision_test(ci, cj)) {
-                    if (std::holds_alternative<attractor_body>(ci.body) && std::holds_alternative<attractor_body>(cj.body)) {
-                        // nothing to do, attractors don't affect each other
-                    }
-                    else if (std::holds_alternative<attractor_body>(ci.body)) {
-                        const auto dist = glm::length(ci.pos - cj.pos);
-                        const auto direction = -col->normal;
-                        const auto strength = col->penetration * 20.0f;
-                        const auto attraction = strength * strength;
-                        auto& vel = std::get<dynamic_body>(cj.body).vel;
-                        vel += direction * attraction * dt;
-                        vel *= (1.0f - 0.2f * strength * dt);
-                    }
-                    else if (std::holds_alternative<attractor_body>(cj.body)) {
-                        const auto dist = glm::length(ci.pos - cj.pos);
-                        const auto direction = col->normal;
-                        const auto strength = col->penetration * 20.0f;
-                        const auto attraction = strength * strength;
-                        auto& vel = std::get<dynamic_body>(ci.body).vel;
-                        vel += direction * attraction * dt;
-                        vel *= (1.0f - 0.2f * strength * dt);
-                    }
-                    else {
-                        contacts.push_back({ i, j, col->normal, col->penetration });
-                    }
+        auto& contacts = d_contacts;
+        contacts.clear();
+
+        if (parallel) {
+            update_cells(d_cells, colliders, 2.0f * max_radius);
+            d_pool->parallel_for(num_regions, [&](std::size_t r) {
+                auto& out = regions[r];
+                out.contacts.clear();
+                out.broadphase_pairs = out.narrowphase_tests = out.attractor_interactions = 0;
+                const auto begin = region_begin(r, d_cells.size());
+                const auto end = region_begin(r + 1, d_cells.size());
+                generate_region_contacts(colliders, d_cells, statics, begin, end, 2.0f * max_radius, dt, out);
+            });
+            for (const auto& out : regions) {
+                contacts.insert(contacts.end(), out.contacts.begin(), out.contacts.end());
+                stats.broadphase_pairs += out.broadphase_pairs;
+                stats.narrowphase_tests += out.narrowphase_tests;
+                stats.attractor_interactions += out.attractor_interactions;
+            }
+        } else if (d_broadphase == broadphase_kind::brute_force) {
+            for (std::size_t a = 0; a < colliders.size(); ++a) {
+                for (std::size_t b = a + 1; b < colliders.size(); ++b) {
+                    ++stats.broadphase_pairs;
+                    if (!std::holds_alternative<dynamic_body>(colliders[a].body) && !std::holds_alternative<dynamic_body>(colliders[b].body)) continue;
+                    handle_pair(colliders, a, b, dt, contacts, stats);
                 }
             }
+        } else {
+            d_bounds.clear();
+            for (const auto& c : colliders) {
+                d_bounds.push_back(bounds_of(c));
+            }
+            d_pairs.clear();
+            const auto broadphase_start = std::chrono::steady_clock::now();
+            if (d_broadphase == broadphase_kind::grid) {
+                d_grid.set_cell_size(max_radius > 0.0f ? 2.0f * max_radius : 1.0f);
+                d_grid.find_pairs(d_bounds, d_pairs);
+            } else {
+                d_sweep.find_pairs(d_bounds, d_pairs);
+            }
+            stats.broadphase_time_ms += std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - broadphase_start).count();
+
+            // Both broadphases give their pairs in index order, which matches the brute
+            // force loop exactly. That matters because pocket attraction changes
+            // velocities as it goes.
+            for (const auto [a, b] : d_pairs) {
+                ++stats.broadphase_pairs;
+                if (!std::holds_alternative<dynamic_body>(colliders[a].body) && !std::holds_alternative<dynamic_body>(colliders[b].body)) continue;
+                if (!overlaps(d_bounds[a], d_bounds[b])) continue;
+                handle_pair(colliders, a, b, dt, contacts, stats);
+            }
         }
     
-        // 3. solve collisions
-        solve_contacts(colliders, contacts);
+        // 3. solve collisions, sampling the energy and momentum invariants if enabled
+        const auto sample = d_monitor && !contacts.empty() && (d_substep_count % d_monitor->sample_every == 0);
+        auto momentum_before = glm::vec2{0.0f, 0.0f};
+        if (sample) {
+            d_monitor->energy_before.resize(colliders.size());
+            for (std::size_t j = 0; j != colliders.size(); ++j) {
+                d_monitor->energy_before[j] = kinetic_energy(colliders[j]);
+            }
+            momentum_before = total_momentum(colliders);
+        }
+
+        const auto solved = solve_contacts(colliders, contacts, d_lambda, d_contact_cache, d_block_scratch, d_contact_solver, d_solver_iterations);
+        if (sample) {
+            check_invariants(*d_monitor, d_colliders, contacts, momentum_before, stats.step_index, i);
+        }
+        ++d_substep_count;
+        stats.contacts += static_cast<u32>(contacts.size());
+        stats.solver_iterations += solved.iterations;
+        stats.solver_residual = std::max(stats.solver_residual, solved.residual);
     
         // 4. positional correction
         fix_positions(colliders, contacts);
     
         // 5. cloth friction (sliding or rolling per ball)
-        for (auto& c : colliders) {
-            apply_cloth_friction(c, dt);
+        const auto last_substep = i + 1 == num_substeps;
+        for_each_body([&](collider& c, region_output& out) {
+            const auto motion = apply_cloth_friction(c, dt);
+            if (!last_substep) return;
+            switch (motion) {
+                case ball_motion::at_rest: ++out.balls_at_rest; break;
+                case ball_motion::rolling: ++out.balls_rolling; break;
+                case ball_motion::sliding: ++out.balls_sliding; break;
+                default: break;
+            }
+        });
+    }
+
+    for (const auto& out : regions) {
+        stats.balls_at_rest += out.balls_at_rest;
+        stats.balls_rolling += out.balls_rolling;
+        stats.balls_sliding += out.balls_sliding;
+    }
+
+    d_query_dirty = true;
+    stats.step_time_ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    d_stats.push(stats);
+}
+
+auto simulation::is_at_rest() const -> bool
+{
+    for (const auto& c : d_colliders.data()) {
+        if (const auto body = std::get_if<dynamic_body>(&c.body)) {
+            if (body->vel != glm::vec2{0.0f, 0.0f} || body->angular_vel != glm::vec2{0.0f, 0.0f}) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto simulation::state_hash() const -> u64
+{
+    // Per-body hashes are summed so that the result doesn't depend on storage order
+    auto result = u64{0};
+    const auto& colliders = d_colliders.data();
+    const auto& ids = d_colliders.ids();
+    for (std::size_t i = 0; i != colliders.size(); ++i) {
+        if (const auto body = std::get_if<dynamic_body>(&colliders[i].body)) {
+            auto hash = u64{0xcbf29ce484222325};
+            hash = hash_combine(hash, static_cast<u32>(ids[i]));
+            hash = hash_combine(hash, colliders[i].pos);
+            hash = hash_combine(hash, body->vel);
+            hash = hash_combine(hash, body->angular_vel);
+            result += hash;
         }
     }
+    return result;
 }
 
 }
\ No newline at end of file
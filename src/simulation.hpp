@@ -1,14 +1,21 @@
 #pragma once
 #include <variant>
 #include <vector>
+#include <memory_resource>
 #include <ranges>
 #include <cassert>
 #include <unordered_map>
+#include <optional>
+#include <span>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 #include "utility.hpp"
 #include "collision.hpp"
 #include "id_vector.hpp"
+#include "history_ring.hpp"
+#include "broadphase.hpp"
+#include "thread_pool.hpp"
 
 namespace snooker {
 
@@ -59,9 +66,223 @@ struct collider
     shape_type shape;
 };
 
+// True if the shape of the collider overlaps the given circle
+auto overlaps_circle(const collider& c, glm::vec2 pos, float radius) -> bool;
+
+struct ray_hit
+{
+    std::size_t id;
+    float       distance; // along the ray to the centre of the swept circle at impact
+};
+
+// Engine counters for a single call to simulation::step. Counts are summed over
+// all substeps, ball motion states are taken at the end of the step.
+struct step_stats
+{
+    u64 step_index             = 0;
+    u32 broadphase_pairs       = 0; // pairs considered by the broadphase
+    u32 narrowphase_tests      = 0; // pairs that went on to an exact shape test
+    u32 contacts               = 0; // contacts passed to the solver
+    u32 attractor_interactions = 0; // balls pulled by a pocket
+    u32 solver_iterations      = 0;
+    f32 solver_residual        = 0.0f; // largest normal impulse change in any final solver iteration
+    u32 balls_sliding          = 0;
+    u32 balls_rolling          = 0;
+    u32 balls_at_rest          = 0;
+    f64 step_time_ms           = 0.0;
+    f64 broadphase_time_ms     = 0.0; // finding candidate pairs in the serial step, none for brute force
+};
+
+// Stats for the last 128 steps (~2 seconds)
+using step_stats_ring = history_ring<step_stats, 128>;
+
+enum class invariant_kind
+{
+    energy_gain,     // kinetic energy rose across the contact solve
+    momentum_change, // linear momentum changed across a solve with only ball-ball contacts
+};
+
+struct invariant_violation
+{
+    invariant_kind kind;
+    u64            step_index;
+    i32            substep;
+    std::size_t    body_a; // ids of the contact pair whose bodies gained the most energy
+    std::size_t    body_b;
+    f32            before; // total kinetic energy or momentum magnitude
+    f32            after;
+};
+
+// Opt-in checker for the contact solver. On every Nth substep it measures linear
+// plus rotational kinetic energy and linear momentum either side of the contact
+// solve and records any violations, keeping the overhead bounded for soak runs.
+struct invariant_monitor
+{
+    static constexpr auto max_recorded = 256; // later violations are counted but not stored
+
+    i32 sample_every       = 16;
+    f32 energy_tolerance   = 1e-4f; // relative increase allowed for rounding error
+    f32 momentum_tolerance = 1e-3f; // relative change allowed for rounding error
+
+    u64 substeps_sampled = 0;
+    u64 violation_count  = 0;
+    std::pmr::vector<invariant_violation> violations;
+    std::pmr::vector<f32>                 energy_before; // scratch, per collider
+
+    invariant_monitor() = default;
+    explicit invariant_monitor(std::pmr::memory_resource* resource) : violations{resource}, energy_before{resource} {}
+    invariant_monitor(const invariant_monitor& other, std::pmr::memory_resource* resource)
+        : sample_every{other.sample_every}
+        , energy_tolerance{other.energy_tolerance}
+        , momentum_tolerance{other.momentum_tolerance}
+        , substeps_sampled{other.substeps_sampled}
+        , violation_count{other.violation_count}
+        , violations{other.violations, resource}
+        , energy_before{other.energy_before, resource}
+    {}
+};
+
+// A dynamic body's place in the spatial decomposition used by the parallel step.
+// Columns are vertical strips of the table, one ball diameter wide.
+struct cell_entry
+{
+    i64         column;
+    f32         y;
+    std::size_t index; // into the collider storage
+};
+
+// A pair of touching bodies found during a substep
+struct contact
+{
+    std::size_t a;     // collider index
+    std::size_t b;     // collider index
+    glm::vec2 normal;  // from A to B (or into circle for wall)
+    float penetration; // overlap depth
+};
+
+// A static or attractor body checked against every ball by the parallel step
+struct static_bounds
+{
+    std::size_t index; // into the collider storage
+    aabb        bounds;
+};
+
+// Work counters of one spatial region, added into the step's stats
+struct region_counters
+{
+    u32 broadphase_pairs       = 0;
+    u32 narrowphase_tests      = 0;
+    u32 attractor_interactions = 0;
+    u32 balls_sliding          = 0;
+    u32 balls_rolling          = 0;
+    u32 balls_at_rest          = 0;
+};
+
+// What one spatial region produced during a step: its contacts for the current
+// substep and counters, with the ball motion counters summed over the step.
+// Allocator aware, so a vector of them hands its resource on to the contacts.
+struct region_output : region_counters
+{
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    std::pmr::vector<contact> contacts;
+
+    region_output() = default;
+    explicit region_output(const allocator_type& alloc) : contacts{alloc} {}
+    region_output(const region_output& other, const allocator_type& alloc)
+        : region_counters{other}, contacts{other.contacts, alloc} {}
+    region_output(region_output&& other, const allocator_type& alloc)
+        : region_counters{other}, contacts{std::move(other.contacts), alloc} {}
+};
+
+// How each substep resolves contact impulses
+enum class contact_solver_kind : u8
+{
+    pgs,           // projected Gauss-Seidel over all contacts for a fixed number of iterations
+    block_cluster, // exact solve of each small cluster of touching balls, PGS for the rest
+};
+
+auto name_of(contact_solver_kind kind) -> std::string_view;
+
+// Per-contact solver state, computed once from the velocities before the solve
+struct contact_cache
+{
+    float v_target = 0.0f; // desired relative velocity along normal after resolution
+    float eff_mass = 0.0f; // 1 / (inv_m_a + inv_m_b) - effective mass for normal and tangential impulse
+    float lambda_t = 0.0f; // accumulated tangential impulse (for Coulomb clamping across iterations)
+};
+
+// Scratch for grouping contacts into clusters in the block solver, kept between
+// substeps so that it doesn't allocate once it has grown to fit the scene
+struct block_solver_scratch
+{
+    std::pmr::vector<std::size_t> parent;        // union-find over collider indices
+    std::pmr::vector<std::size_t> first_seen;    // cluster of each root collider, or the contact count if none yet
+    std::pmr::vector<std::size_t> cluster_of;    // per contact
+    std::pmr::vector<std::size_t> cluster_end;   // end of each cluster in order
+    std::pmr::vector<std::size_t> order;         // contact indices grouped by cluster
+    std::pmr::vector<std::size_t> fallback;      // contacts of clusters left to PGS
+
+    block_solver_scratch() = default;
+    explicit block_solver_scratch(std::pmr::memory_resource* resource)
+        : parent{resource}, first_seen{resource}, cluster_of{resource}, cluster_end{resource}, order{resource}, fallback{resource} {}
+};
+
 class simulation
 {
     id_vector<collider> d_colliders;
+    u64                 d_step_count = 0;
+    u64                 d_substep_count = 0;
+    step_stats_ring     d_stats;
+
+    std::optional<invariant_monitor> d_monitor;
+
+    // Parallel stepping for large scenes
+    thread_pool*            d_pool = nullptr;
+    std::size_t             d_parallel_min_bodies = 0;
+    std::pmr::vector<cell_entry> d_cells; // sorted by (column, y), kept between substeps as it barely changes
+    std::pmr::vector<region_output> d_regions; // one per region, or a single one for the serial step
+    std::pmr::vector<static_bounds> d_statics; // bounds of the non-dynamic bodies, for the parallel step
+
+    // Broadphase for the serial step, with scratch kept to avoid reallocating. The
+    // sweep also serves spatial queries, so queries may bring it up to date.
+    broadphase_kind                   d_broadphase = broadphase_kind::sweep_and_prune;
+    grid_broadphase                   d_grid;
+    mutable sweep_and_prune           d_sweep;
+    mutable std::pmr::vector<aabb>    d_bounds;
+    std::pmr::vector<broadphase_pair> d_pairs;
+
+    // Dynamic bodies are periodically re-sorted along a Morton curve so that bodies
+    // near each other on the table are also near each other in memory
+    i32 d_spatial_sort_interval = 0;
+
+    auto sort_spatially() -> void;
+
+    // Spatial queries walk the sweep's endpoints for the dynamic bodies and check
+    // every other body, which are few. The first query after a change updates the
+    // sweep, which is work the next step's broadphase then doesn't have to do.
+    mutable std::pmr::vector<std::size_t> d_query_statics;
+    mutable f32                           d_query_max_radius = 0.0f;
+    mutable bool                          d_query_dirty = true;
+
+    auto update_query_index() const -> void;
+
+    // Contacts and solver state for the current substep, kept to avoid reallocating
+    std::pmr::vector<contact>       d_contacts;
+    std::pmr::vector<float>         d_lambda;
+    std::pmr::vector<contact_cache> d_contact_cache;
+    block_solver_scratch            d_block_scratch;
+    contact_solver_kind             d_contact_solver = contact_solver_kind::pgs;
+    i32                             d_solver_iterations = num_solver_iterations;
+
+    // Indices in the collider storage change when bodies are added or removed
+    auto invalidate_spatial_state() -> void
+    {
+        d_cells.clear();
+        d_sweep.reset();
+        d_query_statics.clear();
+        d_query_dirty = true;
+    }
 
 public:
     static constexpr auto time_step = 1.0f / 60.0f;
@@ -76,15 +297,32 @@ public:
     static constexpr auto friction_rolling      = 30.0f;
     static constexpr auto slip_threshold        = 0.5f;  // cm/s - below this the ball counts as rolling
     static constexpr auto num_solver_iterations = 10;    // PGS iterations per substep
+    static constexpr auto max_block_contacts    = 32;    // largest cluster the block solver solves exactly
     static constexpr auto contact_friction       = 0.0f;  // throw disabled so shots match the aim line
     static constexpr auto restitution_ball_ball  = 0.95f; // nearly elastic - snooker balls are very hard
     static constexpr auto restitution_ball_cushion = 0.80f; // cushion absorbs more energy
+    static constexpr auto num_regions              = 64;    // spatial regions per parallel step, independent of thread count
+
+    simulation() = default;
+
+    // Takes bodies, broadphase state and the scratch used while stepping from the
+    // given resource, so that batches of short-lived simulations can draw from an
+    // arena and release it wholesale. The resource must outlive the simulation.
+    explicit simulation(std::pmr::memory_resource* resource);
+
+    // Copies other into the given resource. A plain copy uses the default resource,
+    // as the standard containers do. Spatial state isn't copied but rebuilt by the
+    // first step, which gives identical results.
+    simulation(const simulation& other, std::pmr::memory_resource* resource);
+
+    auto resource() const -> std::pmr::memory_resource* { return d_colliders.resource(); }
 
     auto add_dynamic_circle(glm::vec2 pos, float radius, float mass) -> std::size_t
     {
         const auto moi = 0.4f * mass * radius * radius; // solid sphere: I = 2/5 * m * r^2
         const auto col = collider{ .pos=pos, .body=dynamic_body{ .mass=mass, .moment_of_inertia=moi, .vel={0.0f, 0.0f} }, .shape=circle_shape{radius} };
         const auto id = d_colliders.insert(col);
+        invalidate_spatial_state();
         return id;
     }
 
@@ -92,6 +330,7 @@ public:
     {
         const auto col = collider{ .pos=pos, .body=attractor_body{}, .shape=circle_shape{radius} };
         const auto id = d_colliders.insert(col);
+        invalidate_spatial_state();
         return id;
     }
 
@@ -99,6 +338,7 @@ public:
     {
         const auto col = collider{ .pos=centre, .body=static_body{}, .shape=box_shape{.width=width, .height=height} };
         const auto id = d_colliders.insert(col);
+        invalidate_spatial_state();
         return id;
     }
 
@@ -107,12 +347,14 @@ public:
         // TODO: The position should probably be the centre of the line? Maybe?
         const auto col = collider{ .pos=glm::vec2{0, 0}, .body=static_body{}, .shape=line_shape{ .start=start, .end=end} };
         const auto id = d_colliders.insert(col);
+        invalidate_spatial_state();
         return id;
     }
 
     auto get(std::size_t id) -> collider&
     {
         assert_that(d_colliders.is_valid(id), std::format("invalid id {}\n", id));
+        d_query_dirty = true; // the caller may move the body
         return d_colliders.get(id);
     }
 
@@ -123,7 +365,123 @@ public:
     }
 
     auto step() -> void;
-    
+
+    // Once there are at least min_bodies colliders, integration, cloth friction and
+    // contact generation are split by spatial region across the pool. Regions are
+    // fixed and their contacts merged in region order, so the result doesn't depend
+    // on the number of threads. Pass null to step on the calling thread only.
+    auto set_thread_pool(thread_pool* pool, std::size_t min_bodies = 1000) -> void
+    {
+        d_pool = pool;
+        d_parallel_min_bodies = min_bodies;
+    }
+
+    // Selects how the serial step finds candidate pairs. All broadphases visit the
+    // candidates in the same order, so they produce bit-identical results.
+    auto set_broadphase(broadphase_kind kind) -> void { d_broadphase = kind; }
+    auto broadphase() const -> broadphase_kind { return d_broadphase; }
+
+    // Selects the contact solver and the number of PGS iterations, which the block
+    // solver uses for clusters too large to solve exactly. A packed rack needs many
+    // more PGS iterations than a typical collision to share the break impulse out
+    // fully, which the block solver gets exactly in a few linear solves. Both change
+    // results, so replays only reproduce with the settings they were recorded with.
+    auto set_contact_solver(contact_solver_kind kind, i32 iterations = num_solver_iterations) -> void
+    {
+        assert_that(iterations > 0, "the contact solver needs at least one iteration");
+        d_contact_solver = kind;
+        d_solver_iterations = iterations;
+    }
+    auto contact_solver() const -> contact_solver_kind { return d_contact_solver; }
+    auto solver_iterations() const -> i32 { return d_solver_iterations; }
+
+    // Re-sorts body storage by Morton code of position every N steps, which helps the
+    // cache in large scenes where insertion and removal order has scattered
+    // neighbouring bodies. IDs are unaffected but contacts are visited in a
+    // different order, so results differ from an unsorted run. Pass 0 to disable.
+    auto set_spatial_sort_interval(i32 steps) -> void
+    {
+        assert_that(steps >= 0, "sort interval can't be negative");
+        d_spatial_sort_interval = steps;
+    }
+
+    // Spatial queries. These bring the sweep and prune broadphase up to date on first
+    // use after the simulation changes, so must not be called from several threads
+    // at once unless prepare_queries has been called since the last change.
+
+    // Brings the query index up to date now. Until the simulation next changes,
+    // queries only read it and any number of threads may run them.
+    auto prepare_queries() const -> void { update_query_index(); }
+
+    // Calls f(id) for every body whose shape overlaps the circle, without allocating
+    template <typename Func>
+    auto query_circle(glm::vec2 pos, float radius, Func&& f) const -> void
+    {
+        update_query_index();
+        const auto& colliders = d_colliders.data();
+        const auto& ids = d_colliders.ids();
+
+        // A ball can only overlap if its left edge lies within a diameter to the left
+        const auto endpoints = d_sweep.endpoints();
+        auto it = std::lower_bound(endpoints.begin(), endpoints.end(), pos.x - radius - 2.0f * d_query_max_radius,
+                                   [](const sweep_and_prune::endpoint& e, float x) { return e.value < x; });
+        for (; it != endpoints.end() && it->value <= pos.x + radius; ++it) {
+            const auto& c = colliders[it->index];
+            if (!it->is_min || !std::holds_alternative<dynamic_body>(c.body)) continue;
+            if (overlaps_circle(c, pos, radius)) f(ids[it->index]);
+        }
+        for (const auto index : d_query_statics) {
+            if (overlaps_circle(colliders[index], pos, radius)) f(ids[index]);
+        }
+    }
+
+    // Writes the ids of bodies overlapping the circle into out and returns how many
+    // there are in total, which may be more than fit
+    auto query_circle(glm::vec2 pos, float radius, std::span<std::size_t> out) const -> std::size_t
+    {
+        auto count = std::size_t{0};
+        query_circle(pos, radius, [&](std::size_t id) {
+            if (count < out.size()) out[count] = id;
+            ++count;
+        });
+        return count;
+    }
+
+    // Sweeps a circle of the given radius along the ray and returns the first body it
+    // touches. Pockets are ignored, as is the body with id "ignore" (usually the
+    // ball being cast).
+    auto raycast(ray r, float radius, std::size_t ignore = 0) const -> std::optional<ray_hit>;
+
+    // Returns the dynamic body whose centre is closest to pos
+    auto nearest_ball(glm::vec2 pos, std::size_t ignore = 0) const -> std::optional<std::size_t>;
+
+    // Number of calls to step so far
+    auto step_count() const -> u64 { return d_step_count; }
+
+    // True when no dynamic body is moving or spinning
+    auto is_at_rest() const -> bool;
+
+    // Hash of the state of all dynamic bodies. Independent of storage order, so two
+    // simulations hash equal exactly when every body has bit-identical state.
+    auto state_hash() const -> u64;
+
+    // Per-step counters for the most recent steps. Safe to read from other threads
+    // while the simulation is stepping.
+    auto stats() const -> const step_stats_ring& { return d_stats; }
+
+    // Starts checking energy and momentum across the contact solve on every Nth substep.
+    auto enable_invariant_monitor(i32 sample_every) -> void
+    {
+        assert_that(sample_every > 0, "sample_every must be positive");
+        d_monitor.emplace(resource());
+        d_monitor->sample_every = sample_every;
+    }
+
+    auto disable_invariant_monitor() -> void { d_monitor.reset(); }
+
+    // Returns the monitor with its recorded violations, or null if it isn't enabled
+    auto monitor() const -> const invariant_monitor* { return d_monitor ? &*d_monitor : nullptr; }
+
     auto is_valid(std::size_t id) const -> bool
     {
         return d_colliders.is_valid(id);
@@ -133,6 +491,7 @@ public:
     {
         assert_that(d_colliders.is_valid(id), std::format("invalid id {}\n", id));
         d_colliders.erase(id);
+        invalidate_spatial_state();
     }
 };
 
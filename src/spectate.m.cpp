@@ -0,0 +1,193 @@
+// Spectator streaming over a Unix domain socket.
+//
+//   spectate serve [--socket PATH] [--seed N]   play an AI match in real time and stream it
+//   spectate watch [--socket PATH]              print the decoded stream once a second
+//   spectate bench [--frames N]                 bytes per frame and the sender's cost per
+//                                               extra spectator, with in-process readers
+#include "local_socket.hpp"
+#include "match.hpp"
+#include "spectator.hpp"
+#include "spectator_broadcaster.hpp"
+#include "step_clock.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::string mode   = "serve";
+    std::string socket = "/tmp/snooker_spectate.sock";
+    u32         seed   = 1;
+    i32         frames = 3000;
+};
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    if (argc > 1) opts.mode = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--socket") opts.socket = value;
+        else if (flag == "--seed")   opts.seed = static_cast<u32>(std::stoul(value));
+        else if (flag == "--frames") opts.frames = std::stoi(value);
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    return opts;
+}
+
+// Reads the stream until the broadcaster goes away, returning how many bytes arrived
+auto read_stream(local_socket& sock, spectator_decoder& decoder) -> u64
+{
+    auto chunk = std::array<std::byte, 4096>{};
+    auto total = u64{0};
+    while (true) {
+        const auto n = sock.read_some(chunk);
+        if (!n || *n == 0) return total;
+        decoder.feed(std::span{chunk}.first(*n));
+        total += *n;
+    }
+}
+
+auto serve(const options& opts) -> int
+{
+    auto broadcaster = spectator_broadcaster{opts.socket};
+    assert_that(broadcaster.valid(), std::format("could not listen on {}", opts.socket));
+    std::print("streaming match {} on {}\n", opts.seed, opts.socket);
+
+    // After a stall the match catches up a few steps per frame rather than all at once
+    auto m = match{opts.seed};
+    auto pacing = step_clock{};
+    auto last_frame = clock_type::now();
+    auto last_report = last_frame;
+    auto status = match_status::playing;
+    while (status == match_status::playing) {
+        std::this_thread::sleep_for(std::chrono::duration<f64>{simulation::time_step});
+        const auto now = clock_type::now();
+        const auto steps = pacing.advance(std::chrono::duration<f64>{now - last_frame}.count());
+        last_frame = now;
+        if (steps == 0) continue;
+        status = m.advance(steps);
+        broadcaster.publish(m.get_table());
+
+        if (clock_type::now() - last_report > std::chrono::seconds{5}) {
+            last_report = clock_type::now();
+            const auto stats = broadcaster.stats();
+            std::print("  {} spectators, {:.1f} bytes/frame, {} frames dropped, {:.2f}s of play slowed\n",
+                       broadcaster.spectators(), static_cast<f64>(stats.bytes) / stats.frames, stats.frames_dropped,
+                       pacing.stats().dilated_time);
+        }
+    }
+    std::print("match over, score {} {}\n", m.scores()[0], m.scores()[1]);
+    return 0;
+}
+
+auto watch(const options& opts) -> int
+{
+    auto sock = local_socket::connect(opts.socket);
+    if (!sock.valid()) {
+        std::print("could not connect to {}\n", opts.socket);
+        return 1;
+    }
+
+    auto decoder = spectator_decoder{};
+    auto chunk = std::array<std::byte, 4096>{};
+    auto last_report = clock_type::now();
+    while (true) {
+        const auto n = sock.read_some(chunk);
+        if (!n || *n == 0) break;
+        decoder.feed(std::span{chunk}.first(*n));
+
+        if (decoder.synced() && clock_type::now() - last_report > std::chrono::seconds{1}) {
+            last_report = clock_type::now();
+            const auto balls = decoder.balls();
+            const auto on_table = std::ranges::count_if(balls, [](const spectator_ball& b) { return !b.pocketed; });
+            std::print("frame {:>7} balls {:>2} cue ({:7.2f}, {:7.2f})\n",
+                       decoder.frame(), on_table, balls[0].pos.x, balls[0].pos.y);
+        }
+    }
+    std::print("stream ended\n");
+    return 0;
+}
+
+auto bench(const options& opts) -> int
+{
+    const auto path = std::string{"/tmp/snooker_spectate_bench.sock"};
+    auto baseline_ns = 0.0;
+    auto ok = true;
+
+    for (const auto count : {0, 1, 4, 16, 64}) {
+        auto decoders = std::vector<spectator_decoder>(count);
+        auto received = std::vector<u64>(count);
+        auto readers = std::vector<std::jthread>{};
+        auto final_cue = glm::vec2{};
+        auto stats = broadcast_stats{};
+        {
+            auto broadcaster = spectator_broadcaster{path};
+            assert_that(broadcaster.valid(), std::format("could not listen on {}", path));
+            for (i32 i = 0; i != count; ++i) {
+                readers.emplace_back([&, i] {
+                    auto sock = local_socket::connect(path);
+                    if (sock.valid()) received[i] = read_stream(sock, decoders[i]);
+                });
+            }
+            while (broadcaster.spectators() != static_cast<std::size_t>(count)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+
+            // Faster than real time, but paced so that readers can mostly keep up
+            auto m = match{opts.seed};
+            for (i32 frame = 0; frame != opts.frames; ++frame) {
+                m.advance(1);
+                broadcaster.publish(m.get_table());
+                std::this_thread::sleep_for(std::chrono::microseconds{200});
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            final_cue = m.get_table().sim.get(m.get_table().cue_ball.id).pos;
+            stats = broadcaster.stats();
+        }
+        readers.clear();
+
+        // Everyone who kept up must have ended on the same picture as the table
+        auto max_error = 0.0f;
+        for (const auto& d : decoders) {
+            if (d.synced() && !d.balls().empty()) max_error = std::max(max_error, glm::length(d.balls()[0].pos - final_cue));
+        }
+        ok = ok && max_error <= spectator_quantum;
+
+        const auto fanout_ns = static_cast<f64>(stats.fanout_ns) / stats.frames;
+        if (count == 0) baseline_ns = fanout_ns;
+        std::print("spectators={:<3} bytes/frame={:.1f} encode={:.0f}ns/frame fanout={:.0f}ns/frame per_spectator={:.0f}ns/frame dropped={} error={:.3f}cm\n",
+                   count, static_cast<f64>(stats.bytes) / stats.frames, static_cast<f64>(stats.encode_ns) / stats.frames,
+                   fanout_ns, count ? (fanout_ns - baseline_ns) / count : 0.0, stats.frames_dropped, max_error);
+    }
+    return ok ? 0 : 1;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    if (opts.mode == "serve") return serve(opts);
+    if (opts.mode == "watch") return watch(opts);
+    if (opts.mode == "bench") return bench(opts);
+    std::print("unknown mode '{}'\n", opts.mode);
+    return 1;
+}
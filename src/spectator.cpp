@@ -0,0 +1,148 @@
+#include "spectator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace snooker {
+namespace {
+
+auto quantise(glm::vec2 pos) -> glm::i16vec2
+{
+    return {static_cast<i16>(std::lround(pos.x / spectator_quantum)), static_cast<i16>(std::lround(pos.y / spectator_quantum))};
+}
+
+auto entry_byte(spectator_entry kind, std::size_t slot) -> std::byte
+{
+    return static_cast<std::byte>((static_cast<u8>(kind) << 6) | static_cast<u8>(slot));
+}
+
+template <typename T>
+auto append(std::vector<std::byte>& out, const T& value) -> void
+{
+    const auto offset = out.size();
+    out.resize(offset + sizeof(T));
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+}
+
+auto spectator_encoder::encode(const table& t, std::vector<std::byte>& out) -> bool
+{
+    if (d_ids.empty()) {
+        d_ids.push_back(t.cue_ball.id);
+        for (const auto& b : t.object_balls) {
+            if (d_ids.size() == max_spectator_balls) break;
+            d_ids.push_back(b.id);
+        }
+        d_sent.resize(d_ids.size());
+        d_pocketed.resize(d_ids.size());
+    }
+
+    const auto keyframe = d_frame % d_keyframe_interval == 0;
+    const auto start = out.size();
+    append(out, spectator_frame_header{});
+
+    auto entries = u8{0};
+    for (std::size_t slot = 0; slot != d_ids.size(); ++slot) {
+        if (!t.sim.is_valid(d_ids[slot])) {
+            if (keyframe || !d_pocketed[slot]) {
+                out.push_back(entry_byte(spectator_entry::pocketed, slot));
+                ++entries;
+            }
+            d_pocketed[slot] = true;
+            continue;
+        }
+
+        const auto q = quantise(t.sim.get(d_ids[slot]).pos);
+        const auto d = glm::ivec2{q} - glm::ivec2{d_sent[slot]};
+        if (!keyframe && !d_pocketed[slot] && d == glm::ivec2{0, 0}) continue;
+
+        if (!keyframe && !d_pocketed[slot] && std::abs(d.x) <= 127 && std::abs(d.y) <= 127) {
+            out.push_back(entry_byte(spectator_entry::delta, slot));
+            out.push_back(static_cast<std::byte>(static_cast<i8>(d.x)));
+            out.push_back(static_cast<std::byte>(static_cast<i8>(d.y)));
+        } else {
+            out.push_back(entry_byte(spectator_entry::absolute, slot));
+            append(out, q.x);
+            append(out, q.y);
+        }
+        d_sent[slot] = q;
+        d_pocketed[slot] = false;
+        ++entries;
+    }
+
+    const auto header = spectator_frame_header{
+        .frame = d_frame++,
+        .payload_size = static_cast<u16>(out.size() - start - sizeof(spectator_frame_header)),
+        .flags = keyframe ? spectator_keyframe : u8{0},
+        .num_entries = entries
+    };
+    std::memcpy(out.data() + start, &header, sizeof(header));
+    return keyframe;
+}
+
+auto spectator_decoder::feed(std::span<const std::byte> bytes) -> void
+{
+    d_buffer.insert(d_buffer.end(), bytes.begin(), bytes.end());
+
+    auto offset = std::size_t{0};
+    while (d_buffer.size() - offset >= sizeof(spectator_frame_header)) {
+        auto header = spectator_frame_header{};
+        std::memcpy(&header, d_buffer.data() + offset, sizeof(header));
+        const auto size = sizeof(header) + header.payload_size;
+        if (d_buffer.size() - offset < size) break;
+        apply(header, std::span{d_buffer}.subspan(offset + sizeof(header), header.payload_size));
+        offset += size;
+    }
+    d_buffer.erase(d_buffer.begin(), d_buffer.begin() + offset);
+}
+
+auto spectator_decoder::apply(const spectator_frame_header& header, std::span<const std::byte> payload) -> void
+{
+    const auto keyframe = (header.flags & spectator_keyframe) != 0;
+    if (!keyframe && (!d_synced || header.frame != d_frame + 1)) {
+        d_synced = false;
+        return;
+    }
+    if (keyframe) d_num_balls = 0;
+
+    auto offset = std::size_t{0};
+    for (u8 i = 0; i != header.num_entries; ++i) {
+        // The stream can't be trusted past an entry that is cut short by the end of
+        // the payload or has an unknown kind, so wait for the next keyframe
+        if (offset == payload.size()) {
+            d_synced = false;
+            return;
+        }
+        const auto first = static_cast<u8>(payload[offset++]);
+        const auto kind = static_cast<spectator_entry>(first >> 6);
+        const auto slot = static_cast<std::size_t>(first & 0x3f);
+        const auto size = kind == spectator_entry::absolute ? 2 * sizeof(i16)
+                        : kind == spectator_entry::delta    ? std::size_t{2}
+                        :                                     std::size_t{0};
+        if (kind > spectator_entry::pocketed || size > payload.size() - offset) {
+            d_synced = false;
+            return;
+        }
+        auto& q = d_quantised[slot];
+
+        if (kind == spectator_entry::absolute) {
+            std::memcpy(&q.x, payload.data() + offset, sizeof(i16));
+            std::memcpy(&q.y, payload.data() + offset + sizeof(i16), sizeof(i16));
+            offset += 2 * sizeof(i16);
+        } else if (kind == spectator_entry::delta) {
+            q.x += static_cast<i8>(payload[offset]);
+            q.y += static_cast<i8>(payload[offset + 1]);
+            offset += 2;
+        }
+        d_balls[slot] = {glm::vec2{q} * spectator_quantum, kind == spectator_entry::pocketed};
+        if (keyframe) d_num_balls = std::max(d_num_balls, slot + 1);
+    }
+
+    d_frame = header.frame;
+    d_synced = true;
+    ++d_frames;
+}
+
+}
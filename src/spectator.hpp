@@ -0,0 +1,91 @@
+#pragma once
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace snooker {
+
+// Compact per-frame stream of ball positions for spectators. Each frame is a
+// spectator_frame_header followed by one entry per ball whose quantised position
+// changed since the previous frame, so balls at rest cost nothing. An entry starts
+// with a byte holding the entry kind in the top two bits and the ball slot below:
+//
+//   absolute: then i16 x, i16 y in position quanta
+//   delta:    then i8 dx, i8 dy relative to the ball's previous position
+//   pocketed: nothing more, the ball has left the table
+//
+// Every keyframe_interval frames a keyframe carries every ball as an absolute entry
+// so that new or lagging spectators can join the stream there.
+constexpr auto spectator_quantum   = 1.0f / 16.0f; // cm
+constexpr auto max_spectator_balls = 64;
+constexpr auto spectator_keyframe  = u8{1};
+
+struct spectator_frame_header
+{
+    u32 frame;
+    u16 payload_size; // bytes of entries after the header
+    u8  flags;
+    u8  num_entries;
+};
+
+enum class spectator_entry : u8
+{
+    absolute = 0,
+    delta    = 1,
+    pocketed = 2,
+};
+
+class spectator_encoder
+{
+    u32                       d_keyframe_interval;
+    u32                       d_frame = 0;
+    std::vector<std::size_t>  d_ids;  // ball id for each slot, fixed by the first frame
+    std::vector<glm::i16vec2> d_sent; // last position sent for each slot
+    std::vector<bool>         d_pocketed;
+
+public:
+    explicit spectator_encoder(u32 keyframe_interval = 60) : d_keyframe_interval{keyframe_interval} {}
+
+    // Appends the next frame to out and returns true if it was a keyframe
+    auto encode(const table& t, std::vector<std::byte>& out) -> bool;
+};
+
+struct spectator_ball
+{
+    glm::vec2 pos;
+    bool      pocketed = false;
+};
+
+// Rebuilds ball positions from the byte stream. Deltas arriving before the first
+// keyframe, or after a gap in frame numbers or a frame whose entries don't fit its
+// payload, are ignored until the next keyframe.
+class spectator_decoder
+{
+    std::vector<std::byte>                               d_buffer;
+    std::array<glm::i16vec2, max_spectator_balls>        d_quantised = {};
+    std::array<spectator_ball, max_spectator_balls>      d_balls = {};
+    std::size_t                                          d_num_balls = 0;
+    u32                                                  d_frame = 0;
+    bool                                                 d_synced = false;
+    u64                                                  d_frames = 0;
+
+    auto apply(const spectator_frame_header& header, std::span<const std::byte> payload) -> void;
+
+public:
+    // Consumes as much of the stream as forms whole frames
+    auto feed(std::span<const std::byte> bytes) -> void;
+
+    auto synced() const -> bool { return d_synced; }
+    auto frame() const -> u32 { return d_frame; }
+    auto frames_applied() const -> u64 { return d_frames; }
+    auto balls() const -> std::span<const spectator_ball> { return {d_balls.data(), d_num_balls}; }
+};
+
+}
@@ -0,0 +1,155 @@
+#include "spectator_broadcaster.hpp"
+
+#include <array>
+#include <chrono>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace snooker {
+
+spectator_broadcaster::spectator_broadcaster(std::string_view path, std::size_t max_backlog, u32 keyframe_interval)
+    : d_path{path}
+    , d_listener{local_socket::listen(path)}
+    , d_max_backlog{max_backlog}
+    , d_encoder{keyframe_interval}
+{
+    if (!valid() || ::pipe(d_wake) != 0) {
+        d_listener = {};
+        return;
+    }
+    d_listener.set_nonblocking();
+    for (const auto fd : d_wake) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    d_thread = std::jthread{[this] { run(); }};
+}
+
+spectator_broadcaster::~spectator_broadcaster()
+{
+    {
+        auto lock = std::unique_lock{d_mutex};
+        d_stopping = true;
+    }
+    wake();
+    if (d_thread.joinable()) d_thread.join();
+    for (const auto fd : d_wake) {
+        if (fd >= 0) ::close(fd);
+    }
+    if (valid()) ::unlink(d_path.c_str());
+}
+
+auto spectator_broadcaster::wake() -> void
+{
+    const auto byte = char{1};
+    [[maybe_unused]] const auto n = ::write(d_wake[1], &byte, 1); // a full pipe already means "wake up"
+}
+
+auto spectator_broadcaster::publish(const table& t) -> void
+{
+    if (!valid()) return;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto bytes = std::make_shared<std::vector<std::byte>>();
+    const auto keyframe = d_encoder.encode(t, *bytes);
+    d_bytes += bytes->size();
+    ++d_frames;
+    {
+        auto lock = std::unique_lock{d_mutex};
+        d_published.push_back({std::move(bytes), keyframe});
+    }
+    wake();
+    d_encode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+auto spectator_broadcaster::stats() const -> broadcast_stats
+{
+    return {
+        .frames = d_frames,
+        .bytes = d_bytes,
+        .encode_ns = d_encode_ns,
+        .fanout_ns = d_fanout_ns,
+        .frames_sent = d_frames_sent,
+        .frames_dropped = d_frames_dropped
+    };
+}
+
+auto spectator_broadcaster::run() -> void
+{
+    auto spectators = std::vector<spectator>{};
+    auto fresh = std::vector<frame_entry>{};
+    auto fds = std::vector<pollfd>{};
+    auto drain = std::array<char, 256>{};
+
+    while (true) {
+        fds.clear();
+        fds.push_back({d_listener.fd(), POLLIN, 0});
+        fds.push_back({d_wake[0], POLLIN, 0});
+        for (const auto& s : spectators) {
+            fds.push_back({s.sock.fd(), static_cast<short>(s.backlog.empty() ? 0 : POLLOUT), 0});
+        }
+        ::poll(fds.data(), fds.size(), -1);
+
+        const auto start = std::chrono::steady_clock::now();
+        while (::read(d_wake[0], drain.data(), drain.size()) > 0) {}
+        {
+            auto lock = std::unique_lock{d_mutex};
+            if (d_stopping) break;
+            std::swap(fresh, d_published);
+        }
+
+        // A spectator with nothing to send is only polled so that we notice it leaving
+        for (std::size_t i = 0; i != spectators.size(); ++i) {
+            if (fds[i + 2].revents & (POLLHUP | POLLERR | POLLNVAL)) spectators[i].sock = {};
+        }
+
+        for (auto sock = d_listener.accept(); sock.valid(); sock = d_listener.accept()) {
+            sock.set_nonblocking();
+            spectators.push_back({ .sock=std::move(sock) });
+        }
+
+        for (auto& s : spectators) {
+            if (!s.sock.valid()) continue;
+
+            // Only the buffer pointer is copied per spectator, the bytes are shared
+            for (const auto& f : fresh) {
+                if (!s.synced && !f.keyframe) continue;
+                s.synced = true;
+                s.backlog.push_back(f);
+            }
+
+            // Too far behind: keep the frame already partly written so the stream
+            // stays well formed, drop the rest and rejoin at the next keyframe
+            if (s.backlog.size() > d_max_backlog) {
+                const auto keep = s.front_sent > 0 ? 1u : 0u;
+                d_frames_dropped += s.backlog.size() - keep;
+                s.backlog.resize(keep);
+                s.synced = false;
+            }
+
+            while (!s.backlog.empty()) {
+                const auto& front = *s.backlog.front().bytes;
+                const auto n = s.sock.write_some(std::span{front}.subspan(s.front_sent));
+                if (!n) break;
+                if (*n == 0) {
+                    s.sock = {};
+                    break;
+                }
+                s.front_sent += *n;
+                if (s.front_sent == front.size()) {
+                    s.backlog.pop_front();
+                    s.front_sent = 0;
+                    ++d_frames_sent;
+                }
+            }
+        }
+        std::erase_if(spectators, [](const spectator& s) { return !s.sock.valid(); });
+        fresh.clear();
+
+        d_spectators = spectators.size();
+        d_fanout_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "local_socket.hpp"
+#include "spectator.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace snooker {
+
+struct broadcast_stats
+{
+    u64 frames         = 0;
+    u64 bytes          = 0; // encoded once, however many spectators there are
+    u64 encode_ns      = 0; // on the publishing thread
+    u64 fanout_ns      = 0; // on the sender thread
+    u64 frames_sent    = 0; // summed over spectators
+    u64 frames_dropped = 0;
+};
+
+// Streams a table to any number of spectators on a Unix domain socket. The game
+// thread encodes each frame once and hands the shared buffer to a sender thread,
+// which writes it to every spectator without blocking. A spectator that falls more
+// than max_backlog frames behind has its backlog dropped and resumes at the next
+// keyframe, so a slow reader never holds up the game or the other spectators.
+class spectator_broadcaster
+{
+    using frame_ptr = std::shared_ptr<const std::vector<std::byte>>;
+
+    struct frame_entry
+    {
+        frame_ptr bytes;
+        bool      keyframe;
+    };
+
+    struct spectator
+    {
+        local_socket            sock;
+        std::deque<frame_entry> backlog;
+        std::size_t             front_sent = 0; // bytes of the front frame already written
+        bool                    synced     = false;
+    };
+
+    std::string              d_path;
+    local_socket             d_listener;
+    int                      d_wake[2] = {-1, -1};
+    std::size_t              d_max_backlog;
+    spectator_encoder        d_encoder;
+
+    std::mutex               d_mutex;
+    std::vector<frame_entry> d_published; // handed over by publish, not yet fanned out
+    bool                     d_stopping = false;
+
+    std::atomic<std::size_t> d_spectators = 0;
+    std::atomic<u64>         d_fanout_ns = 0;
+    std::atomic<u64>         d_frames_sent = 0;
+    std::atomic<u64>         d_frames_dropped = 0;
+    u64                      d_frames = 0;
+    u64                      d_bytes = 0;
+    u64                      d_encode_ns = 0;
+    std::jthread             d_thread;
+
+    spectator_broadcaster(const spectator_broadcaster&) = delete;
+    spectator_broadcaster& operator=(const spectator_broadcaster&) = delete;
+
+    auto run() -> void;
+    auto wake() -> void;
+
+public:
+    explicit spectator_broadcaster(std::string_view path, std::size_t max_backlog = 120, u32 keyframe_interval = 60);
+    ~spectator_broadcaster();
+
+    auto valid() const -> bool { return d_listener.valid(); }
+
+    // Encodes the table's current state as the next frame and queues it for every
+    // spectator. Never waits on the network.
+    auto publish(const table& t) -> void;
+
+    auto spectators() const -> std::size_t { return d_spectators; }
+
+    // Call from the publishing thread
+    auto stats() const -> broadcast_stats;
+};
+
+}
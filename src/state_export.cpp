@@ -0,0 +1,68 @@
+#include "state_export.hpp"
+
+#include <chrono>
+
+namespace snooker {
+
+state_exporter::state_exporter(std::string_view name)
+    : d_memory{name, sizeof(exported_state)}
+{
+    if (!valid()) return;
+    auto& s = *static_cast<exported_state*>(d_memory.data());
+    s.magic = state_export_magic;
+    s.version = state_export_version;
+}
+
+auto state_exporter::publish(const table& t, u64 shot_counter) -> void
+{
+    if (!valid()) return;
+    if (d_ids.empty()) {
+        d_ids.push_back(t.cue_ball.id);
+        for (const auto& b : t.object_balls) {
+            if (d_ids.size() == max_exported_balls) break;
+            d_ids.push_back(b.id);
+        }
+    }
+
+    auto& s = *static_cast<exported_state*>(d_memory.data());
+    const auto seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto& sim = t.sim;
+    s.step = sim.step_count();
+    s.shot_counter = shot_counter;
+    s.num_balls = static_cast<u32>(d_ids.size());
+    for (std::size_t i = 0; i != d_ids.size(); ++i) {
+        auto& out = s.balls[i];
+        out.id = static_cast<u32>(d_ids[i]);
+        out.flags = d_ids[i] == t.cue_ball.id ? exported_cue_ball : 0;
+        if (sim.is_valid(d_ids[i])) {
+            const auto& coll = sim.get(d_ids[i]);
+            out.pos = coll.pos;
+            out.vel = std::get<dynamic_body>(coll.body).vel;
+        } else {
+            out.flags |= exported_pocketed;
+            out.vel = {0.0f, 0.0f};
+        }
+    }
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    s.publish_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+    s.sequence.store(seq + 2, std::memory_order_release);
+}
+
+state_reader::state_reader(std::string_view name)
+    : d_memory{name}
+{
+}
+
+auto state_reader::valid() const -> bool
+{
+    return d_memory.valid()
+        && d_memory.size() >= sizeof(exported_state)
+        && state().magic == state_export_magic
+        && state().version == state_export_version;
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "shared_memory.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <string_view>
+#include <vector>
+
+namespace snooker {
+
+// Layout of the live state segment. External tools map it read only, so this is
+// versioned and only ever grows at the end.
+constexpr auto state_export_magic   = u32{0x524b4e53}; // "SNKR"
+constexpr auto state_export_version = u32{1};
+constexpr auto max_exported_balls   = 32;
+constexpr auto default_state_export_name = std::string_view{"snooker_state"};
+
+enum exported_ball_flags : u32
+{
+    exported_cue_ball = 1 << 0,
+    exported_pocketed = 1 << 1,
+};
+
+struct exported_ball
+{
+    u32       id;
+    u32       flags;
+    glm::vec2 pos;
+    glm::vec2 vel;
+};
+
+struct exported_state
+{
+    u32              magic;
+    u32              version;
+    std::atomic<u64> sequence; // odd while the writer is mid-update
+    u64              step;
+    u64              shot_counter;
+    i64              publish_time_ns; // steady clock, comparable across processes on the same machine
+    u32              num_balls;
+    u32              reserved;
+    std::array<exported_ball, max_exported_balls> balls;
+};
+
+static_assert(std::atomic<u64>::is_always_lock_free, "the sequence must be usable across processes");
+
+// Publishes table state into shared memory after each step. The writer never waits:
+// the segment is guarded by a seqlock, so readers in other processes read the data
+// in place and retry if the writer changed it underneath them.
+class state_exporter
+{
+    shared_memory            d_memory;
+    std::vector<std::size_t> d_ids; // ball id for each exported slot, fixed on first publish
+
+    state_exporter(const state_exporter&) = delete;
+    state_exporter& operator=(const state_exporter&) = delete;
+
+public:
+    explicit state_exporter(std::string_view name = default_state_export_name);
+
+    auto valid() const -> bool { return d_memory.valid(); }
+
+    // Balls that have left the table keep their last position and are flagged as pocketed
+    auto publish(const table& t, u64 shot_counter) -> void;
+};
+
+class state_reader
+{
+    shared_memory d_memory;
+
+    state_reader(const state_reader&) = delete;
+    state_reader& operator=(const state_reader&) = delete;
+
+public:
+    explicit state_reader(std::string_view name = default_state_export_name);
+
+    // False if the segment doesn't exist or was written by an incompatible version
+    auto valid() const -> bool;
+
+    auto state() const -> const exported_state& { return *static_cast<const exported_state*>(d_memory.data()); }
+
+    // Sequence number of the latest complete update, which changes whenever the
+    // writer publishes
+    auto sequence() const -> u64 { return state().sequence.load(std::memory_order_acquire) & ~u64{1}; }
+
+    // Calls f with the state in place until it gets through without the writer
+    // changing it, and returns the sequence number it read. f may be called more
+    // than once and may see torn values on the discarded calls, so it should only
+    // copy out what it needs.
+    template <typename Func>
+    auto read(Func&& f) const -> u64
+    {
+        const auto& s = state();
+        while (true) {
+            const auto before = s.sequence.load(std::memory_order_acquire);
+            if (before % 2 == 1) continue;
+            f(s);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.sequence.load(std::memory_order_relaxed) == before) return before;
+        }
+    }
+};
+
+}
@@ -0,0 +1,63 @@
+// Example consumer of the live state export. Start the game with SNOOKER_STATE_EXPORT
+// set to a segment name, then run this with the same name to print the table state a
+// few times a second. It maps the segment read only, so it can't disturb the game.
+//
+//   state_reader [name]
+#include "state_export.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+
+using namespace snooker;
+
+auto main(int argc, char** argv) -> int
+{
+    const auto name = argc > 1 ? std::string{argv[1]} : std::string{default_state_export_name};
+
+    auto reader = std::optional<state_reader>{};
+    while (true) {
+        reader.emplace(name);
+        if (reader->valid()) break;
+        std::print("waiting for {}\n", name);
+        std::this_thread::sleep_for(std::chrono::seconds{1});
+    }
+
+    auto last = u64{0};
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{200});
+        if (reader->sequence() == last) continue;
+
+        // Copy out what we print so the callback stays cheap if it has to retry
+        auto step = u64{0};
+        auto shots = u64{0};
+        auto published = i64{0};
+        auto on_table = 0;
+        auto moving = 0;
+        auto cue_pos = glm::vec2{0.0f, 0.0f};
+        last = reader->read([&](const exported_state& s) {
+            step = s.step;
+            shots = s.shot_counter;
+            published = s.publish_time_ns;
+            on_table = 0;
+            moving = 0;
+            for (u32 i = 0; i != s.num_balls && i != max_exported_balls; ++i) {
+                const auto& b = s.balls[i];
+                if (b.flags & exported_cue_ball) cue_pos = b.pos;
+                if (b.flags & exported_pocketed) continue;
+                ++on_table;
+                moving += glm::dot(b.vel, b.vel) > 0.0f;
+            }
+        });
+
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        const auto age_us = (std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - published) / 1000.0;
+        std::print("step {:>8} shot {:>3} balls {:>2} moving {:>2} cue ({:7.2f}, {:7.2f}) age {:.0f}us\n",
+                   step, shots, on_table, moving, cue_pos.x, cue_pos.y, age_us);
+    }
+}
@@ -0,0 +1,62 @@
+#include "step_clock.hpp"
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace snooker {
+
+step_clock::step_clock(step_clock_config config)
+    : d_config{config}
+{
+    assert_that(config.max_steps_per_frame > 0, "the step budget must be positive");
+    assert_that(config.max_backlog_steps >= 0, "the backlog can't be negative");
+}
+
+auto step_clock::advance(f64 frame_time) -> i32
+{
+    constexpr auto step_time = static_cast<f64>(simulation::time_step);
+    const auto carried = d_accumulator;
+    d_accumulator += frame_time;
+    ++d_stats.frames;
+
+    auto steps = 0;
+    while (d_accumulator > step_time && steps != d_config.max_steps_per_frame) {
+        d_accumulator -= step_time;
+        ++steps;
+    }
+    d_stats.steps += steps;
+    if (d_accumulator <= step_time) return steps;
+
+    // Out of budget with at least a whole step still owed. Anything below one step is
+    // kept either way, as it would have been on a frame that finished in time.
+    ++d_stats.capped_frames;
+    const auto owed = d_accumulator - std::fmod(d_accumulator, step_time);
+    const auto keep = d_config.policy == catch_up_policy::dilate
+                    ? std::min(owed, d_config.max_backlog_steps * step_time)
+                    : 0.0;
+    d_stats.dilated_time += std::max(0.0, keep - std::max(0.0, carried - steps * step_time)); // only newly deferred time
+    d_stats.dropped_time += owed - keep;
+    d_accumulator -= owed - keep;
+    return steps;
+}
+
+auto parse_step_clock_config(std::string_view text) -> std::optional<step_clock_config>
+{
+    auto config = step_clock_config{};
+    const auto colon = text.find(':');
+    const auto name = text.substr(0, colon);
+    if      (name == "dilate") config.policy = catch_up_policy::dilate;
+    else if (name == "drop")   config.policy = catch_up_policy::drop;
+    else return {};
+
+    if (colon != std::string_view::npos) {
+        const auto budget = text.substr(colon + 1);
+        const auto [ptr, ec] = std::from_chars(budget.data(), budget.data() + budget.size(), config.max_steps_per_frame);
+        if (ec != std::errc{} || ptr != budget.data() + budget.size() || config.max_steps_per_frame <= 0) return {};
+    }
+    return config;
+}
+
+}
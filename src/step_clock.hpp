@@ -0,0 +1,59 @@
+#pragma once
+#include "utility.hpp"
+
+#include <optional>
+#include <string_view>
+
+namespace snooker {
+
+// What to do with wall clock time that the frame's step budget couldn't cover
+enum class catch_up_policy : u8
+{
+    dilate, // carry it into later frames, so the game runs slow for a while and then catches up
+    drop,   // forget it, so the game skips ahead in wall clock time but never lags
+};
+
+struct step_clock_config
+{
+    catch_up_policy policy              = catch_up_policy::dilate;
+    i32             max_steps_per_frame = 8;
+    i32             max_backlog_steps   = 30; // dilate only, time beyond this is dropped
+};
+
+struct step_clock_stats
+{
+    u64 frames        = 0;
+    u64 steps         = 0;
+    u64 capped_frames = 0;   // frames that ran out of step budget
+    f64 dilated_time  = 0.0; // seconds of wall clock time simulated in a later frame than it happened in
+    f64 dropped_time  = 0.0; // seconds of wall clock time that were never simulated
+};
+
+// Turns frame times into a number of fixed simulation steps for each frame, with a
+// budget so that a long frame (a window drag, a stall elsewhere on the machine)
+// can't make the next frame run dozens of steps and fall further behind. The
+// simulation only ever sees whole steps, so the schedule changes when things are
+// shown but not what happens, which is why replays don't need to record it.
+class step_clock
+{
+    step_clock_config d_config;
+    step_clock_stats  d_stats;
+    f64               d_accumulator = 0.0;
+
+public:
+    explicit step_clock(step_clock_config config = {});
+
+    // Returns how many steps to run for a frame that took frame_time seconds
+    auto advance(f64 frame_time) -> i32;
+
+    // Simulated time still owed to the wall clock, in seconds
+    auto backlog() const -> f64 { return d_accumulator; }
+
+    auto config() const -> const step_clock_config& { return d_config; }
+    auto stats() const -> const step_clock_stats& { return d_stats; }
+};
+
+// Parses "dilate" or "drop", optionally followed by ":N" for the step budget
+auto parse_step_clock_config(std::string_view text) -> std::optional<step_clock_config>;
+
+}
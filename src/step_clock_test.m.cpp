@@ -0,0 +1,157 @@
+// Replays frame time sequences through step_clock and checks the steps it hands out
+// and the time it dilates or drops, failing if any case doesn't match.
+//
+//   step_clock_test
+#include "simulation.hpp"
+#include "step_clock.hpp"
+#include "utility.hpp"
+
+#include <cmath>
+#include <format>
+#include <functional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+constexpr auto frame_time = static_cast<f64>(simulation::time_step);
+constexpr auto tolerance  = 1e-4; // seconds, the accumulator drifts a little in f64
+
+// Collects the first failed expectation of a case
+struct checker
+{
+    std::string error;
+
+    auto expect(bool condition, std::string_view what) -> void
+    {
+        if (error.empty() && !condition) error = what;
+    }
+
+    auto expect_near(f64 actual, f64 expected, std::string_view what) -> void
+    {
+        if (error.empty() && std::abs(actual - expected) > tolerance) {
+            error = std::format("{} is {:.6f}, expected {:.6f}", what, actual, expected);
+        }
+    }
+};
+
+// Half a second of frames at the step rate, leaving the clock in its steady state
+auto settle(step_clock& clock) -> void
+{
+    for (i32 i = 0; i != 30; ++i) clock.advance(frame_time);
+}
+
+// Frames jittering half a millisecond either side of the step rate, as with vsync,
+// run one step each and never touch the budget
+auto steady_vsync(checker& c) -> void
+{
+    auto clock = step_clock{};
+    auto multi_step_frames = 0;
+    for (i32 i = 0; i != 600; ++i) {
+        const auto steps = clock.advance(frame_time + (i % 2 ? 0.0005 : -0.0005));
+        if (steps > 1) ++multi_step_frames;
+    }
+    c.expect(multi_step_frames == 0, "a frame ran more than one step");
+    c.expect(clock.stats().steps + 1 >= 600, std::format("ran {} steps for 600 frames", clock.stats().steps));
+    c.expect(clock.stats().capped_frames == 0, "a frame was capped");
+    c.expect_near(clock.stats().dilated_time, 0.0, "dilated time");
+    c.expect_near(clock.stats().dropped_time, 0.0, "dropped time");
+}
+
+// A one second hitch at a budget of 4 steps: dilate runs the budget, defers the
+// 30 step backlog and drops the rest, then catches up over the next 10 frames
+auto hitch_dilate(checker& c) -> void
+{
+    auto clock = step_clock{{ .policy=catch_up_policy::dilate, .max_steps_per_frame=4, .max_backlog_steps=30 }};
+    settle(clock);
+    const auto steps_before = clock.stats().steps;
+
+    c.expect(clock.advance(1.0) == 4, "the hitch frame didn't run the full budget");
+    c.expect_near(clock.stats().dilated_time, 30 * frame_time, "dilated time");
+    c.expect_near(clock.stats().dropped_time, 1.0 - 4 * frame_time - 30 * frame_time, "dropped time");
+
+    auto catch_up_frames = 0;
+    for (i32 i = 0; i != 20; ++i) {
+        if (clock.advance(frame_time) == 4) ++catch_up_frames;
+    }
+    c.expect(catch_up_frames == 10, std::format("caught up over {} frames, expected 10", catch_up_frames));
+    c.expect(clock.backlog() <= frame_time, "the backlog wasn't paid off");
+    c.expect(clock.stats().capped_frames == 10, std::format("{} frames were capped, expected 10", clock.stats().capped_frames));
+    c.expect(clock.stats().steps - steps_before == 4 + 30 + 20, "steps since the hitch don't add up");
+    c.expect_near(clock.stats().dilated_time, 30 * frame_time, "dilated time after catching up");
+}
+
+// The same hitch with drop runs the budget and forgets everything else at once
+auto hitch_drop(checker& c) -> void
+{
+    auto clock = step_clock{{ .policy=catch_up_policy::drop, .max_steps_per_frame=4 }};
+    settle(clock);
+
+    c.expect(clock.advance(1.0) == 4, "the hitch frame didn't run the full budget");
+    c.expect_near(clock.stats().dropped_time, 1.0 - 4 * frame_time, "dropped time");
+    c.expect_near(clock.stats().dilated_time, 0.0, "dilated time");
+    c.expect(clock.backlog() <= frame_time, "time beyond a step was kept");
+
+    for (i32 i = 0; i != 20; ++i) {
+        c.expect(clock.advance(frame_time) == 1, "a frame after the hitch didn't run one step");
+    }
+    c.expect(clock.stats().capped_frames == 1, "more than the hitch frame was capped");
+}
+
+// A backlog of zero turns dilate into drop
+auto dilate_without_backlog(checker& c) -> void
+{
+    auto clock = step_clock{{ .policy=catch_up_policy::dilate, .max_steps_per_frame=4, .max_backlog_steps=0 }};
+    settle(clock);
+    clock.advance(1.0);
+    c.expect_near(clock.stats().dilated_time, 0.0, "dilated time");
+    c.expect_near(clock.stats().dropped_time, 1.0 - 4 * frame_time, "dropped time");
+}
+
+auto parsing(checker& c) -> void
+{
+    const auto drop = parse_step_clock_config("drop");
+    c.expect(drop && drop->policy == catch_up_policy::drop, "\"drop\" didn't parse");
+    const auto dilate = parse_step_clock_config("dilate:4");
+    c.expect(dilate && dilate->policy == catch_up_policy::dilate && dilate->max_steps_per_frame == 4, "\"dilate:4\" didn't parse");
+    c.expect(!parse_step_clock_config("drop:0"), "a zero budget was accepted");
+    c.expect(!parse_step_clock_config("dilate:4x"), "trailing characters were accepted");
+    c.expect(!parse_step_clock_config("skip"), "an unknown policy was accepted");
+}
+
+struct test_case
+{
+    std::string_view                name;
+    std::function<void(checker&)>   run;
+};
+
+}
+
+auto main() -> int
+{
+    const auto cases = std::vector<test_case>{
+        {"steady_vsync",           steady_vsync},
+        {"hitch_dilate",           hitch_dilate},
+        {"hitch_drop",             hitch_drop},
+        {"dilate_without_backlog", dilate_without_backlog},
+        {"parsing",                parsing},
+    };
+
+    auto failures = 0;
+    for (const auto& test : cases) {
+        auto c = checker{};
+        test.run(c);
+        if (c.error.empty()) {
+            std::print("ok   {}\n", test.name);
+        } else {
+            std::print("FAIL {:<24} {}\n", test.name, c.error);
+            ++failures;
+        }
+    }
+    std::print("{} of {} cases passed\n", cases.size() - failures, cases.size());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+#include "table.hpp"
+
+#include <array>
+#include <random>
+
+namespace snooker {
+
+namespace {
+
+constexpr auto rack_size = 15;
+
+// The rack without jitter. Colours are listed row by row from the front ball.
+auto rack_positions(glm::vec2 front_pos) -> std::array<glm::vec2, rack_size>
+{
+    const auto left = glm::vec2{std::sqrt(3) * ball_radius, -ball_radius};
+    const auto down = glm::vec2{0, 2 * ball_radius};
+
+    auto positions = std::array<glm::vec2, rack_size>{};
+    auto k = 0;
+    for (i32 row = 0; row != 5; ++row) {
+        for (i32 i = 0; i <= row; ++i) {
+            positions[k++] = front_pos + static_cast<f32>(row) * left + static_cast<f32>(i) * down;
+        }
+    }
+    return positions;
+}
+
+auto rack_colours() -> std::array<glm::vec4, rack_size>
+{
+    const auto red = glm::vec4{1, 0, 0, 1};
+    const auto yel = glm::vec4{1, 1, 0, 1};
+    const auto blk = glm::vec4{0, 0, 0, 1};
+    return {red, red, yel, yel, blk, red, red, yel, red, yel, yel, yel, red, yel, red};
+}
+
+// small random positional jitter so each break plays out differently
+auto rack_jitter(u32 seed) -> std::array<glm::vec2, rack_size>
+{
+    auto rng    = std::mt19937{seed};
+    auto jitter = std::uniform_real_distribution<float>{-0.1f, 0.1f};
+
+    auto offsets = std::array<glm::vec2, rack_size>{};
+    for (auto& offset : offsets) {
+        offset = glm::vec2{jitter(rng), jitter(rng)};
+    }
+    return offsets;
+}
+
+}
+
+auto add_triangle(table& t, glm::vec2 front_pos, u32 seed) -> void
+{
+    const auto positions = rack_positions(front_pos);
+    const auto colours = rack_colours();
+    const auto jitter = rack_jitter(seed);
+    for (std::size_t k = 0; k != rack_size; ++k) {
+        t.add_ball(positions[k] + jitter[k], colours[k]);
+    }
+}
+
+namespace {
+
+auto add_chain(table& t, const std::vector<glm::vec2>& points) -> void
+{
+    assert_that(points.size() >= 2, "chain requires 2 points");
+    for (std::size_t i = 0; i != points.size() - 1; ++i) {
+        t.border_boxes.push_back(t.sim.add_static_line(points[i], points[i+1]));
+    }
+    t.border_boxes.push_back(t.sim.add_static_line(points.back(), points.front()));
+}
+
+}
+
+auto add_border(table& t) -> void
+{
+    constexpr auto cfg = standard_dimensions;
+
+    t.add_pocket({0.0f,            0.0f}, cfg.corner_pocket_radius);
+    t.add_pocket({t.length / 2.0f, -cfg.centre_pocket_offset}, cfg.centre_pocket_radius);
+    t.add_pocket({t.length,        0.0f}, cfg.corner_pocket_radius);
+
+    t.add_pocket({0.0f,            t.width}, cfg.corner_pocket_radius);
+    t.add_pocket({t.length / 2.0f, t.width + cfg.centre_pocket_offset}, cfg.centre_pocket_radius);
+    t.add_pocket({t.length,        t.width}, cfg.corner_pocket_radius);
+
+    add_chain(t, std::vector<glm::vec2>{
+        // top left pocket
+        glm::vec2{cfg.border_width, cfg.corner_pocket_radius + cfg.border_width},
+        glm::vec2{-cfg.corner_pocket_radius, 0},
+        glm::vec2{0, -cfg.corner_pocket_radius},
+        glm::vec2{cfg.corner_pocket_radius + cfg.border_width, cfg.border_width},
+
+        // top centre pocket
+        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius, cfg.border_width},
+        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius + cfg.centre_pocket_back_pinch, -cfg.border_width},
+        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius - cfg.centre_pocket_back_pinch, -cfg.border_width},
+        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius, cfg.border_width},
+
+        // top right pocket
+        glm::vec2{t.length - cfg.corner_pocket_radius - cfg.border_width, cfg.border_width},
+        glm::vec2{t.length, -cfg.corner_pocket_radius},
+        glm::vec2{t.length + cfg.corner_pocket_radius, 0},
+        glm::vec2{t.length - cfg.border_width, cfg.corner_pocket_radius + cfg.border_width},
+
+        // bottom right pocket
+        glm::vec2{t.length - cfg.border_width, t.width - cfg.corner_pocket_radius - cfg.border_width},
+        glm::vec2{t.length + cfg.corner_pocket_radius, t.width},
+        glm::vec2{t.length, t.width + cfg.corner_pocket_radius},
+        glm::vec2{t.length - cfg.corner_pocket_radius - cfg.border_width, t.width - cfg.border_width},
+
+        // bottom centre pocket
+        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius, t.width - cfg.border_width},
+        glm::vec2{t.length / 2.0f + cfg.centre_pocket_radius - cfg.centre_pocket_back_pinch, t.width + cfg.border_width},
+        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius + cfg.centre_pocket_back_pinch, t.width + cfg.border_width},
+        glm::vec2{t.length / 2.0f - cfg.centre_pocket_radius, t.width - cfg.border_width},
+
+        // bottom left pocket
+        glm::vec2{cfg.corner_pocket_radius + cfg.border_width, t.width - cfg.border_width},
+        glm::vec2{0, t.width + cfg.corner_pocket_radius},
+        glm::vec2{-cfg.corner_pocket_radius, t.width},
+        glm::vec2{cfg.border_width, t.width - cfg.corner_pocket_radius - cfg.border_width},
+    });
+}
+
+auto remove_pocketed_balls(table& t) -> void
+{
+    const auto& sim = t.sim; // read only access doesn't invalidate the query index
+    for (const auto& pocket : t.pockets) {
+        const auto& pocket_coll = sim.get(pocket);
+        assert_that(std::holds_alternative<circle_shape>(pocket_coll.shape), "pockets must be circles for now");
+        const auto pock_r = std::get<circle_shape>(pocket_coll.shape).radius;
+
+        sim.query_circle(pocket_coll.pos, pock_r, [&](std::size_t id) {
+            const auto it = std::ranges::find(t.object_balls, id, &ball::id);
+            if (it == t.object_balls.end()) return;
+            const auto& ball_coll = sim.get(id);
+            assert_that(std::holds_alternative<circle_shape>(ball_coll.shape), "balls must be circles for now");
+            const auto ball_r = std::get<circle_shape>(ball_coll.shape).radius;
+            if (glm::distance(ball_coll.pos, pocket_coll.pos) + ball_r < pock_r) {
+                it->is_pocketed = true;
+            }
+        });
+    }
+    for (auto& ball : t.object_balls) {
+        if (ball.is_pocketed) {
+            t.sim.remove(ball.id);
+        }
+    }
+    std::erase_if(t.object_balls, [&](const ball& b) { return b.is_pocketed; }); 
+}
+
+auto cue_ball_in_pocket(const table& t) -> bool
+{
+    const auto& sim = t.sim;
+    const auto cue_pos = sim.get(t.cue_ball.id).pos;
+    for (const auto pocket : t.pockets) {
+        if (overlaps_circle(sim.get(pocket), cue_pos, 0.0f)) return true;
+    }
+    return false;
+}
+
+auto respot_cue_ball(table& t) -> void
+{
+    constexpr auto cfg = standard_dimensions;
+    const auto spot = glm::vec2{50.0f, t.width / 2.0f};
+    const auto& sim = t.sim;
+
+    // Centres that keep the ball off the straight cushions
+    const auto lo = glm::vec2{cfg.border_width + ball_radius};
+    const auto hi = glm::vec2{t.length, t.width} - cfg.border_width - ball_radius;
+    const auto max_offset = glm::max(spot - lo, hi - spot);
+
+    // 0, +1, -1, +2, -2... steps from the spot
+    const auto step = 2.1f * ball_radius;
+    const auto nth_offset = [&](i32 i) {
+        const auto offset = static_cast<float>((i + 1) / 2) * step;
+        return i % 2 == 1 ? offset : -offset;
+    };
+
+    // Anything overlapping blocks the spot, including a cushion or pocket jaw
+    const auto is_free = [&](glm::vec2 pos) {
+        auto free = true;
+        sim.query_circle(pos, ball_radius, [&](std::size_t id) { free = free && id == t.cue_ball.id; });
+        return free;
+    };
+
+    // Try the spot first, then alternate either side of it along the baulk line, and
+    // only when that is full the lines either side of it across the table
+    for (i32 column = 0; std::abs(nth_offset(column)) <= max_offset.x; ++column) {
+        const auto x = spot.x + nth_offset(column);
+        if (x < lo.x || x > hi.x) continue;
+        for (i32 row = 0; std::abs(nth_offset(row)) <= max_offset.y; ++row) {
+            const auto pos = glm::vec2{x, spot.y + nth_offset(row)};
+            if (pos.y < lo.y || pos.y > hi.y || !is_free(pos)) continue;
+
+            auto& coll = t.sim.get(t.cue_ball.id);
+            auto& body = std::get<dynamic_body>(coll.body);
+            coll.pos = pos;
+            body.vel = {0.0f, 0.0f};
+            body.angular_vel = {0.0f, 0.0f};
+            return;
+        }
+    }
+    assert_that(false, "no free spot on the table to respot the cue ball");
+}
+
+auto kind_of_pocket(const table& t, std::size_t pocket_id) -> pocket_kind
+{
+    constexpr auto cfg = standard_dimensions;
+    const auto radius = std::get<circle_shape>(t.sim.get(pocket_id).shape).radius;
+    return radius > (cfg.corner_pocket_radius + cfg.centre_pocket_radius) / 2.0f ? pocket_kind::corner : pocket_kind::centre;
+}
+
+table_prototype::table_prototype()
+    : d_table{182.88f, 91.44f} // english pool table dimensions in cm (6ft x 3ft)
+{
+    // Same insertion order as add_triangle then add_border, so IDs and storage order
+    // match a table built by hand and results are bit-identical
+    auto& t = d_table;
+    t.set_cue_ball({50.0f, t.width / 2.0f});
+    d_rack = rack_positions({0.8f * t.length, t.width / 2.0f});
+    const auto colours = rack_colours();
+    for (std::size_t k = 0; k != rack_size; ++k) {
+        t.add_ball(d_rack[k], colours[k]);
+    }
+    add_border(t); // TODO: replace with a better construction
+    t.sim.prepare_queries(); // so that queries through get() don't write to it
+}
+
+auto table_prototype::place_rack(table& t, u32 seed) const -> void
+{
+    const auto jitter = rack_jitter(seed);
+    for (std::size_t k = 0; k != rack_size; ++k) {
+        t.sim.get(t.object_balls[k].id).pos = d_rack[k] + jitter[k];
+    }
+}
+
+auto table_prototype::instantiate(u32 seed) const -> table
+{
+    auto t = d_table;
+    place_rack(t, seed);
+    return t;
+}
+
+auto table_prototype::instantiate(u32 seed, std::pmr::memory_resource* resource) const -> table
+{
+    auto t = copy_table(d_table, resource);
+    place_rack(t, seed);
+    return t;
+}
+
+auto standard_prototype() -> const table_prototype&
+{
+    static const auto prototype = table_prototype{};
+    return prototype;
+}
+
+auto make_standard_table(u32 seed) -> table
+{
+    return standard_prototype().instantiate(seed);
+}
+
+auto make_layout_table(glm::vec2 cue_ball, std::span<const glm::vec2> object_balls) -> table
+{
+    auto t = table{182.88f, 91.44f};
+    t.set_cue_ball(cue_ball);
+    for (const auto pos : object_balls) {
+        t.add_ball(pos, {1, 0, 0, 1});
+    }
+    add_border(t);
+    return t;
+}
+
+auto copy_table(const table& t, std::pmr::memory_resource* resource) -> table
+{
+    return table{
+        .length=t.length,
+        .width=t.width,
+        .sim=simulation{t.sim, resource},
+        .cue_ball=t.cue_ball,
+        .object_balls=t.object_balls,
+        .border_boxes=t.border_boxes,
+        .pockets=t.pockets
+    };
+}
+
+}
@@ -4,6 +4,8 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <array>
+#include <span>
 #include <variant>
 
 namespace snooker {
@@ -14,6 +16,24 @@ constexpr auto ball_mass = 140.0f; // grams
 constexpr auto board_colour = from_hex(0x3db81e);
 constexpr auto break_speed = 983.49f; // cm
 
+struct table_dimensions
+{
+    float border_width;
+    float centre_pocket_radius;
+    float corner_pocket_radius;
+    
+    float centre_pocket_offset;
+    float centre_pocket_back_pinch;
+};
+
+constexpr auto standard_dimensions = table_dimensions{
+    .border_width = 4.0f,
+    .centre_pocket_radius = 6.0f,
+    .corner_pocket_radius = 7.0f,
+    .centre_pocket_offset = 3.0f,
+    .centre_pocket_back_pinch = 2.0f
+};
+
 struct ball
 {
     std::size_t id;
@@ -57,4 +77,68 @@ struct table
     }
 };
 
+enum class pocket_kind
+{
+    corner,
+    centre,
+};
+
+// Tells corner and centre pockets apart by their radius in standard_dimensions
+auto kind_of_pocket(const table& t, std::size_t pocket_id) -> pocket_kind;
+
+// Adds the 15 ball rack with its front ball at the given position. The seed drives
+// a small positional jitter so that each break plays out differently.
+auto add_triangle(table& t, glm::vec2 front_pos, u32 seed) -> void;
+
+// Adds the six pockets and the cushion outline using standard_dimensions.
+auto add_border(table& t) -> void;
+
+// Removes any object balls that have fallen into a pocket from the table.
+auto remove_pocketed_balls(table& t) -> void;
+
+// True if the centre of the cue ball is inside a pocket.
+auto cue_ball_in_pocket(const table& t) -> bool;
+
+// Puts the cue ball back on its starting spot at rest. If another ball is in the
+// way it moves along the baulk line, then across the table a line at a time, never
+// touching a cushion. Fails an assertion if there is no room anywhere.
+auto respot_cue_ball(table& t) -> void;
+
+// Copies the table with its simulation drawing from the given resource. See the
+// simulation constructor.
+auto copy_table(const table& t, std::pmr::memory_resource* resource) -> table;
+
+// The standard table built once, with the border, pockets and balls inserted in
+// their usual order. Instantiating it copies the collider storage and moves the
+// rack balls to their jittered spots rather than inserting every collider again.
+// It is immutable and its query index is prepared up front, so one prototype can be
+// shared by any number of threads, including queries on get().sim.
+class table_prototype
+{
+    table                     d_table;
+    std::array<glm::vec2, 15> d_rack; // rack positions before jitter, in object_balls order
+
+    auto place_rack(table& t, u32 seed) const -> void;
+
+public:
+    table_prototype();
+
+    auto get() const -> const table& { return d_table; }
+
+    // A table identical to one built by add_triangle(t, ..., seed) and add_border
+    auto instantiate(u32 seed) const -> table;
+    auto instantiate(u32 seed, std::pmr::memory_resource* resource) const -> table;
+};
+
+// The shared prototype behind make_standard_table, built on first use
+auto standard_prototype() -> const table_prototype&;
+
+// The starting layout for a frame: cue ball on its spot, the rack at the far end
+// with its jitter driven by the seed, and the border.
+auto make_standard_table(u32 seed) -> table;
+
+// A standard table with the border and the balls at the given positions, for
+// evaluating layouts that came from elsewhere. Object balls are all red.
+auto make_layout_table(glm::vec2 cue_ball, std::span<const glm::vec2> object_balls) -> table;
+
 }
\ No newline at end of file
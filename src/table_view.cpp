@@ -0,0 +1,79 @@
+#include "table_view.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace snooker {
+
+auto fit_table(glm::vec2 table_size, glm::vec2 area_top_left, glm::vec2 area_size, f32 margin) -> table_viewport
+{
+    // Corner pockets are centred on the corners of the cloth, so they overhang it
+    const auto overhang = glm::vec2{standard_dimensions.corner_pocket_radius, standard_dimensions.corner_pocket_radius};
+    const auto extent = table_size + 2.0f * overhang;
+    const auto inner = glm::max(area_size - 2.0f * margin, glm::vec2{0.0f, 0.0f});
+    const auto scale = std::min(inner.x / extent.x, inner.y / extent.y);
+    return table_viewport{
+        .top_left=area_top_left + (area_size - scale * extent) / 2.0f + scale * overhang,
+        .scale=scale
+    };
+}
+
+auto grid_viewports(std::size_t count, glm::vec2 table_size, glm::vec2 area_top_left, glm::vec2 area_size, f32 margin) -> std::vector<table_viewport>
+{
+    if (count == 0) return {};
+
+    auto best_columns = std::size_t{1};
+    auto best_scale = 0.0f;
+    for (std::size_t columns = 1; columns <= count; ++columns) {
+        const auto rows = (count + columns - 1) / columns;
+        const auto cell = area_size / glm::vec2{columns, rows};
+        const auto scale = fit_table(table_size, {0.0f, 0.0f}, cell, margin).scale;
+        if (scale > best_scale) {
+            best_scale = scale;
+            best_columns = columns;
+        }
+    }
+
+    const auto rows = (count + best_columns - 1) / best_columns;
+    const auto cell = area_size / glm::vec2{best_columns, rows};
+    auto viewports = std::vector<table_viewport>{};
+    viewports.reserve(count);
+    for (std::size_t i = 0; i != count; ++i) {
+        const auto cell_pos = glm::vec2{i % best_columns, i / best_columns};
+        viewports.push_back(fit_table(table_size, area_top_left + cell_pos * cell, cell, margin));
+    }
+    return viewports;
+}
+
+auto push_table(renderer& r, const table& t, const table_viewport& viewport) -> void
+{
+    const auto& v = viewport;
+    r.push_rect(v.to_screen({0.0f, 0.0f}), v.to_screen(t.length), v.to_screen(t.width), board_colour);
+
+    for (const auto id : t.pockets) {
+        const auto& coll = t.sim.get(id);
+        r.push_circle(v.to_screen(coll.pos), from_hex(0x422007), v.to_screen(std::get<circle_shape>(coll.shape).radius));
+    }
+
+    for (const auto id : t.border_boxes) {
+        const auto& coll = t.sim.get(id);
+        std::visit(overloaded{
+            [&](const box_shape& b) {
+                r.push_quad(v.to_screen(coll.pos), v.to_screen(b.width), v.to_screen(b.height), 0, from_hex(0x73380b));
+            },
+            [&](const line_shape& l) {
+                r.push_line(v.to_screen(coll.pos + l.start), v.to_screen(coll.pos + l.end), from_hex(0x73380b), std::max(1.0f, v.to_screen(0.35f)));
+            },
+            [&](auto&&) {}
+        }, coll.shape);
+    }
+
+    // The cue ball has a red dot so that its spin shows against the white
+    const auto& cue = t.sim.get(t.cue_ball.id);
+    r.push_sphere(v.to_screen(cue.pos), t.cue_ball.colour, v.to_screen(ball_radius), t.cue_ball.orientation, {1, 0, 0, 1});
+    for (const auto& b : t.object_balls) {
+        r.push_sphere(v.to_screen(t.sim.get(b.id).pos), b.colour, v.to_screen(ball_radius), b.orientation);
+    }
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "renderer.hpp"
+#include "table.hpp"
+#include "utility.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace snooker {
+
+// Where a table appears on screen: board positions in cm are scaled to pixels and
+// offset so that the board's origin lands at top_left
+struct table_viewport
+{
+    glm::vec2 top_left;
+    f32       scale;
+
+    auto to_screen(glm::vec2 value) const -> glm::vec2 { return top_left + value * scale; }
+    auto to_screen(f32 value) const -> f32 { return value * scale; }
+};
+
+// Fits a table of the given size centred in a screen area, pockets included,
+// leaving a margin of pixels around it
+auto fit_table(glm::vec2 table_size, glm::vec2 area_top_left, glm::vec2 area_size, f32 margin) -> table_viewport;
+
+// Splits a screen area into a grid of equal cells, enough for count tables, with
+// the number of columns that draws the tables largest. Viewports are in row order.
+auto grid_viewports(std::size_t count, glm::vec2 table_size, glm::vec2 area_top_left, glm::vec2 area_size, f32 margin = 4.0f) -> std::vector<table_viewport>;
+
+// Queues the cloth, pockets, cushions and balls of a table. The viewport transform is
+// applied as the instances are pushed, so any number of tables pushed before the
+// next renderer::draw share one upload and one draw call per primitive type, and the
+// cost of drawing them follows the number of balls rather than the number of tables.
+auto push_table(renderer& r, const table& t, const table_viewport& viewport) -> void;
+
+}
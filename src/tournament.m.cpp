@@ -0,0 +1,190 @@
+// Headless soak test that plays many AI versus AI matches at once on a fixed thread
+// pool. Each match is a coroutine that advances a slice of simulation steps and then
+// requeues itself behind the others, so there is no thread per match, and a match is
+// aborted if it uses more than its CPU time budget.
+//
+//   tournament [--matches N] [--threads N] [--budget-ms X] [--verify N] [--out DIR]
+//
+// Writes DIR/results.txt with one line per match and a replay per match to
+// DIR/replays, then reports matches per hour and how busy each worker was. The first
+// N replays are re-simulated to check that they reproduce exactly.
+#include "executor.hpp"
+#include "match.hpp"
+#include "replay.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace snooker;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    i32         matches     = 256;
+    std::size_t threads     = std::max(1u, std::thread::hardware_concurrency());
+    f64         budget_ms   = 20000.0; // CPU time per match
+    i32         verify      = 8;
+    std::string out         = "tournament_out";
+    i32         slice_steps = 60;      // steps per time slice, one second of play
+};
+
+struct match_slot
+{
+    u32                    seed;
+    std::unique_ptr<match> game;
+    f64                    cpu_ms = 0.0;
+};
+
+auto name_of(match_status status) -> std::string_view
+{
+    switch (status) {
+        case match_status::playing:  return "playing";
+        case match_status::finished: return "finished";
+        case match_status::aborted:  return "aborted";
+        default:                     return "unknown";
+    }
+}
+
+auto parse_options(int argc, char** argv) -> options
+{
+    auto opts = options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto flag = std::string_view{argv[i]};
+        const auto value = std::string{argv[i + 1]};
+        if      (flag == "--matches")   opts.matches = std::stoi(value);
+        else if (flag == "--threads")   opts.threads = std::stoul(value);
+        else if (flag == "--budget-ms") opts.budget_ms = std::stod(value);
+        else if (flag == "--verify")    opts.verify = std::stoi(value);
+        else if (flag == "--out")       opts.out = value;
+        else assert_that(false, std::format("unknown option {}", flag));
+    }
+    assert_that(opts.threads > 0, "need at least one thread");
+    return opts;
+}
+
+auto play(executor& exec, match_slot& slot, const options& opts, std::stop_token stop) -> task<void>
+{
+    while (true) {
+        co_await exec.on_pool(); // go to the back of the queue behind the other matches
+        if (stop.stop_requested()) {
+            slot.game->abort();
+            break;
+        }
+
+        const auto start = clock_type::now();
+        const auto status = slot.game->advance(opts.slice_steps);
+        slot.cpu_ms += std::chrono::duration<f64, std::milli>(clock_type::now() - start).count();
+
+        if (status != match_status::playing) break;
+        if (slot.cpu_ms > opts.budget_ms) {
+            slot.game->abort();
+            break;
+        }
+    }
+}
+
+auto write_results(const options& opts, const std::vector<match_slot>& slots) -> void
+{
+    const auto replay_dir = std::filesystem::path{opts.out} / "replays";
+    std::filesystem::create_directories(replay_dir);
+
+    auto file = std::ofstream{std::filesystem::path{opts.out} / "results.txt"};
+    assert_that(file.good(), std::format("could not write results to {}", opts.out));
+    for (std::size_t i = 0; i != slots.size(); ++i) {
+        const auto& slot = slots[i];
+        const auto& game = *slot.game;
+        const auto winner = game.winner();
+        file << std::format("match {} seed {} status {} shots {} steps {} score {} {} winner {} cpu_ms {:.1f}\n",
+                            i, slot.seed, name_of(game.status()), game.get_replay().shots.size(), game.total_steps(),
+                            game.scores()[0], game.scores()[1], winner ? std::to_string(*winner) : "draw", slot.cpu_ms);
+
+        const auto path = replay_dir / std::format("match_{}.txt", i);
+        assert_that(save_replay(path.string(), game.get_replay()), std::format("could not write replay {}", path.string()));
+    }
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto opts = parse_options(argc, argv);
+    std::print("tournament: {} matches on {} threads, budget {:.0f}ms per match\n", opts.matches, opts.threads, opts.budget_ms);
+
+    auto slots = std::vector<match_slot>{};
+    for (i32 i = 0; i != opts.matches; ++i) {
+        const auto seed = static_cast<u32>(1000 + i);
+        slots.push_back({seed, std::make_unique<match>(seed)});
+    }
+
+    const auto start = clock_type::now();
+    auto pool = thread_pool{opts.threads};
+    {
+        auto exec = executor{pool};
+        auto jobs = std::vector<job<void>>{};
+        for (auto& slot : slots) {
+            jobs.push_back(exec.spawn([&](std::stop_token stop) { return play(exec, slot, opts, stop); }));
+        }
+
+        auto last_report = start;
+        while (true) {
+            exec.run_main_continuations();
+            const auto pending = static_cast<std::size_t>(std::ranges::count_if(jobs, [](const job<void>& j) { return !j.ready(); }));
+            if (pending == 0) break;
+
+            if (clock_type::now() - last_report > std::chrono::seconds{5}) {
+                last_report = clock_type::now();
+                std::print("  {} of {} matches still running\n", pending, jobs.size());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    }
+    const auto wall = clock_type::now() - start;
+    const auto wall_s = std::chrono::duration<f64>(wall).count();
+
+    write_results(opts, slots);
+
+    auto finished = 0;
+    auto aborted = 0;
+    auto steps = u64{0};
+    for (const auto& slot : slots) {
+        finished += slot.game->status() == match_status::finished;
+        aborted += slot.game->status() == match_status::aborted;
+        steps += slot.game->total_steps();
+    }
+    std::print("finished {} aborted {} in {:.1f}s: {:.0f} matches/hour, {:.0f} steps/s\n",
+               finished, aborted, wall_s, finished * 3600.0 / wall_s, steps / wall_s);
+
+    // Workers aren't pinned, so this is per worker thread rather than strictly per core
+    auto total_busy = 0.0;
+    for (std::size_t i = 0; i != pool.size(); ++i) {
+        const auto busy = std::chrono::duration<f64>(pool.busy_time(i)).count() / wall_s;
+        total_busy += busy;
+        std::print("  worker {:<3} utilisation {:5.1f}%\n", i, 100.0 * busy);
+    }
+    std::print("  mean utilisation {:5.1f}%\n", 100.0 * total_busy / pool.size());
+
+    auto mismatches = 0;
+    for (i32 i = 0; i < opts.verify && i < opts.matches; ++i) {
+        if (const auto shot = verify_replay(slots[i].game->get_replay())) {
+            ++mismatches;
+            std::print("  replay {} diverged at shot {}\n", i, *shot);
+        }
+    }
+    std::print("verified {} replays, {} diverged\n", std::min(opts.verify, opts.matches), mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}